@@ -72,3 +72,18 @@ const QString MAXIMIZE_INSTEAD_OF_AVERAGE_KEY = QStringLiteral("maximizeinsteado
 const QString INVERT_KEY = QStringLiteral("invert");
 const QString MSDFGEN_COLOURING = QStringLiteral("msdfgencoloring");
 const QString CREATE_MIPMAPS_KEY = QStringLiteral("createmipmaps");
+const QString DISTANCE_TRANSFORM_KEY = QStringLiteral("distancetransform");
+const QString TIGHT_BOUNDS_KEY = QStringLiteral("tightbounds");
+const QString SUPERSAMPLE_KEY = QStringLiteral("supersample");
+const QString THREADS_KEY = QStringLiteral("threads");
+const QString ENCODER_THREADS_KEY = QStringLiteral("encoderthreads");
+const QString PROFILE_KEY = QStringLiteral("profile");
+const QString CHAR_RANGES_KEY = QStringLiteral("charranges");
+const QString CHARSET_FILE_KEY = QStringLiteral("charsetfile");
+const QString CACHE_DIR_KEY = QStringLiteral("cachedir");
+const QString CACHE_SIZE_KEY = QStringLiteral("cachesize");
+const QString ATLAS_PAGE_SIZE_KEY = QStringLiteral("atlaspagesize");
+const QString ATLAS_SPACING_KEY = QStringLiteral("atlasspacing");
+const QString ATLAS_KEY = QStringLiteral("atlas");
+const QString ATLAS_PAGES_KEY = QStringLiteral("pages");
+const QString ATLAS_PLACEMENTS_KEY = QStringLiteral("placements");
@@ -86,5 +86,20 @@ extern const QString MAXIMIZE_INSTEAD_OF_AVERAGE_KEY;
 extern const QString INVERT_KEY;
 extern const QString MSDFGEN_COLOURING;
 extern const QString CREATE_MIPMAPS_KEY;
+extern const QString DISTANCE_TRANSFORM_KEY;
+extern const QString TIGHT_BOUNDS_KEY;
+extern const QString SUPERSAMPLE_KEY;
+extern const QString THREADS_KEY;
+extern const QString ENCODER_THREADS_KEY;
+extern const QString PROFILE_KEY;
+extern const QString CHAR_RANGES_KEY;
+extern const QString CHARSET_FILE_KEY;
+extern const QString CACHE_DIR_KEY;
+extern const QString CACHE_SIZE_KEY;
+extern const QString ATLAS_PAGE_SIZE_KEY;
+extern const QString ATLAS_SPACING_KEY;
+extern const QString ATLAS_KEY;
+extern const QString ATLAS_PAGES_KEY;
+extern const QString ATLAS_PLACEMENTS_KEY;
 
 #endif // CONSTSTRINGS_HPP
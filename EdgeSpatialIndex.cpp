@@ -0,0 +1,175 @@
+#include "EdgeSpatialIndex.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <tuple>
+
+/// Cells smaller than this only add bookkeeping, since a glyph's edges span many pixels anyway.
+#define MIN_CELL_SIZE 8.0f
+/// Upper limit of cells per axis, bounding the size of the flattened buffer on huge canvases.
+#define MAX_CELLS_PER_AXIS 128
+
+EdgeBounds EdgeBounds::of(const EdgeSegment& edge)
+{
+	return { glm::fvec2(edge.getMinX(), edge.getMinY()), glm::fvec2(edge.getMaxX(), edge.getMaxY()) };
+}
+
+float EdgeBounds::gap(const EdgeBounds& other, DistanceType distType) const
+{
+	const glm::fvec2 d = glm::max(glm::fvec2(0.0f), glm::max(other.min - max, min - other.max));
+	return distType == DistanceType::Manhattan ? (d.x + d.y) : glm::length(d);
+}
+
+float EdgeBounds::gap(const glm::fvec2& point, DistanceType distType) const
+{
+	return gap(EdgeBounds{ point, point }, distType);
+}
+
+EdgeSpatialIndex::EdgeSpatialIndex()
+	: distType(Manhattan), cellSize(1.0f), columns(1), rows(1), cellOffsets{ 0, 0 }, bandOffsets{ 0, 0 }
+{
+
+}
+
+EdgeSpatialIndex::EdgeSpatialIndex(const std::vector<EdgeSegment>& edges, int width, int height, float maxDistance, DistanceType distType)
+{
+	build(edges, width, height, maxDistance, distType);
+}
+
+void EdgeSpatialIndex::build(const std::vector<EdgeSegment>& edges, int width, int height, float maxDistance, DistanceType distType)
+{
+	this->distType = distType;
+	// Half the cap keeps the lists short without the same edge landing in too many cells
+	cellSize = std::max(maxDistance * 0.5f, MIN_CELL_SIZE);
+	cellSize = std::max(cellSize, static_cast<float>(std::max(width, height)) / MAX_CELLS_PER_AXIS);
+	columns = std::max(1u, static_cast<uint32_t>(std::ceil(static_cast<float>(width) / cellSize)));
+	rows = std::max(1u, static_cast<uint32_t>(std::ceil(static_cast<float>(height) / cellSize)));
+
+	bounds.resize(edges.size());
+	for(size_t i = 0; i < edges.size(); ++i) {
+		bounds[i] = EdgeBounds::of(edges[i]);
+	}
+
+	auto toCell = [this](float coord, uint32_t count) {
+		return static_cast<int>(std::clamp(std::floor(coord / cellSize), 0.0f, static_cast<float>(count - 1)));
+	};
+
+	// (cell, gap, edge) triplets, sorted so every cell's list comes out contiguous and nearest first
+	std::vector<std::tuple<uint32_t, float, uint32_t>> cellEntries;
+	// (band, edge) pairs, already in edge order within each band
+	std::vector<std::pair<uint32_t, uint32_t>> bandEntries;
+	for(uint32_t i = 0; i < bounds.size(); ++i) {
+		const EdgeBounds& box = bounds[i];
+		if(box.max.y >= 0.0f && box.min.y < static_cast<float>(height)) {
+			const int r0 = toCell(box.min.y, rows);
+			const int r1 = toCell(box.max.y, rows);
+			for(int r = r0; r <= r1; ++r) bandEntries.emplace_back(r, i);
+		}
+		if(box.max.x + maxDistance < 0.0f || box.min.x - maxDistance >= static_cast<float>(width) ||
+				box.max.y + maxDistance < 0.0f || box.min.y - maxDistance >= static_cast<float>(height)) {
+			continue;
+		}
+		const int cx0 = toCell(box.min.x - maxDistance, columns);
+		const int cx1 = toCell(box.max.x + maxDistance, columns);
+		const int cy0 = toCell(box.min.y - maxDistance, rows);
+		const int cy1 = toCell(box.max.y + maxDistance, rows);
+		for(int cy = cy0; cy <= cy1; ++cy) {
+			for(int cx = cx0; cx <= cx1; ++cx) {
+				const EdgeBounds cell = { glm::fvec2(cx, cy) * cellSize, glm::fvec2(cx + 1, cy + 1) * cellSize };
+				const float cellGap = box.gap(cell, distType);
+				if(cellGap <= maxDistance) cellEntries.emplace_back(cy * columns + cx, cellGap, i);
+			}
+		}
+	}
+	std::sort(cellEntries.begin(), cellEntries.end());
+	std::stable_sort(bandEntries.begin(), bandEntries.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+	cellOffsets.assign(columns * rows + 1, 0);
+	cellEdges.resize(cellEntries.size());
+	for(size_t i = 0; i < cellEntries.size(); ++i) {
+		++cellOffsets[std::get<0>(cellEntries[i]) + 1];
+		cellEdges[i] = std::get<2>(cellEntries[i]);
+	}
+	for(size_t i = 1; i < cellOffsets.size(); ++i) cellOffsets[i] += cellOffsets[i - 1];
+
+	bandOffsets.assign(rows + 1, 0);
+	bandEdges.resize(bandEntries.size());
+	for(size_t i = 0; i < bandEntries.size(); ++i) {
+		++bandOffsets[bandEntries[i].first + 1];
+		bandEdges[i] = bandEntries[i].second;
+	}
+	for(size_t i = 1; i < bandOffsets.size(); ++i) bandOffsets[i] += bandOffsets[i - 1];
+}
+
+const EdgeBounds& EdgeSpatialIndex::getBounds(uint32_t edge) const
+{
+	return bounds[edge];
+}
+
+EdgeBounds EdgeSpatialIndex::getCellBounds(const glm::fvec2& point) const
+{
+	const float cx = std::clamp(std::floor(point.x / cellSize), 0.0f, static_cast<float>(columns - 1));
+	const float cy = std::clamp(std::floor(point.y / cellSize), 0.0f, static_cast<float>(rows - 1));
+	return { glm::fvec2(cx, cy) * cellSize, glm::fvec2(cx + 1.0f, cy + 1.0f) * cellSize };
+}
+
+std::span<const uint32_t> EdgeSpatialIndex::getCellEdges(const glm::fvec2& point) const
+{
+	const uint32_t cx = static_cast<uint32_t>(std::clamp(std::floor(point.x / cellSize), 0.0f, static_cast<float>(columns - 1)));
+	const uint32_t cy = static_cast<uint32_t>(std::clamp(std::floor(point.y / cellSize), 0.0f, static_cast<float>(rows - 1)));
+	const uint32_t cell = cy * columns + cx;
+	return std::span<const uint32_t>(cellEdges.data() + cellOffsets[cell], cellOffsets[cell + 1] - cellOffsets[cell]);
+}
+
+std::span<const uint32_t> EdgeSpatialIndex::getBandEdges(float y) const
+{
+	const uint32_t r = static_cast<uint32_t>(std::clamp(std::floor(y / cellSize), 0.0f, static_cast<float>(rows - 1)));
+	return std::span<const uint32_t>(bandEdges.data() + bandOffsets[r], bandOffsets[r + 1] - bandOffsets[r]);
+}
+
+std::vector<uint32_t> EdgeSpatialIndex::toStd430() const
+{
+	std::vector<uint32_t> words;
+	words.reserve(3 + cellOffsets.size() + bandOffsets.size() + cellEdges.size() + bandEdges.size());
+	uint32_t cellSizeBits;
+	std::memcpy(&cellSizeBits, &cellSize, sizeof(float));
+	words.push_back(cellSizeBits);
+	words.push_back(columns);
+	words.push_back(rows);
+	// Offsets are rebased onto the start of the data array, which follows the three header words
+	const uint32_t cellEdgesStart = static_cast<uint32_t>(cellOffsets.size() + bandOffsets.size());
+	const uint32_t bandEdgesStart = cellEdgesStart + static_cast<uint32_t>(cellEdges.size());
+	for(const uint32_t it : cellOffsets) words.push_back(cellEdgesStart + it);
+	for(const uint32_t it : bandOffsets) words.push_back(bandEdgesStart + it);
+	words.insert(words.end(), cellEdges.begin(), cellEdges.end());
+	words.insert(words.end(), bandEdges.begin(), bandEdges.end());
+	return words;
+}
+
+uint32_t EdgeSpatialIndex::appendStd430(std::vector<uint32_t>& words, uint32_t firstEdge) const
+{
+	const uint32_t dataStart = static_cast<uint32_t>(words.size());
+	words.reserve(words.size() + cellOffsets.size() + bandOffsets.size() + cellEdges.size() + bandEdges.size());
+	const uint32_t cellEdgesStart = dataStart + static_cast<uint32_t>(cellOffsets.size() + bandOffsets.size());
+	const uint32_t bandEdgesStart = cellEdgesStart + static_cast<uint32_t>(cellEdges.size());
+	for(const uint32_t it : cellOffsets) words.push_back(cellEdgesStart + it);
+	for(const uint32_t it : bandOffsets) words.push_back(bandEdgesStart + it);
+	for(const uint32_t it : cellEdges) words.push_back(firstEdge + it);
+	for(const uint32_t it : bandEdges) words.push_back(firstEdge + it);
+	return dataStart;
+}
+
+float EdgeSpatialIndex::getCellSize() const
+{
+	return cellSize;
+}
+
+uint32_t EdgeSpatialIndex::getColumns() const
+{
+	return columns;
+}
+
+uint32_t EdgeSpatialIndex::getRows() const
+{
+	return rows;
+}
@@ -0,0 +1,166 @@
+/**
+ * @file EdgeSpatialIndex.hpp
+ * @brief Uniform grid accelerating distance and winding queries against outline edges.
+ *
+ * Without an index every pixel visits every edge of the glyph, which makes the cost
+ * pixels × edges. The grid is built once per glyph and lets a query visit only the
+ * edges that can lie within the distance cap of the pixel, nearest first. The same
+ * data can be flattened into a single std430 buffer for the compute shaders.
+ */
+
+#ifndef EDGESPATIALINDEX_HPP
+#define EDGESPATIALINDEX_HPP
+#include "FontOutlineDecompositionContext.hpp"
+#include "SDFGenerationArguments.hpp"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * @brief Axis-aligned bounding box of an edge's control polygon.
+ * @struct EdgeBounds
+ */
+struct EdgeBounds {
+	glm::fvec2 min;  ///< Lower corner
+	glm::fvec2 max;  ///< Upper corner
+
+	/**
+	 * @brief Bounds of an edge, as reported by EdgeSegment::getMinX() and friends.
+	 * @param edge Edge to enclose.
+	 * @return Bounding box of the edge.
+	 */
+	static EdgeBounds of(const EdgeSegment& edge);
+
+	/**
+	 * @brief Lower bound of the distance between any point of this box and any point of another.
+	 *
+	 * Since the edge lies within its box, the gap between a pixel (a degenerate box) and the
+	 * box of an edge never exceeds the distance from that pixel to the edge.
+	 *
+	 * @param other Box to measure against.
+	 * @param distType Distance metric.
+	 * @return Gap between the two boxes (0 if they overlap).
+	 */
+	float gap(const EdgeBounds& other, DistanceType distType) const;
+
+	/**
+	 * @brief Lower bound of the distance between a point and any point of this box.
+	 * @param point Point to measure from.
+	 * @param distType Distance metric.
+	 * @return Gap between the point and the box (0 if it is inside).
+	 */
+	float gap(const glm::fvec2& point, DistanceType distType) const;
+};
+
+/**
+ * @brief Uniform grid of candidate edge lists over a glyph canvas.
+ *
+ * The canvas [0, width) × [0, height) is divided into square cells. Each cell lists
+ * every edge whose bounding box comes within the distance cap of the cell, sorted by
+ * how close that box gets to the cell, so a query can stop as soon as the next box is
+ * farther than its best distance. A pixel whose cell list is empty is farther than the
+ * cap from every edge and can exit at once.
+ *
+ * Each row of cells also doubles as a horizontal band listing the edges whose vertical
+ * extent overlaps it, which is all the scanline winding test needs to look at.
+ *
+ * @class EdgeSpatialIndex
+ */
+class EdgeSpatialIndex {
+private:
+	DistanceType distType;                ///< Metric used to sort the cell lists
+	float cellSize;                       ///< Side length of a cell, in pixels
+	uint32_t columns;                     ///< Number of cells horizontally
+	uint32_t rows;                        ///< Number of cells vertically
+	std::vector<EdgeBounds> bounds;       ///< Bounding box of each edge, in edge order
+	std::vector<uint32_t> cellOffsets;    ///< Start of each cell's list in cellEdges (columns * rows + 1 entries)
+	std::vector<uint32_t> cellEdges;      ///< Concatenated per-cell edge lists, nearest edge first
+	std::vector<uint32_t> bandOffsets;    ///< Start of each band's list in bandEdges (rows + 1 entries)
+	std::vector<uint32_t> bandEdges;      ///< Concatenated per-band edge lists, in edge order
+
+public:
+	/**
+	 * @brief Construct an empty index.
+	 */
+	EdgeSpatialIndex();
+
+	/**
+	 * @brief Build the index over a glyph's edges.
+	 * @param edges Edges of the glyph, in canvas coordinates.
+	 * @param width Canvas width in pixels.
+	 * @param height Canvas height in pixels.
+	 * @param maxDistance Distance cap; edges farther than this from a cell are left out of its list.
+	 * @param distType Distance metric of the queries.
+	 */
+	EdgeSpatialIndex(const std::vector<EdgeSegment>& edges, int width, int height, float maxDistance, DistanceType distType);
+
+	/**
+	 * @brief Rebuild the index over a glyph's edges.
+	 * @see EdgeSpatialIndex(const std::vector<EdgeSegment>&, int, int, float, DistanceType)
+	 */
+	void build(const std::vector<EdgeSegment>& edges, int width, int height, float maxDistance, DistanceType distType);
+
+	/**
+	 * @brief Get the bounding box of an edge.
+	 * @param edge Index of the edge.
+	 * @return Bounding box of the edge.
+	 */
+	const EdgeBounds& getBounds(uint32_t edge) const;
+
+	/**
+	 * @brief Get the bounds of the cell containing a point.
+	 * @param point Point on the canvas (clamped to the grid).
+	 * @return Bounds of the cell.
+	 */
+	EdgeBounds getCellBounds(const glm::fvec2& point) const;
+
+	/**
+	 * @brief Get the candidate edges for a point, nearest first.
+	 *
+	 * Iterate in order and stop once getBounds(i).gap(getCellBounds(point)) exceeds the best
+	 * distance found so far: no later edge in the list can beat it.
+	 *
+	 * @param point Point on the canvas (clamped to the grid).
+	 * @return Indices of every edge within the distance cap of the point's cell.
+	 */
+	std::span<const uint32_t> getCellEdges(const glm::fvec2& point) const;
+
+	/**
+	 * @brief Get the edges that may cross a horizontal scanline.
+	 * @param y Height of the scanline (clamped to the grid).
+	 * @return Indices, in edge order, of the edges whose vertical extent overlaps the band of y.
+	 */
+	std::span<const uint32_t> getBandEdges(float y) const;
+
+	/**
+	 * @brief Flatten the index for upload into a shader storage buffer.
+	 *
+	 * Layout (std430, 32-bit words): cell size (float), columns, rows, then the data array
+	 * holding cellOffsets, bandOffsets, cellEdges and bandEdges back to back. Offsets are
+	 * absolute indices into the data array, so a cell's list is data[data[c]] up to
+	 * data[data[c + 1]] and a band's list starts at data[data[columns * rows + 1 + r]].
+	 *
+	 * @return Words of the buffer.
+	 */
+	std::vector<uint32_t> toStd430() const;
+
+	/**
+	 * @brief Append the data array of toStd430() to a buffer shared by several glyphs.
+	 *
+	 * Offsets are rebased onto the start of words and edge numbers are shifted by firstEdge,
+	 * so every glyph's lists index one edge buffer holding the edges of all of them back to
+	 * back. The header words are left out; the caller keeps cell size, columns and rows.
+	 *
+	 * @param words Buffer to append to.
+	 * @param firstEdge Position of the glyph's first edge in the shared edge buffer.
+	 * @return Index in words of the glyph's first cell offset.
+	 */
+	uint32_t appendStd430(std::vector<uint32_t>& words, uint32_t firstEdge) const;
+
+	float getCellSize() const;
+	uint32_t getColumns() const;
+	uint32_t getRows() const;
+};
+
+#endif // EDGESPATIALINDEX_HPP
@@ -0,0 +1,71 @@
+#include "FontAtlas.hpp"
+#include <algorithm>
+
+bool FontAtlas::isEmpty() const
+{
+	return pages.isEmpty();
+}
+
+void FontAtlas::clear()
+{
+	pageSize = 0;
+	pages.clear();
+	placements.clear();
+}
+
+const AtlasPlacement* FontAtlas::find(uint32_t codePoint) const
+{
+	const auto it = std::lower_bound(placements.begin(), placements.end(), codePoint, [](const AtlasPlacement& placement, uint32_t cp) {
+		return placement.codePoint < cp;
+	});
+	if(it == placements.end() || it->codePoint != codePoint) return nullptr;
+	return &*it;
+}
+
+void FontAtlas::uvRect(const AtlasPlacement& placement, float uv[4]) const
+{
+	const float scale = pageSize ? 1.0f / static_cast<float>(pageSize) : 0.0f;
+	uv[0] = static_cast<float>(placement.x) * scale;
+	uv[1] = static_cast<float>(placement.y) * scale;
+	uv[2] = static_cast<float>(placement.x + placement.width) * scale;
+	uv[3] = static_cast<float>(placement.y + placement.height) * scale;
+}
+
+QDataStream &operator<<(QDataStream &stream, const FontAtlas &atlas) {
+	stream << atlas.pageSize << static_cast<uint32_t>(atlas.pages.size());
+	for(const QByteArray& page : atlas.pages) {
+		stream << static_cast<uint32_t>(page.size());
+		stream.writeRawData(page.constData(), page.size());
+	}
+	stream << static_cast<uint32_t>(atlas.placements.size());
+	for(const AtlasPlacement& placement : atlas.placements) {
+		stream << placement.codePoint << placement.page << placement.x << placement.y << placement.width << placement.height;
+	}
+	return stream;
+}
+
+QDataStream &operator>>(QDataStream &stream, FontAtlas &atlas) {
+	atlas.clear();
+	uint32_t pageCount, placementCount;
+	stream >> atlas.pageSize >> pageCount;
+	for(uint32_t i = 0; i < pageCount && stream.status() == QDataStream::Ok; ++i) {
+		uint32_t pageBytes;
+		stream >> pageBytes;
+		QByteArray page(pageBytes, 0);
+		if(stream.readRawData(page.data(), pageBytes) != static_cast<int>(pageBytes)) {
+			stream.setStatus(QDataStream::ReadPastEnd);
+			break;
+		}
+		atlas.pages.push_back(page);
+	}
+	stream >> placementCount;
+	for(uint32_t i = 0; i < placementCount && stream.status() == QDataStream::Ok; ++i) {
+		AtlasPlacement placement;
+		stream >> placement.codePoint >> placement.page >> placement.x >> placement.y >> placement.width >> placement.height;
+		atlas.placements.push_back(placement);
+	}
+	std::sort(atlas.placements.begin(), atlas.placements.end(), [](const AtlasPlacement& a, const AtlasPlacement& b) {
+		return a.codePoint < b.codePoint;
+	});
+	return stream;
+}
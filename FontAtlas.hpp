@@ -0,0 +1,90 @@
+/**
+ * @file FontAtlas.hpp
+ * @brief Atlas pages of a font face and the placement of each glyph on them.
+ *
+ * Without an atlas every glyph carries its own encoded SDF, so a renderer has to decode
+ * and upload thousands of tiny images and pack them itself. An atlas stores a few large
+ * pages once, with each glyph recorded as a rectangle on one of them.
+ */
+
+#ifndef FONTATLAS_HPP
+#define FONTATLAS_HPP
+#include <QByteArray>
+#include <QDataStream>
+#include <QList>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Location of a glyph on an atlas page.
+ *
+ * The rectangle is in texels, with the origin at the top-left corner of the page. The
+ * UV rectangle is (x, y, x + width, y + height) divided by the page size.
+ *
+ * @struct AtlasPlacement
+ */
+struct AtlasPlacement {
+	uint32_t codePoint;  ///< Unicode code point of the glyph
+	uint32_t page;       ///< Index of the page in FontAtlas::pages
+	uint32_t x;          ///< Left edge in texels
+	uint32_t y;          ///< Top edge in texels
+	uint32_t width;      ///< Width in texels
+	uint32_t height;     ///< Height in texels
+};
+
+/**
+ * @brief Square atlas pages and the glyph placements on them.
+ *
+ * Pages are encoded in the imageFormat of the face, just like per-glyph SDFs. Glyphs with
+ * an empty SDF have no placement.
+ *
+ * @struct FontAtlas
+ */
+struct FontAtlas {
+	uint32_t pageSize = 0;                    ///< Edge length of every page in texels (0 = no atlas)
+	QList<QByteArray> pages;                  ///< Encoded pages
+	std::vector<AtlasPlacement> placements;   ///< Placements, sorted by code point
+
+	/**
+	 * @brief Check whether the face has an atlas.
+	 * @return True if pages were packed.
+	 */
+	bool isEmpty() const;
+
+	/**
+	 * @brief Remove all pages and placements.
+	 */
+	void clear();
+
+	/**
+	 * @brief Find the placement of a glyph.
+	 * @param codePoint Unicode code point.
+	 * @return Pointer to the placement, or nullptr if the glyph is not on a page.
+	 */
+	const AtlasPlacement* find(uint32_t codePoint) const;
+
+	/**
+	 * @brief Get the UV rectangle of a placement.
+	 * @param placement Placement on one of the pages.
+	 * @param uv Receives left, top, right and bottom, normalized to [0, 1].
+	 */
+	void uvRect(const AtlasPlacement& placement, float uv[4]) const;
+};
+
+/**
+ * @brief Serialize a FontAtlas to QDataStream.
+ * @param stream The data stream to write to.
+ * @param atlas The atlas to serialize.
+ * @return Reference to the stream.
+ */
+QDataStream &operator<<(QDataStream &stream, const FontAtlas &atlas);
+
+/**
+ * @brief Deserialize a FontAtlas from QDataStream.
+ * @param stream The data stream to read from.
+ * @param atlas The atlas to populate.
+ * @return Reference to the stream.
+ */
+QDataStream &operator>>(QDataStream &stream, FontAtlas &atlas);
+
+#endif // FONTATLAS_HPP
@@ -0,0 +1,217 @@
+#include "FontKerningReader.hpp"
+#include <algorithm>
+#include <bit>
+#include <harfbuzz/hb-ft.h>
+#include <harfbuzz/hb-ot.h>
+
+/// Bounds-checked big-endian view of a font table; reads past the end yield zero.
+struct TableView {
+	const uint8_t* data;
+	size_t length;
+
+	bool fits(size_t offset, size_t size) const { return offset <= length && size <= length - offset; }
+	uint16_t u16(size_t offset) const { return fits(offset, 2) ? static_cast<uint16_t>((data[offset] << 8) | data[offset + 1]) : 0; }
+	int16_t s16(size_t offset) const { return static_cast<int16_t>(u16(offset)); }
+	uint32_t u32(size_t offset) const { return (static_cast<uint32_t>(u16(offset)) << 16) | u16(offset + 2); }
+};
+
+/// Size in bytes of a GPOS ValueRecord with the given format.
+static size_t valueRecordSize(uint16_t valueFormat)
+{
+	return 2 * std::popcount(static_cast<unsigned>(valueFormat & 0xFF));
+}
+
+/// X advance of a GPOS ValueRecord, or 0 if the format does not carry one.
+static int32_t valueRecordXAdvance(const TableView& table, size_t offset, uint16_t valueFormat)
+{
+	if(!(valueFormat & 0x0004)) return 0;
+	return table.s16(offset + 2 * std::popcount(static_cast<unsigned>(valueFormat & 0x0003)));
+}
+
+/// Call func(glyph, coverageIndex) for every glyph of a Coverage table.
+template <typename Func> static void forEachCovered(const TableView& table, size_t offset, const Func& func)
+{
+	const uint16_t format = table.u16(offset);
+	const uint16_t count = table.u16(offset + 2);
+	if(format == 1) {
+		if(!table.fits(offset + 4, size_t(count) * 2)) return;
+		for(uint16_t i = 0; i < count; ++i) func(table.u16(offset + 4 + i * 2), i);
+	} else if(format == 2) {
+		if(!table.fits(offset + 4, size_t(count) * 6)) return;
+		for(uint16_t i = 0; i < count; ++i) {
+			const size_t record = offset + 4 + i * 6;
+			const uint32_t start = table.u16(record);
+			const uint32_t end = table.u16(record + 2);
+			const uint32_t startIndex = table.u16(record + 4);
+			for(uint32_t glyph = start; glyph <= end; ++glyph) func(glyph, startIndex + glyph - start);
+		}
+	}
+}
+
+/// Class of a glyph in a ClassDef table (0 if it is not listed).
+static uint16_t classOf(const TableView& table, size_t offset, uint32_t glyph)
+{
+	const uint16_t format = table.u16(offset);
+	if(format == 1) {
+		const uint32_t start = table.u16(offset + 2);
+		const uint32_t count = table.u16(offset + 4);
+		return (glyph >= start && glyph - start < count) ? table.u16(offset + 6 + (glyph - start) * 2) : 0;
+	} else if(format == 2) {
+		// Ranges are sorted by start glyph
+		uint32_t lo = 0;
+		uint32_t hi = table.u16(offset + 2);
+		while(lo < hi) {
+			const uint32_t mid = (lo + hi) / 2;
+			const size_t record = offset + 4 + mid * 6;
+			if(glyph < table.u16(record)) hi = mid;
+			else if(glyph > table.u16(record + 2)) lo = mid + 1;
+			else return table.u16(record + 4);
+		}
+	}
+	return 0;
+}
+
+FontKerningReader::FontKerningReader(FT_Face face, const std::vector<bool>& keptGlyphs)
+	: kernTablePresent(false)
+{
+	hb_face_t* hbFace = hb_ft_face_create_referenced(face);
+
+	hb_blob_t* kern = hb_face_reference_table(hbFace, HB_TAG('k','e','r','n'));
+	unsigned int length = 0;
+	const char* data = hb_blob_get_data(kern, &length);
+	if(data && length) readKernTable(reinterpret_cast<const uint8_t*>(data), length, keptGlyphs);
+	hb_blob_destroy(kern);
+
+	hb_set_t* lookups = hb_set_create();
+	const hb_tag_t features[] = { HB_TAG('k','e','r','n'), HB_TAG_NONE };
+	hb_ot_layout_collect_lookups(hbFace, HB_OT_TAG_GPOS, nullptr, nullptr, features, lookups);
+	hb_blob_t* gpos = hb_face_reference_table(hbFace, HB_OT_TAG_GPOS);
+	data = hb_blob_get_data(gpos, &length);
+	if(data && length) {
+		hb_codepoint_t lookupIndex = HB_SET_VALUE_INVALID;
+		while(hb_set_next(lookups, &lookupIndex)) {
+			readGposLookup(reinterpret_cast<const uint8_t*>(data), length, lookupIndex, keptGlyphs);
+		}
+	}
+	hb_blob_destroy(gpos);
+	hb_set_destroy(lookups);
+	hb_face_destroy(hbFace);
+
+	std::erase_if(gposPairs, [](const auto& it) { return it.second == 0; });
+}
+
+void FontKerningReader::readKernTable(const uint8_t* data, size_t length, const std::vector<bool>& keptGlyphs)
+{
+	const TableView table{ data, length };
+	// FreeType only reads the OpenType layout (16-bit version 0), not Apple's 32-bit one
+	if(table.u16(0) != 0) return;
+	kernTablePresent = true;
+	const uint16_t tableCount = table.u16(2);
+	size_t offset = 4;
+	for(uint16_t i = 0; i < tableCount && table.fits(offset, 6); ++i) {
+		const uint16_t subtableLength = table.u16(offset + 2);
+		const uint16_t format = table.u16(offset + 4) >> 8;
+		if(format == 0) {
+			const uint16_t pairCount = table.u16(offset + 6);
+			const size_t pairs = offset + 14;
+			if(!table.fits(pairs, size_t(pairCount) * 6)) break;
+			for(uint16_t p = 0; p < pairCount; ++p) {
+				const uint32_t left = table.u16(pairs + p * 6);
+				const uint32_t right = table.u16(pairs + p * 6 + 2);
+				if(left < keptGlyphs.size() && right < keptGlyphs.size() && keptGlyphs[left] && keptGlyphs[right]) {
+					kernPairs.emplace_back(left, right);
+				}
+			}
+		}
+		// Large format 0 subtables overflow the 16-bit length, so step over the pairs instead
+		offset += format == 0 ? 14 + size_t(table.u16(offset + 6)) * 6 : std::max<size_t>(subtableLength, 6);
+	}
+}
+
+void FontKerningReader::readGposLookup(const uint8_t* data, size_t length, uint32_t lookupIndex, const std::vector<bool>& keptGlyphs)
+{
+	const TableView table{ data, length };
+	auto isKept = [&keptGlyphs](uint32_t glyph) { return glyph < keptGlyphs.size() && keptGlyphs[glyph]; };
+	const size_t lookupList = table.u16(8);
+	if(lookupIndex >= table.u16(lookupList)) return;
+	const size_t lookup = lookupList + table.u16(lookupList + 2 + lookupIndex * 2);
+	const uint16_t lookupType = table.u16(lookup);
+	const uint16_t subtableCount = table.u16(lookup + 4);
+
+	// Pairs seen by this lookup; only the first subtable covering a pair applies
+	std::map<GlyphPair,int32_t> lookupPairs;
+	// Left glyphs claimed by a class-based subtable, which covers every right glyph at once
+	std::vector<bool> classCovered(keptGlyphs.size(), false);
+	for(uint16_t s = 0; s < subtableCount; ++s) {
+		size_t subtable = lookup + table.u16(lookup + 6 + s * 2);
+		if(lookupType == 9) {
+			// Extension lookups wrap the real subtable behind a 32-bit offset
+			if(table.u16(subtable + 2) != 2) continue;
+			subtable += table.u32(subtable + 4);
+		} else if(lookupType != 2) {
+			continue;
+		}
+		const uint16_t format = table.u16(subtable);
+		const size_t coverage = subtable + table.u16(subtable + 2);
+		const uint16_t valueFormat1 = table.u16(subtable + 4);
+		const uint16_t valueFormat2 = table.u16(subtable + 6);
+		const size_t recordSize = valueRecordSize(valueFormat1) + valueRecordSize(valueFormat2);
+
+		if(format == 1) {
+			const uint16_t pairSetCount = table.u16(subtable + 8);
+			forEachCovered(table, coverage, [&](uint32_t first, uint32_t coverageIndex) {
+				if(!isKept(first) || classCovered[first] || coverageIndex >= pairSetCount) return;
+				const size_t pairSet = subtable + table.u16(subtable + 10 + coverageIndex * 2);
+				const uint16_t pairCount = table.u16(pairSet);
+				if(!table.fits(pairSet + 2, size_t(pairCount) * (2 + recordSize))) return;
+				for(uint16_t p = 0; p < pairCount; ++p) {
+					const size_t record = pairSet + 2 + p * (2 + recordSize);
+					const uint32_t second = table.u16(record);
+					if(isKept(second)) lookupPairs.emplace(GlyphPair(first, second), valueRecordXAdvance(table, record + 2, valueFormat1));
+				}
+			});
+		} else if(format == 2) {
+			const size_t classDef1 = subtable + table.u16(subtable + 8);
+			const size_t classDef2 = subtable + table.u16(subtable + 10);
+			const uint16_t class1Count = table.u16(subtable + 12);
+			const uint16_t class2Count = table.u16(subtable + 14);
+			const size_t class1Records = subtable + 16;
+			if(!class2Count || !table.fits(class1Records, size_t(class1Count) * class2Count * recordSize)) continue;
+			// Right-hand glyphs grouped by class, so each defined class pair expands directly into glyph pairs
+			std::vector<std::vector<uint32_t>> keptByClass2(class2Count);
+			for(uint32_t glyph = 0; glyph < keptGlyphs.size(); ++glyph) {
+				if(!keptGlyphs[glyph]) continue;
+				const uint16_t class2 = classOf(table, classDef2, glyph);
+				if(class2 < class2Count) keptByClass2[class2].push_back(glyph);
+			}
+			forEachCovered(table, coverage, [&](uint32_t first, uint32_t) {
+				if(!isKept(first) || classCovered[first]) return;
+				classCovered[first] = true;
+				const uint16_t class1 = classOf(table, classDef1, first);
+				if(class1 >= class1Count) return;
+				for(uint16_t class2 = 0; class2 < class2Count; ++class2) {
+					const size_t record = class1Records + (size_t(class1) * class2Count + class2) * recordSize;
+					const int32_t value = valueRecordXAdvance(table, record, valueFormat1);
+					if(!value) continue;
+					for(const uint32_t second : keptByClass2[class2]) lookupPairs.emplace(GlyphPair(first, second), value);
+				}
+			});
+		}
+	}
+	for(const auto& it : lookupPairs) gposPairs[it.first] += it.second;
+}
+
+bool FontKerningReader::hasKernTable() const
+{
+	return kernTablePresent;
+}
+
+const std::vector<FontKerningReader::GlyphPair>& FontKerningReader::getKernPairs() const
+{
+	return kernPairs;
+}
+
+const std::map<FontKerningReader::GlyphPair,int32_t>& FontKerningReader::getGposPairs() const
+{
+	return gposPairs;
+}
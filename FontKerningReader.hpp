@@ -0,0 +1,79 @@
+/**
+ * @file FontKerningReader.hpp
+ * @brief Reader for the kerning pairs a font actually defines.
+ *
+ * Asking FreeType for the kerning of every pair of glyphs costs glyphs² calls, which
+ * dominates the build of large (CJK) fonts. The pairs a font defines are listed in its
+ * legacy kern table and in the PairPos lookups of the GPOS 'kern' feature, so reading
+ * those directly makes the cost proportional to the number of real pairs.
+ */
+
+#ifndef FONTKERNINGREADER_HPP
+#define FONTKERNINGREADER_HPP
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+/**
+ * @brief Kerning pairs of a font, restricted to a set of glyphs.
+ *
+ * Tables are fetched through HarfBuzz, which also resolves which GPOS lookups belong to
+ * the 'kern' feature. Only pairs whose glyphs are both kept are reported.
+ *
+ * @class FontKerningReader
+ */
+class FontKerningReader {
+public:
+	typedef std::pair<uint32_t,uint32_t> GlyphPair; ///< Left and right glyph index
+
+private:
+	bool kernTablePresent;                       ///< Whether the font has a version 0 kern table
+	std::vector<GlyphPair> kernPairs;            ///< Pairs listed by the format 0 subtables of the kern table
+	std::map<GlyphPair,int32_t> gposPairs;       ///< Horizontal GPOS PairPos adjustments, in font units
+
+	void readKernTable(const uint8_t* data, size_t length, const std::vector<bool>& keptGlyphs);
+	void readGposLookup(const uint8_t* data, size_t length, uint32_t lookupIndex, const std::vector<bool>& keptGlyphs);
+
+public:
+	/**
+	 * @brief Read the kerning pairs of a face.
+	 * @param face FreeType face to read the tables of.
+	 * @param keptGlyphs Glyphs to report pairs for, indexed by glyph index.
+	 */
+	FontKerningReader(FT_Face face, const std::vector<bool>& keptGlyphs);
+
+	/**
+	 * @brief Check whether the pairs of the legacy kern table could be listed.
+	 *
+	 * FT_HAS_KERNING() also holds for formats without a kern table (such as Type 1 fonts
+	 * with AFM metrics), in which case callers have to fall back to probing every pair.
+	 *
+	 * @return True if the font has a kern table in the format FreeType reads.
+	 */
+	bool hasKernTable() const;
+
+	/**
+	 * @brief Get the pairs listed by the legacy kern table.
+	 *
+	 * Their values are left to FT_Get_Kerning(), which already applies the scaling and
+	 * grid fitting of the previous exhaustive search.
+	 *
+	 * @return Pairs of kept glyphs, in table order (possibly with duplicates).
+	 */
+	const std::vector<GlyphPair>& getKernPairs() const;
+
+	/**
+	 * @brief Get the pairs adjusted by the GPOS 'kern' feature.
+	 *
+	 * Within a lookup the first subtable covering a pair wins; adjustments of separate
+	 * lookups add up, as they would when shaping.
+	 *
+	 * @return X advance adjustment of the first glyph of each pair, in font units (never zero).
+	 */
+	const std::map<GlyphPair,int32_t>& getGposPairs() const;
+};
+
+#endif // FONTKERNINGREADER_HPP
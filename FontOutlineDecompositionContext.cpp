@@ -1047,6 +1047,104 @@ int EdgeSegment::scanlineIntersections(double x[], int dy[], double y) const
 	}
 }
 
+#define CUBIC_SEARCH_STARTS 6
+#define CUBIC_SEARCH_STEPS 8
+#define CUBIC_SEARCH_TOLERANCE 1e-6f
+
+glm::fvec2 EdgeSegment::closestPoint(const glm::fvec2& origin, float& param) const
+{
+	auto& p = points;
+	switch (type) {
+		case EdgeType::LINEAR: {
+			const glm::fvec2 ab = p[1]-p[0];
+			const float len2 = glm::dot(ab, ab);
+			param = len2 > 0.0f ? std::clamp(glm::dot(origin-p[0], ab) / len2, 0.0f, 1.0f) : 0.0f;
+			return p[0] + param * ab;
+		}
+		case EdgeType::QUADRATIC: {
+			// Minimize |B(t) - origin|^2, whose derivative is a cubic polynomial in t
+			const glm::fvec2 qa = p[0]-origin;
+			const glm::fvec2 ab = p[1]-p[0];
+			const glm::fvec2 br = p[2]-p[1]-ab;
+			float minDist2 = glm::dot(qa, qa);
+			param = 0.0f;
+			{
+				const glm::fvec2 qb = p[2]-origin;
+				const float dist2 = glm::dot(qb, qb);
+				if (dist2 < minDist2) {
+					minDist2 = dist2;
+					param = 1.0f;
+				}
+			}
+			double t[3];
+			const int solutions = solveCubic(t, glm::dot(br, br), 3*glm::dot(ab, br), 2*glm::dot(ab, ab)+glm::dot(qa, br), glm::dot(qa, ab));
+			for (int i = 0; i < solutions; ++i) {
+				// The same Newton step on each root as closestPointQuadratic() in bezier_solvers.glsl,
+				// so both back ends pick the same points and parameters
+				float ti = static_cast<float>(t[i]);
+				glm::fvec2 qe = qa + 2.0f*ti*ab + ti*ti*br;
+				const glm::fvec2 d1 = ab + ti*br;
+				const float denominator = 2.0f*glm::dot(d1, d1) + glm::dot(qe, br);
+				if (denominator != 0.0f) ti -= glm::dot(qe, d1) / denominator;
+				if (ti > 0.0f && ti < 1.0f) {
+					qe = qa + 2.0f*ti*ab + ti*ti*br;
+					const float dist2 = glm::dot(qe, qe);
+					if (dist2 < minDist2) {
+						minDist2 = dist2;
+						param = ti;
+					}
+				}
+			}
+			return point(param);
+		}
+		case EdgeType::CUBIC: {
+			// The derivative is quintic, so refine a handful of starting guesses with Newton's method
+			const glm::fvec2 qa = p[0]-origin;
+			const glm::fvec2 ab = p[1]-p[0];
+			const glm::fvec2 br = p[2]-p[1]-ab;
+			const glm::fvec2 as = (p[3]-p[2])-(p[2]-p[1])-br;
+			float minDist2 = glm::dot(qa, qa);
+			param = 0.0f;
+			{
+				const glm::fvec2 qb = p[3]-origin;
+				const float dist2 = glm::dot(qb, qb);
+				if (dist2 < minDist2) {
+					minDist2 = dist2;
+					param = 1.0f;
+				}
+			}
+			for (int i = 0; i <= CUBIC_SEARCH_STARTS; ++i) {
+				float t = static_cast<float>(i) / CUBIC_SEARCH_STARTS;
+				glm::fvec2 qe = qa + 3.0f*t*ab + 3.0f*t*t*br + t*t*t*as;
+				for (int step = 0; step < CUBIC_SEARCH_STEPS; ++step) {
+					const glm::fvec2 d1 = 3.0f*ab + 6.0f*t*br + 3.0f*t*t*as;
+					const glm::fvec2 d2 = 6.0f*br + 6.0f*t*as;
+					const float denominator = glm::dot(d1, d1) + glm::dot(qe, d2);
+					if (denominator == 0.0f)
+						break;
+					const float delta = glm::dot(qe, d1) / denominator;
+					t -= delta;
+					if (t <= 0.0f || t >= 1.0f)
+						break;
+					qe = qa + 3.0f*t*ab + 3.0f*t*t*br + t*t*t*as;
+					const float dist2 = glm::dot(qe, qe);
+					if (dist2 < minDist2) {
+						minDist2 = dist2;
+						param = t;
+					}
+					if (std::abs(delta) < CUBIC_SEARCH_TOLERANCE)
+						break;
+				}
+			}
+			return point(param);
+		}
+		default: {
+			param = 0.0f;
+			return p[0];
+		}
+	}
+}
+
 int FontOutlineDecompositionContext::lineTo(const glm::fvec2& to)
 {
 	stagingEdges.resize(stagingEdges.size() + 1);
@@ -1218,6 +1316,27 @@ void FontOutlineDecompositionContext::translateToNewSize(unsigned int nWidth, un
 }
 
 
+void FontOutlineDecompositionContext::translateToOrigin(float originX, float originY)
+{
+	for(auto& it : edges) {
+		for(auto& jt : it.points) {
+			jt.x = jt.x - originX;
+			jt.y = originY - jt.y;
+		}
+	}
+}
+
+
+void FontOutlineDecompositionContext::scale(float scaleX, float scaleY)
+{
+	for(auto& it : edges) {
+		for(auto& jt : it.points) {
+			jt.x *= scaleX;
+			jt.y *= scaleY;
+		}
+	}
+}
+
 bool FontOutlineDecompositionContext::isWithinBoundingBox(unsigned int xOffset, unsigned int yOffset, unsigned int width, unsigned int height)
 {
 	for(const auto& it : edges) {
@@ -208,6 +208,17 @@ struct EdgeSegment {
 	 * @return Number of intersections found.
 	 */
 	int scanlineIntersections(double x[], int dy[3], double y) const;
+
+	/**
+	 * @brief Find the point on the edge closest to a given point.
+	 *
+	 * Lines are projected directly, quadratic curves are solved in closed form
+	 * and cubic curves are refined with a few Newton iterations from several starts.
+	 * @param origin Point to measure from.
+	 * @param param Parameter value of the closest point (output, in [0, 1]).
+	 * @return Closest point on the edge.
+	 */
+	glm::fvec2 closestPoint(const glm::fvec2& origin, float& param) const;
 };
 
 /**
@@ -351,6 +362,24 @@ struct FontOutlineDecompositionContext {
 	 * @param invertY Whether to invert Y coordinates (default: true).
 	 */
 	void translateToNewSize(unsigned nWidth, unsigned nHeight, unsigned paddingX, unsigned paddingY, double metricWidth, double metricHeight, double horiBearingX, double horiBearingY, bool invertY = true);
+
+	/**
+	 * @brief Translate edges onto a pixel grid without scaling them.
+	 *
+	 * Used for tight glyph bounds, where every glyph keeps the scale it was loaded at.
+	 * The point (originX, originY) moves to (0, 0) and Y is flipped to grow downwards.
+	 *
+	 * @param originX X coordinate that becomes the left edge of the canvas.
+	 * @param originY Y coordinate that becomes the top edge of the canvas.
+	 */
+	void translateToOrigin(float originX, float originY);
+
+	/**
+	 * @brief Scale every edge about the origin.
+	 * @param scaleX Horizontal scale factor.
+	 * @param scaleY Vertical scale factor.
+	 */
+	void scale(float scaleX, float scaleY);
 	
 	/**
 	 * @brief Check if edges are within a bounding box.
@@ -0,0 +1,61 @@
+#include "FontPackWriter.hpp"
+#include "Profiler.hpp"
+#include <QIODevice>
+#include <algorithm>
+#include <stdexcept>
+
+FontPackWriter::FontPackWriter(QDataStream& dataStream)
+	: dataStream(dataStream), indexPointerOffset(-1)
+{
+	if(!dataStream.device() || dataStream.device()->isSequential()) throw std::runtime_error("Font packs can only be written to seekable devices!");
+}
+
+void FontPackWriter::writeHeader(const PreprocessedFontFace& face)
+{
+	if(indexPointerOffset >= 0) throw std::runtime_error("Font pack header written twice!");
+	QByteArray utf8str = face.fontFamilyName.toUtf8();
+	dataStream.writeRawData(PreprocessedFontFace::BINARY_MAGIC.data(), PreprocessedFontFace::BINARY_MAGIC.size());
+	dataStream << PreprocessedFontFace::CURRENT_VERSION;
+	dataStream << static_cast<uint32_t>(utf8str.size());
+	dataStream.writeRawData(utf8str.data(),utf8str.length());
+	dataStream << static_cast<uint8_t>(face.type) << static_cast<uint8_t>(face.distType) << face.bitmap_size << face.bitmap_logical_size << face.bitmap_padding << face.hasVert;
+	dataStream.writeRawData(face.imageFormat.data(), face.imageFormat.size());
+	dataStream << face.ascender << face.descender << face.faceHeight << face.maxAdvance << face.unitsPerEm << face.tightBounds;
+	// Placeholder for the offset of the index, patched by finish()
+	indexPointerOffset = dataStream.device()->pos();
+	dataStream << uint64_t(0);
+	if(dataStream.status() != QDataStream::Ok) throw std::runtime_error("Failed to write the font pack header!");
+}
+
+void FontPackWriter::writeGlyph(uint32_t codePoint, const StoredCharacter& character)
+{
+	if(indexPointerOffset < 0) throw std::runtime_error("Font pack glyph written before the header!");
+	Profiler::Scope profileScope("serialization");
+	tableOfContents.emplace_back(codePoint, dataStream.device()->pos());
+	character.toData(dataStream);
+	if(dataStream.status() != QDataStream::Ok) throw std::runtime_error("Failed to write a glyph to the font pack!");
+}
+
+void FontPackWriter::finish(const KerningTable& kerning, const FontAtlas& atlas)
+{
+	if(indexPointerOffset < 0) throw std::runtime_error("Font pack finished before the header was written!");
+	Profiler::Scope profileScope("serialization");
+	// Glyphs arrive in completion order; the index is sorted so readers can binary search it
+	std::sort(tableOfContents.begin(), tableOfContents.end());
+	const uint64_t indexOffset = dataStream.device()->pos();
+	dataStream << static_cast<uint32_t>(tableOfContents.size());
+	for(const auto& it : tableOfContents) {
+		dataStream << it.first << it.second;
+	}
+	dataStream << kerning << atlas;
+	const qint64 end = dataStream.device()->pos();
+	dataStream.device()->seek(indexPointerOffset);
+	dataStream << indexOffset;
+	dataStream.device()->seek(end);
+	if(dataStream.status() != QDataStream::Ok) throw std::runtime_error("Failed to write the font pack index!");
+}
+
+size_t FontPackWriter::glyphCount() const
+{
+	return tableOfContents.size();
+}
@@ -0,0 +1,74 @@
+/**
+ * @file FontPackWriter.hpp
+ * @brief Incremental writer of .wodf font packs.
+ *
+ * PreprocessedFontFace::toData() needs every encoded glyph in memory before the first
+ * byte is written. FontPackWriter instead appends each glyph as soon as it is finished
+ * and only remembers its offset; the table of contents, the kerning and the atlas are written
+ * after the last glyph, and the header is patched to point at them.
+ */
+
+#ifndef FONTPACKWRITER_HPP
+#define FONTPACKWRITER_HPP
+#include <QDataStream>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "PreprocessedFontFace.hpp"
+
+/**
+ * @brief Writes a .wodf pack (current format version) glyph by glyph.
+ *
+ * Call writeHeader() once, then writeGlyph() for each glyph in any order, then finish().
+ * The stream must be set up as Qt_4_0, BigEndian and its device must be seekable.
+ *
+ * @class FontPackWriter
+ */
+class FontPackWriter {
+private:
+	QDataStream& dataStream;                                    ///< Stream being written
+	qint64 indexPointerOffset;                                  ///< Position of the index offset in the header (-1 before writeHeader())
+	std::vector<std::pair<uint32_t,uint64_t>> tableOfContents;  ///< (code point, file offset) of every glyph written so far
+
+	FontPackWriter(const FontPackWriter&) = delete;
+	FontPackWriter& operator=(const FontPackWriter&) = delete;
+
+public:
+	/**
+	 * @brief Attach a writer to a stream.
+	 * @param dataStream Stream to write to (must be Qt_4_0, BigEndian, on a seekable device).
+	 * @throws std::runtime_error If the device cannot seek.
+	 */
+	explicit FontPackWriter(QDataStream& dataStream);
+
+	/**
+	 * @brief Write the header of the pack.
+	 * @param face Face whose metadata (everything but glyphs and kerning) is written.
+	 * @throws std::runtime_error If the header was already written.
+	 */
+	void writeHeader(const PreprocessedFontFace& face);
+
+	/**
+	 * @brief Append a glyph.
+	 * @param codePoint Unicode code point; each may be written only once.
+	 * @param character Glyph to write.
+	 * @throws std::runtime_error If the header is missing or the write fails.
+	 */
+	void writeGlyph(uint32_t codePoint, const StoredCharacter& character);
+
+	/**
+	 * @brief Write the table of contents, kerning and atlas, and patch the header to point at them.
+	 * @param kerning Kerning of the face.
+	 * @param atlas Atlas pages of the face (empty if glyphs carry their own SDFs).
+	 * @throws std::runtime_error If the header is missing or the write fails.
+	 */
+	void finish(const KerningTable& kerning, const FontAtlas& atlas = FontAtlas());
+
+	/**
+	 * @brief Get the number of glyphs written so far.
+	 * @return Number of glyphs.
+	 */
+	size_t glyphCount() const;
+};
+
+#endif // FONTPACKWRITER_HPP
@@ -16,18 +16,32 @@ DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs depr
 SOURCES += \
         CQTOpenGLLuaSyntaxHighlighter.cpp \
         ConstStrings.cpp \
+        EdgeSpatialIndex.cpp \
+        FontAtlas.cpp \
+        FontKerningReader.cpp \
         FontOutlineDecompositionContext.cpp \
+        FontPackWriter.cpp \
         GlHelpers.cpp \
+        GlyphCache.cpp \
+        GlyphTable.cpp \
         HugePreallocator.cpp \
+        KerningTable.cpp \
         MainWindow.cpp \
+        MappedFontFace.cpp \
+        MipPyramid.cpp \
         OpenGLCanvas.cpp \
         PreprocessedFontFace.cpp \
+        Profiler.cpp \
         SDFGenerationArguments.cpp \
+        SdfEncodeStage.cpp \
         SdfGenerationContext.cpp \
         SdfGenerationContextSoft.cpp \
         SdfGenerationGL.cpp \
+        SdfQuantizer.cpp \
+        SkylinePacker.cpp \
         StoredCharacter.cpp \
         StoredVectorImage.cpp \
+        TexelCodec.cpp \
         main.cpp
 
 # Default rules for deployment.
@@ -39,8 +53,14 @@ DISTFILES += \
     .gitignore \
     LICENSE \
     README.md \
+    bezier_solvers.glsl \
+    jump_flood.glsl \
+    jump_flood_seed.glsl \
     msdf_fixer.glsl \
+    outline_common.glsl \
     screen.vert.glsl \
+    sdf_pack.glsl \
+    sdf_reduce.glsl \
     shader1.glsl \
     shader3.glsl \
     shader3_msdf.glsl \
@@ -49,20 +69,34 @@ DISTFILES += \
 HEADERS += \
     CQTOpenGLLuaSyntaxHighlighter.hpp \
     ConstStrings.hpp \
+    EdgeSpatialIndex.hpp \
+    FontAtlas.hpp \
+    FontKerningReader.hpp \
     FontOutlineDecompositionContext.hpp \
+    FontPackWriter.hpp \
     GlHelpers.hpp \
+    GlyphCache.hpp \
+    GlyphTable.hpp \
     HugePreallocator.hpp \
+    KerningTable.hpp \
     MainWindow.hpp \
     Mallocator.hpp \
+    MappedFontFace.hpp \
+    MipPyramid.hpp \
     OpenGLCanvas.hpp \
     PreprocessedFontFace.hpp \
+    Profiler.hpp \
     RGBA8888.hpp \
     SDFGenerationArguments.hpp \
+    SdfEncodeStage.hpp \
     SdfGenerationContext.hpp \
     SdfGenerationContextSoft.hpp \
     SdfGenerationGL.hpp \
+    SdfQuantizer.hpp \
+    SkylinePacker.hpp \
     StoredCharacter.hpp \
-    StoredVectorImage.hpp
+    StoredVectorImage.hpp \
+    TexelCodec.hpp
 
 RESOURCES += \
     resources.qrc
@@ -391,8 +391,61 @@ void GlStorageBuffer::initialize(GLsizeiptr size, const void* data)
 	glFuncs->glBufferData(target, size, data,  GL_DYNAMIC_DRAW);
 }
 
+void GlStorageBuffer::upload(GLsizeiptr size, const void* data)
+{
+	if(static_cast<size_t>(size) > this->size) initialize(size, data);
+	else modify(0, size, data);
+}
+
 void GlStorageBuffer::modify(GLintptr offset, GLsizeiptr size, const void* data)
 {
 	bind();
 	glFuncs->glBufferSubData(target, offset, size, data);
 }
+
+GlPixelBuffer::GlPixelBuffer(QOpenGLFunctions* glFuncs, QOpenGLExtraFunctions* extraFuncs)
+	: size(0), glFuncs(glFuncs), extraFuncs(extraFuncs)
+{
+	glFuncs->glGenBuffers(1,&buffId);
+}
+
+GlPixelBuffer::~GlPixelBuffer()
+{
+	if(buffId) {
+		glFuncs->glDeleteBuffers(1,&buffId);
+	}
+}
+
+void GlPixelBuffer::readFrom(const GlTexture& texture)
+{
+	const size_t bytes = static_cast<size_t>(texture.getWidth()) * static_cast<size_t>(texture.getHeight()) * texture.getBytesPerPixel();
+	glFuncs->glBindBuffer(GL_PIXEL_PACK_BUFFER, buffId);
+	if(bytes > size) {
+		glFuncs->glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+		size = bytes;
+	}
+	// With a pack buffer bound, the pointer is an offset into it and the call returns without waiting
+	texture.getTexture(nullptr);
+	glFuncs->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+const void* GlPixelBuffer::map(size_t bytes)
+{
+	glFuncs->glBindBuffer(GL_PIXEL_PACK_BUFFER, buffId);
+	const void* data = extraFuncs->glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+	glFuncs->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	if(!data) throw std::runtime_error("Failed to map the pixel buffer!");
+	return data;
+}
+
+void GlPixelBuffer::unmap()
+{
+	glFuncs->glBindBuffer(GL_PIXEL_PACK_BUFFER, buffId);
+	extraFuncs->glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	glFuncs->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+size_t GlPixelBuffer::getSize() const
+{
+	return size;
+}
@@ -396,6 +396,26 @@ public:
 		initialize(sizeof(T), static_cast<const void*>(&data));
 	}
 	
+	/**
+	 * @brief Replace the start of the buffer, reallocating only when the data does not fit.
+	 *
+	 * Unlike initialize(), which orphans the storage on every call, a buffer refilled for
+	 * each dispatch keeps its storage once it has grown to the largest upload.
+	 *
+	 * @param size Number of bytes to upload.
+	 * @param data Source data.
+	 */
+	void upload(GLsizeiptr size, const void* data);
+	
+	/**
+	 * @brief Replace the start of the buffer with a span of data (see upload()).
+	 * @tparam T Element type.
+	 * @param data Span of data to copy.
+	 */
+	template <typename T> void uploadFromSpan(const std::span<const T>& data) {
+		upload(data.size_bytes(), data.data());
+	}
+	
 	/**
 	 * @brief Modify a portion of the buffer.
 	 * @param offset Byte offset into the buffer.
@@ -441,4 +461,62 @@ public:
 	GLuint getBuffId() const;
 };
 
+/**
+ * @brief RAII wrapper for a pixel pack buffer (PBO) that reads textures back asynchronously.
+ * @class GlPixelBuffer
+ *
+ * readFrom() only queues the copy of a texture into the buffer and returns at once; the
+ * data can be mapped once a fence placed after the copy is signalled. Non-copyable.
+ */
+class GlPixelBuffer {
+private:
+	size_t size;                       ///< Allocated size in bytes
+	GLuint buffId;                     ///< OpenGL buffer ID
+	QOpenGLFunctions* glFuncs;         ///< OpenGL functions pointer
+	QOpenGLExtraFunctions* extraFuncs; ///< OpenGL extra functions pointer
+	GlPixelBuffer(const GlPixelBuffer& cpy) = delete;
+	GlPixelBuffer& operator=(const GlPixelBuffer& cpy) = delete;
+
+public:
+	/**
+	 * @brief Constructor.
+	 * @param glFuncs OpenGL functions pointer.
+	 * @param extraFuncs OpenGL extra functions pointer.
+	 */
+	GlPixelBuffer(QOpenGLFunctions* glFuncs, QOpenGLExtraFunctions* extraFuncs);
+
+	/**
+	 * @brief Destructor - deletes OpenGL buffer.
+	 */
+	~GlPixelBuffer();
+
+	/**
+	 * @brief Queue a copy of a whole texture, in its native format, into the buffer.
+	 *
+	 * The buffer grows to fit the texture and keeps its storage afterwards.
+	 *
+	 * @param texture Texture to read.
+	 */
+	void readFrom(const GlTexture& texture);
+
+	/**
+	 * @brief Map the start of the buffer for reading; blocks until pending copies are done.
+	 * @param bytes Number of bytes to map.
+	 * @return Pointer to the data, valid until unmap().
+	 * @throws std::runtime_error If the buffer cannot be mapped.
+	 */
+	const void* map(size_t bytes);
+
+	/**
+	 * @brief Unmap the buffer after map().
+	 */
+	void unmap();
+
+	/**
+	 * @brief Get buffer size.
+	 * @return Size in bytes.
+	 */
+	size_t getSize() const;
+};
+
 #endif // GLHELPERS_HPP
@@ -0,0 +1,111 @@
+#include "GlyphCache.hpp"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <stdexcept>
+
+/// Part of every key; bump it whenever the engines change their output for the same input.
+#define GLYPH_CACHE_VERSION 4u
+#define GLYPH_CACHE_SUFFIX ".glyph"
+
+/// Same stream settings as the binary font output, so entries round-trip exactly.
+static void setupStream(QDataStream& stream)
+{
+	stream.setVersion(QDataStream::Qt_4_0);
+	stream.setByteOrder(QDataStream::BigEndian);
+}
+
+GlyphCache::GlyphCache(const QString& directory, qint64 maxBytes)
+	: directory(directory), maxBytes(maxBytes), hits(0), misses(0), evicted(0), totalBytes(0)
+{
+	if(!QDir().mkpath(directory)) throw std::runtime_error("Failed to create the glyph cache directory!");
+}
+
+QString GlyphCache::entryPath(const QByteArray& key) const
+{
+	return QDir(directory).filePath(QString::fromLatin1(key) + QStringLiteral(GLYPH_CACHE_SUFFIX));
+}
+
+QByteArray GlyphCache::outlineKey(const StoredCharacter& metrics, const FontOutlineDecompositionContext& decomposition, const SDFGenerationArguments& args)
+{
+	QByteArray material;
+	QDataStream stream(&material, QIODevice::WriteOnly);
+	setupStream(stream);
+	stream << GLYPH_CACHE_VERSION;
+	// Arguments that change the pixels or their encoding
+	stream << static_cast<uint32_t>(args.mode) << static_cast<uint32_t>(args.type) << static_cast<uint32_t>(args.distType)
+		   << args.internalProcessSize << args.intendedSize << args.padding << args.samples_to_check_x << args.samples_to_check_y
+		   << args.msdfgenColouring << args.invert << args.imageFormat << args.forceRaster << args.gammaCorrect
+		   << args.maximizeInsteadOfAverage << args.midpointAdjustment.has_value() << args.midpointAdjustment.value_or(0.0f)
+		   << args.distanceTransform << args.tightBounds << args.supersample;
+	// Metrics are restored from the entry too, so a font revision that only moves them must miss
+	stream << metrics.width << metrics.height << metrics.bearing_x << metrics.bearing_y << metrics.advance_x << metrics.advance_y
+		   << metrics.metricWidth << metrics.metricHeight << metrics.horiBearingX << metrics.horiBearingY << metrics.horiAdvance
+		   << metrics.vertBearingX << metrics.vertBearingY << metrics.vertAdvance;
+	stream << static_cast<uint32_t>(decomposition.edges.size());
+	for(const EdgeSegment& edge : decomposition.edges) {
+		stream << static_cast<int32_t>(edge.type) << edge.contourId << edge.clr;
+		for(const glm::fvec2& point : edge.points) stream << point.x << point.y;
+	}
+	return QCryptographicHash::hash(material, QCryptographicHash::Sha256).toHex();
+}
+
+bool GlyphCache::load(const QByteArray& key, StoredCharacter& output)
+{
+	QFile file(entryPath(key));
+	if(!file.open(QFile::ReadOnly)) {
+		++misses;
+		return false;
+	}
+	StoredCharacter cached{};
+	QDataStream stream(&file);
+	setupStream(stream);
+	stream >> cached;
+	if(stream.status() != QDataStream::Ok || !cached.valid) {
+		++misses;
+		return false;
+	}
+	// The modification time doubles as the last use for evict()
+	file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+	output = cached;
+	++hits;
+	return true;
+}
+
+void GlyphCache::store(const QByteArray& key, const StoredCharacter& character)
+{
+	QSaveFile file(entryPath(key));
+	if(!file.open(QIODevice::WriteOnly)) return;
+	QDataStream stream(&file);
+	setupStream(stream);
+	stream << character;
+	// A cache that cannot be written only costs speed, so failures are not errors
+	if(stream.status() == QDataStream::Ok) file.commit();
+	else file.cancelWriting();
+}
+
+void GlyphCache::evict()
+{
+	const QFileInfoList entries = QDir(directory).entryInfoList({ QStringLiteral("*" GLYPH_CACHE_SUFFIX) }, QDir::Files, QDir::Time);
+	totalBytes = 0;
+	evicted = 0;
+	// Newest first: keep entries until the limit is reached, then drop everything older
+	bool full = false;
+	for(const QFileInfo& entry : entries) {
+		full = full || totalBytes + entry.size() > maxBytes;
+		if(full && QFile::remove(entry.filePath())) ++evicted;
+		else totalBytes += entry.size();
+	}
+}
+
+QString GlyphCache::report() const
+{
+	return QStringLiteral("Glyph cache: %1 hits, %2 misses, %3 evicted, %4 of %5 MiB used")
+		.arg(hits.load()).arg(misses.load()).arg(evicted)
+		.arg(static_cast<double>(totalBytes) / (1024.0 * 1024.0), 0, 'f', 1)
+		.arg(static_cast<double>(maxBytes) / (1024.0 * 1024.0), 0, 'f', 1);
+}
@@ -0,0 +1,90 @@
+/**
+ * @file GlyphCache.hpp
+ * @brief Content-addressed on-disk cache of generated glyphs.
+ *
+ * Rebuilding a font after a small change regenerates every glyph, although most of
+ * them come out byte-identical. The cache stores each finished StoredCharacter under a
+ * hash of everything that determines it: the decomposed outline, the glyph metrics and
+ * the generation arguments that affect pixels. A hit skips the distance engine entirely.
+ */
+
+#ifndef GLYPHCACHE_HPP
+#define GLYPHCACHE_HPP
+#include <QByteArray>
+#include <QString>
+#include <atomic>
+#include <cstdint>
+#include "FontOutlineDecompositionContext.hpp"
+#include "SDFGenerationArguments.hpp"
+#include "StoredCharacter.hpp"
+
+/**
+ * @brief Directory of cached glyphs with a least-recently-used size limit.
+ *
+ * Each entry is a single file named after its key, so lookups and stores from several
+ * worker threads never touch the same state. Reading an entry refreshes its modification
+ * time, which evict() uses as the recency of the entry.
+ *
+ * @class GlyphCache
+ */
+class GlyphCache {
+private:
+	QString directory;                     ///< Directory holding the entries
+	qint64 maxBytes;                       ///< Size limit enforced by evict()
+	std::atomic<uint32_t> hits;            ///< Entries found by load()
+	std::atomic<uint32_t> misses;          ///< Entries not found by load()
+	uint32_t evicted;                      ///< Entries removed by the last evict()
+	qint64 totalBytes;                     ///< Size of the cache after the last evict()
+
+	QString entryPath(const QByteArray& key) const;
+
+public:
+	/**
+	 * @brief Open (and create if needed) a cache directory.
+	 * @param directory Directory holding the entries.
+	 * @param maxBytes Size limit in bytes.
+	 * @throws std::runtime_error If the directory cannot be created.
+	 */
+	GlyphCache(const QString& directory, qint64 maxBytes);
+
+	/**
+	 * @brief Compute the key of an outline glyph.
+	 *
+	 * Must be called after the outline has been translated and coloured, right before the
+	 * distance engine runs, with the metrics of the output already filled in.
+	 *
+	 * @param metrics Character whose metrics (everything but the SDF) are part of the key.
+	 * @param decomposition Decomposed outline of the glyph.
+	 * @param args Generation arguments; only the fields that affect pixels are hashed.
+	 * @return Hexadecimal SHA-256 key.
+	 */
+	static QByteArray outlineKey(const StoredCharacter& metrics, const FontOutlineDecompositionContext& decomposition, const SDFGenerationArguments& args);
+
+	/**
+	 * @brief Look up an entry.
+	 * @param key Key from outlineKey().
+	 * @param output Character to overwrite with the cached one on a hit.
+	 * @return True on a hit.
+	 */
+	bool load(const QByteArray& key, StoredCharacter& output);
+
+	/**
+	 * @brief Store an entry (atomically, so concurrent readers never see half a file).
+	 * @param key Key from outlineKey().
+	 * @param character Finished character to store.
+	 */
+	void store(const QByteArray& key, const StoredCharacter& character);
+
+	/**
+	 * @brief Delete the least recently used entries until the cache fits its size limit.
+	 */
+	void evict();
+
+	/**
+	 * @brief Describe the hits, misses and evictions of this run.
+	 * @return One-line report.
+	 */
+	QString report() const;
+};
+
+#endif // GLYPHCACHE_HPP
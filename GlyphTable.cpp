@@ -0,0 +1,122 @@
+#include "GlyphTable.hpp"
+#include <algorithm>
+
+#define BMP_PAGE_SIZE 256
+#define NO_GLYPH UINT32_MAX
+
+GlyphTable::GlyphTable()
+	: bmpPages(BMP_PAGE_SIZE, NO_GLYPH)
+{
+
+}
+
+void GlyphTable::clear()
+{
+	codePoints.clear();
+	metrics.clear();
+	sdfRanges.clear();
+	arena.clear();
+	bmpDirectory.fill(0);
+	bmpPages.assign(BMP_PAGE_SIZE, NO_GLYPH);
+}
+
+void GlyphTable::reserve(size_t glyphs, qsizetype sdfBytes)
+{
+	codePoints.reserve(glyphs);
+	metrics.reserve(glyphs);
+	sdfRanges.reserve(glyphs);
+	if(sdfBytes > 0) arena.reserve(sdfBytes);
+}
+
+void GlyphTable::indexCodePoint(size_t index)
+{
+	const uint32_t codePoint = codePoints[index];
+	if(codePoint > 0xFFFF) return;
+	uint16_t& page = bmpDirectory[codePoint >> 8];
+	if(!page) {
+		page = static_cast<uint16_t>(bmpPages.size() / BMP_PAGE_SIZE);
+		bmpPages.resize(bmpPages.size() + BMP_PAGE_SIZE, NO_GLYPH);
+	}
+	bmpPages[size_t(page) * BMP_PAGE_SIZE + (codePoint & 0xFF)] = static_cast<uint32_t>(index);
+}
+
+void GlyphTable::rebuildIndex()
+{
+	bmpDirectory.fill(0);
+	bmpPages.assign(BMP_PAGE_SIZE, NO_GLYPH);
+	for(size_t i = 0; i < codePoints.size() && codePoints[i] <= 0xFFFF; ++i) indexCodePoint(i);
+}
+
+void GlyphTable::insert(uint32_t codePoint, const StoredCharacter& character)
+{
+	const auto position = std::lower_bound(codePoints.begin(), codePoints.end(), codePoint);
+	const size_t index = position - codePoints.begin();
+	const SdfRange range{ arena.size(), static_cast<uint32_t>(character.sdf.size()) };
+	arena.append(character.sdf);
+	if(position != codePoints.end() && *position == codePoint) {
+		metrics[index] = character;
+		sdfRanges[index] = range;
+		return;
+	}
+	const bool appending = position == codePoints.end();
+	codePoints.insert(position, codePoint);
+	metrics.insert(metrics.begin() + index, character);
+	sdfRanges.insert(sdfRanges.begin() + index, range);
+	// Inserting in the middle shifts the indices of every later glyph
+	if(appending) indexCodePoint(index);
+	else rebuildIndex();
+}
+
+size_t GlyphTable::size() const
+{
+	return codePoints.size();
+}
+
+bool GlyphTable::isEmpty() const
+{
+	return codePoints.empty();
+}
+
+size_t GlyphTable::indexOf(uint32_t codePoint) const
+{
+	if(codePoint <= 0xFFFF) {
+		const uint32_t index = bmpPages[size_t(bmpDirectory[codePoint >> 8]) * BMP_PAGE_SIZE + (codePoint & 0xFF)];
+		return index == NO_GLYPH ? npos : index;
+	}
+	const auto position = std::lower_bound(codePoints.begin(), codePoints.end(), codePoint);
+	return (position != codePoints.end() && *position == codePoint) ? size_t(position - codePoints.begin()) : npos;
+}
+
+bool GlyphTable::contains(uint32_t codePoint) const
+{
+	return indexOf(codePoint) != npos;
+}
+
+uint32_t GlyphTable::codePointAt(size_t index) const
+{
+	return codePoints[index];
+}
+
+const GlyphMetrics& GlyphTable::metricsAt(size_t index) const
+{
+	return metrics[index];
+}
+
+QByteArrayView GlyphTable::sdfAt(size_t index) const
+{
+	const SdfRange& range = sdfRanges[index];
+	return QByteArrayView(arena.constData() + range.offset, range.length);
+}
+
+StoredCharacter GlyphTable::at(size_t index) const
+{
+	StoredCharacter character;
+	static_cast<GlyphMetrics&>(character) = metrics[index];
+	character.sdf = sdfAt(index).toByteArray();
+	return character;
+}
+
+std::span<const uint32_t> GlyphTable::getCodePoints() const
+{
+	return codePoints;
+}
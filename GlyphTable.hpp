@@ -0,0 +1,139 @@
+/**
+ * @file GlyphTable.hpp
+ * @brief Contiguous, sorted storage of the glyphs of a font face.
+ *
+ * A QMap of StoredCharacter costs a node and an SDF allocation per glyph, and every
+ * lookup walks a tree. GlyphTable keeps the code points in one sorted array with the
+ * metrics in a parallel array, and appends all SDF bytes to a single arena. Lookups in
+ * the Basic Multilingual Plane go through a two-level page table (two array reads);
+ * other code points are found by binary search.
+ */
+
+#ifndef GLYPHTABLE_HPP
+#define GLYPHTABLE_HPP
+#include <QByteArray>
+#include <QByteArrayView>
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "StoredCharacter.hpp"
+
+/**
+ * @brief Sorted table of glyphs, keyed by Unicode code point.
+ *
+ * Glyphs are addressed by their index in code point order, which stays stable as long
+ * as no glyph is inserted in the middle of the table. Inserting in ascending order (as
+ * every loader and the generator do) only appends.
+ *
+ * @class GlyphTable
+ */
+class GlyphTable {
+public:
+	static constexpr size_t npos = SIZE_MAX; ///< Returned by indexOf() for missing code points
+
+private:
+	/// Location of the SDF bytes of a glyph in the arena.
+	struct SdfRange {
+		qsizetype offset;
+		uint32_t length;
+	};
+
+	std::vector<uint32_t> codePoints;              ///< Code points in ascending order
+	std::vector<GlyphMetrics> metrics;             ///< Metrics, parallel to codePoints
+	std::vector<SdfRange> sdfRanges;               ///< SDF location, parallel to codePoints
+	QByteArray arena;                              ///< SDF bytes of every glyph, back to back
+	std::array<uint16_t,256> bmpDirectory{};       ///< Page of bmpPages per high byte of a BMP code point (0 = empty page)
+	std::vector<uint32_t> bmpPages;                ///< Pages of 256 glyph indices; page 0 is always empty
+
+	void indexCodePoint(size_t index);
+	void rebuildIndex();
+
+public:
+	GlyphTable();
+
+	/**
+	 * @brief Remove every glyph and release the arena.
+	 */
+	void clear();
+
+	/**
+	 * @brief Reserve room for a number of glyphs.
+	 * @param glyphs Expected number of glyphs.
+	 * @param sdfBytes Expected total size of their SDF data.
+	 */
+	void reserve(size_t glyphs, qsizetype sdfBytes = 0);
+
+	/**
+	 * @brief Insert or replace a glyph.
+	 *
+	 * The SDF bytes are copied into the arena. Replacing a glyph leaves its old bytes in
+	 * the arena until clear().
+	 *
+	 * @param codePoint Unicode code point.
+	 * @param character Glyph to store.
+	 */
+	void insert(uint32_t codePoint, const StoredCharacter& character);
+
+	/**
+	 * @brief Get the number of glyphs.
+	 * @return Number of glyphs.
+	 */
+	size_t size() const;
+
+	/**
+	 * @brief Check whether the table holds no glyphs.
+	 * @return True if empty.
+	 */
+	bool isEmpty() const;
+
+	/**
+	 * @brief Find the index of a code point.
+	 * @param codePoint Unicode code point.
+	 * @return Index of the glyph, or npos.
+	 */
+	size_t indexOf(uint32_t codePoint) const;
+
+	/**
+	 * @brief Check whether the table holds a glyph for a code point.
+	 * @param codePoint Unicode code point.
+	 * @return True if present.
+	 */
+	bool contains(uint32_t codePoint) const;
+
+	/**
+	 * @brief Get the code point of a glyph.
+	 * @param index Glyph index.
+	 * @return Unicode code point.
+	 */
+	uint32_t codePointAt(size_t index) const;
+
+	/**
+	 * @brief Get the metrics of a glyph.
+	 * @param index Glyph index.
+	 * @return Metrics, valid until the table is modified.
+	 */
+	const GlyphMetrics& metricsAt(size_t index) const;
+
+	/**
+	 * @brief Get the SDF bytes of a glyph without copying them.
+	 * @param index Glyph index.
+	 * @return View borrowing the arena, valid until the table is modified.
+	 */
+	QByteArrayView sdfAt(size_t index) const;
+
+	/**
+	 * @brief Get a glyph as a StoredCharacter.
+	 * @param index Glyph index.
+	 * @return Character owning a copy of the SDF bytes.
+	 */
+	StoredCharacter at(size_t index) const;
+
+	/**
+	 * @brief Get every code point of the table.
+	 * @return Code points in ascending order.
+	 */
+	std::span<const uint32_t> getCodePoints() const;
+};
+
+#endif // GLYPHTABLE_HPP
@@ -0,0 +1,111 @@
+#include "KerningTable.hpp"
+#include <algorithm>
+
+KerningTable::KerningTable()
+	: rowStarts(1, 0)
+{
+
+}
+
+void KerningTable::clear()
+{
+	firsts.clear();
+	rowStarts.assign(1, 0);
+	seconds.clear();
+	values.clear();
+}
+
+void KerningTable::assign(std::vector<Entry> entries)
+{
+	clear();
+	// Stable, so the first entry given for a pair comes first among its duplicates
+	std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+		return a.first != b.first ? a.first < b.first : a.second < b.second;
+	});
+	seconds.reserve(entries.size());
+	values.reserve(entries.size());
+	for(size_t i = 0; i < entries.size(); ++i) {
+		const Entry& entry = entries[i];
+		if(i && entries[i - 1].first == entry.first && entries[i - 1].second == entry.second) continue;
+		if(firsts.empty() || firsts.back() != entry.first) {
+			if(!firsts.empty()) rowStarts.push_back(static_cast<uint32_t>(seconds.size()));
+			firsts.push_back(entry.first);
+		}
+		seconds.push_back(entry.second);
+		values.push_back(entry.kerning);
+	}
+	if(!firsts.empty()) rowStarts.push_back(static_cast<uint32_t>(seconds.size()));
+}
+
+bool KerningTable::isEmpty() const
+{
+	return seconds.empty();
+}
+
+size_t KerningTable::pairCount() const
+{
+	return seconds.size();
+}
+
+size_t KerningTable::rowCount() const
+{
+	return firsts.size();
+}
+
+uint32_t KerningTable::rowCodePoint(size_t row) const
+{
+	return firsts[row];
+}
+
+std::span<const uint32_t> KerningTable::rowSeconds(size_t row) const
+{
+	return std::span<const uint32_t>(seconds).subspan(rowStarts[row], rowStarts[row + 1] - rowStarts[row]);
+}
+
+std::span<const Vec2f> KerningTable::rowValues(size_t row) const
+{
+	return std::span<const Vec2f>(values).subspan(rowStarts[row], rowStarts[row + 1] - rowStarts[row]);
+}
+
+std::optional<Vec2f> KerningTable::find(uint32_t first, uint32_t second) const
+{
+	const auto row = std::lower_bound(firsts.begin(), firsts.end(), first);
+	if(row == firsts.end() || *row != first) return std::nullopt;
+	const size_t rowIndex = row - firsts.begin();
+	const auto rowBegin = seconds.begin() + rowStarts[rowIndex];
+	const auto rowEnd = seconds.begin() + rowStarts[rowIndex + 1];
+	const auto pair = std::lower_bound(rowBegin, rowEnd, second);
+	if(pair == rowEnd || *pair != second) return std::nullopt;
+	return values[pair - seconds.begin()];
+}
+
+QDataStream &operator<<(QDataStream &stream, const KerningTable &kerning) {
+	stream << static_cast<uint32_t>(kerning.rowCount());
+	for(size_t row = 0; row < kerning.rowCount(); ++row) {
+		const std::span<const uint32_t> seconds = kerning.rowSeconds(row);
+		const std::span<const Vec2f> values = kerning.rowValues(row);
+		stream << kerning.rowCodePoint(row) << static_cast<uint32_t>(seconds.size());
+		for(size_t i = 0; i < seconds.size(); ++i) {
+			stream << seconds[i] << values[i];
+		}
+	}
+	return stream;
+}
+
+QDataStream &operator>>(QDataStream &stream, KerningTable &kerning) {
+	std::vector<KerningTable::Entry> entries;
+	uint32_t rowCount;
+	stream >> rowCount;
+	for(uint32_t row = 0; row < rowCount && stream.status() == QDataStream::Ok; ++row) {
+		uint32_t first, pairCount;
+		stream >> first >> pairCount;
+		for(uint32_t i = 0; i < pairCount && stream.status() == QDataStream::Ok; ++i) {
+			KerningTable::Entry entry;
+			entry.first = first;
+			stream >> entry.second >> entry.kerning;
+			entries.push_back(entry);
+		}
+	}
+	kerning.assign(std::move(entries));
+	return stream;
+}
@@ -0,0 +1,128 @@
+/**
+ * @file KerningTable.hpp
+ * @brief Flat, sorted storage of the kerning pairs of a font face.
+ *
+ * Kerning used to be a QMap of QMaps, which costs a node per pair and two tree walks
+ * per lookup. KerningTable stores one row per first code point, with the second code
+ * points and kerning vectors of all rows packed into two parallel arrays.
+ */
+
+#ifndef KERNINGTABLE_HPP
+#define KERNINGTABLE_HPP
+#include <QDataStream>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief 2D vector type represented as a pair of floats.
+ * @typedef Vec2f
+ */
+typedef std::pair<float,float> Vec2f;
+
+/**
+ * @brief Kerning pairs, grouped into rows by first code point.
+ *
+ * Rows are sorted by first code point and the pairs of a row by second code point, so
+ * iterating rows and pairs in order yields the pairs in the order of the binary format.
+ *
+ * @class KerningTable
+ */
+class KerningTable {
+public:
+	/**
+	 * @brief A single kerning pair, as handed to assign().
+	 */
+	struct Entry {
+		uint32_t first;        ///< Code point of the left character
+		uint32_t second;       ///< Code point of the right character
+		Vec2f kerning;         ///< Kerning offset
+	};
+
+private:
+	std::vector<uint32_t> firsts;        ///< First code point of each row, ascending
+	std::vector<uint32_t> rowStarts;     ///< Start of each row in seconds/values, plus the end of the last row
+	std::vector<uint32_t> seconds;       ///< Second code points, ascending within each row
+	std::vector<Vec2f> values;           ///< Kerning vectors, parallel to seconds
+
+public:
+	KerningTable();
+
+	/**
+	 * @brief Remove every pair.
+	 */
+	void clear();
+
+	/**
+	 * @brief Replace the contents of the table.
+	 * @param entries Pairs in any order. Of several entries for the same pair, the first one is kept.
+	 */
+	void assign(std::vector<Entry> entries);
+
+	/**
+	 * @brief Check whether the table holds no pairs.
+	 * @return True if empty.
+	 */
+	bool isEmpty() const;
+
+	/**
+	 * @brief Get the number of pairs.
+	 * @return Number of pairs.
+	 */
+	size_t pairCount() const;
+
+	/**
+	 * @brief Get the number of rows (distinct first code points).
+	 * @return Number of rows.
+	 */
+	size_t rowCount() const;
+
+	/**
+	 * @brief Get the first code point of a row.
+	 * @param row Row index.
+	 * @return Code point of the left character.
+	 */
+	uint32_t rowCodePoint(size_t row) const;
+
+	/**
+	 * @brief Get the second code points of a row.
+	 * @param row Row index.
+	 * @return Code points of the right characters, ascending.
+	 */
+	std::span<const uint32_t> rowSeconds(size_t row) const;
+
+	/**
+	 * @brief Get the kerning vectors of a row.
+	 * @param row Row index.
+	 * @return Kerning vectors, parallel to rowSeconds().
+	 */
+	std::span<const Vec2f> rowValues(size_t row) const;
+
+	/**
+	 * @brief Look up the kerning of a pair.
+	 * @param first Code point of the left character.
+	 * @param second Code point of the right character.
+	 * @return Kerning offset, or nothing if the pair is not kerned.
+	 */
+	std::optional<Vec2f> find(uint32_t first, uint32_t second) const;
+};
+
+/**
+ * @brief Serialize KerningTable to QDataStream (the KerningMap of BINARY_FORMAT.md).
+ * @param stream The data stream to write to.
+ * @param kerning The kerning table to serialize.
+ * @return Reference to the stream.
+ */
+QDataStream &operator<<(QDataStream &stream, const KerningTable &kerning);
+
+/**
+ * @brief Deserialize KerningTable from QDataStream (the KerningMap of BINARY_FORMAT.md).
+ * @param stream The data stream to read from.
+ * @param kerning The kerning table to populate.
+ * @return Reference to the stream.
+ */
+QDataStream &operator>>(QDataStream &stream, KerningTable &kerning);
+
+#endif // KERNINGTABLE_HPP
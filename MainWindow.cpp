@@ -110,8 +110,8 @@ void MainWindow::onFontHasBeenLoaded()
 	glyphsVector.clear();
 	ui->selectGlyphComboBox1->clear();
 	ui->selectGlyphComboBox2->clear();
-	for(auto it = std::begin(font_face->storedCharacters); it != std::end(font_face->storedCharacters); ++it) {
-		glyphsVector.push_back(it.key());
+	for(const uint32_t codePoint : font_face->storedCharacters.getCodePoints()) {
+		glyphsVector.push_back(codePoint);
 	}
 	for(const auto it : glyphsVector) {
 		ui->selectGlyphComboBox1->addItem(QString::number(it), it);
@@ -235,13 +235,13 @@ void MainWindow::on_selectGlyphComboBox2_currentIndexChanged(int index)
 	ui->selectGlyphArrowRight2->setEnabled( ui->selectGlyphComboBox2->currentIndex() < (ui->selectGlyphComboBox2->count()-1)  );
 	if( font_face != nullptr && index >= 0 ) {
 		// Let's display the image!
-		auto it = font_face->storedCharacters.find(glyphsVector[index]);
-		if( it != std::end(font_face->storedCharacters)) {
-			ui->glyphShowLabel->setPixmap( QPixmap::fromImage( QImage::fromData( it.value().sdf ) ) );
+		const size_t glyph = font_face->storedCharacters.indexOf(glyphsVector[index]);
+		if( glyph != GlyphTable::npos) {
+			ui->glyphShowLabel->setPixmap( QPixmap::fromImage( font_face->glyphImage(glyph) ) );
 		}
 	} else if ( vector_face != nullptr && index >= 0 )
 	{
-		ui->glyphShowLabel->setPixmap( QPixmap::fromImage( QImage::fromData( vector_face->mipmaps[index] ) ) );
+		ui->glyphShowLabel->setPixmap( QPixmap::fromImage( vector_face->mipmapImage(index) ) );
 	}
 }
 
@@ -252,13 +252,13 @@ void MainWindow::on_selectGlyphComboBox1_currentIndexChanged(int index)
 	ui->selectGlyphArrowRight1->setEnabled( ui->selectGlyphComboBox1->currentIndex() < (ui->selectGlyphComboBox1->count()-1)  );
 	if(index >= 0) {
 		if(font_face) {
-		auto it = font_face->storedCharacters.find(glyphsVector[index]);
-		if( it != std::end(font_face->storedCharacters)) {
-			ui->openGLWidget->addTexture(QImage::fromData(it->sdf));
+		const size_t glyph = font_face->storedCharacters.indexOf(glyphsVector[index]);
+		if( glyph != GlyphTable::npos) {
+			ui->openGLWidget->addTexture(font_face->glyphImage(glyph));
 			repaintGl();
 		}
 		} else if(vector_face) {
-			ui->openGLWidget->addTexture(QImage::fromData(vector_face->mipmaps[index]));
+			ui->openGLWidget->addTexture(vector_face->mipmapImage(index));
 			repaintGl();
 		}
 	}
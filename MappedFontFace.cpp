@@ -0,0 +1,119 @@
+#include "MappedFontFace.hpp"
+#include <QBuffer>
+#include <QDataStream>
+#include <QtEndian>
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+/// Size of a valid StoredCharacter record before its SDF bytes (see BINARY_FORMAT.md).
+#define GLYPH_RECORD_HEADER_SIZE 61
+
+static uint32_t readU32(const uint8_t* data)
+{
+	return qFromBigEndian<quint32>(data);
+}
+
+static int32_t readS32(const uint8_t* data)
+{
+	return static_cast<int32_t>(readU32(data));
+}
+
+static float readFloat(const uint8_t* data)
+{
+	return std::bit_cast<float>(readU32(data));
+}
+
+StoredCharacter MappedGlyph::toStoredCharacter() const
+{
+	StoredCharacter character;
+	static_cast<GlyphMetrics&>(character) = *this;
+	character.sdf = QByteArray(reinterpret_cast<const char*>(sdf.data()), static_cast<qsizetype>(sdf.size()));
+	return character;
+}
+
+MappedFontFace::MappedFontFace(const QString& path)
+	: file(path), mapping(nullptr), mappingSize(0)
+{
+	if(!file.open(QFile::ReadOnly)) throw std::runtime_error("Failed to open the font pack!");
+	mappingSize = file.size();
+	mapping = file.map(0, mappingSize);
+	if(!mapping) throw std::runtime_error("Failed to map the font pack into memory!");
+
+	// The header goes through the regular deserializer, over the mapping rather than a copy
+	QByteArray raw = QByteArray::fromRawData(reinterpret_cast<const char*>(mapping), mappingSize);
+	QBuffer buffer(&raw);
+	buffer.open(QIODevice::ReadOnly);
+	QDataStream stream(&buffer);
+	stream.setVersion(QDataStream::Qt_4_0);
+	stream.setByteOrder(QDataStream::BigEndian);
+	face.headerFromData(stream, tableOfContents);
+	if(stream.status() != QDataStream::Ok) throw std::runtime_error("Truncated font pack header!");
+	std::sort(tableOfContents.begin(), tableOfContents.end());
+}
+
+MappedFontFace::~MappedFontFace()
+{
+	if(mapping) file.unmap(const_cast<uint8_t*>(mapping));
+}
+
+const PreprocessedFontFace& MappedFontFace::getFace() const
+{
+	return face;
+}
+
+size_t MappedFontFace::glyphCount() const
+{
+	return tableOfContents.size();
+}
+
+std::vector<uint32_t> MappedFontFace::codePoints() const
+{
+	std::vector<uint32_t> toReturn;
+	toReturn.reserve(tableOfContents.size());
+	for(const auto& it : tableOfContents) toReturn.push_back(it.first);
+	return toReturn;
+}
+
+static bool entryBefore(const std::pair<uint32_t,uint64_t>& entry, uint32_t codePoint)
+{
+	return entry.first < codePoint;
+}
+
+bool MappedFontFace::contains(uint32_t codePoint) const
+{
+	auto it = std::lower_bound(tableOfContents.begin(), tableOfContents.end(), codePoint, entryBefore);
+	return it != tableOfContents.end() && it->first == codePoint;
+}
+
+std::optional<MappedGlyph> MappedFontFace::glyph(uint32_t codePoint) const
+{
+	auto it = std::lower_bound(tableOfContents.begin(), tableOfContents.end(), codePoint, entryBefore);
+	if(it == tableOfContents.end() || it->first != codePoint) return std::nullopt;
+	if(it->second >= static_cast<uint64_t>(mappingSize)) throw std::runtime_error("Glyph offset points past the end of the font pack!");
+	const qint64 offset = static_cast<qint64>(it->second);
+	const uint8_t* record = mapping + offset;
+	if(!record[0]) return std::nullopt;
+	if(offset + GLYPH_RECORD_HEADER_SIZE > mappingSize) throw std::runtime_error("Truncated glyph record in font pack!");
+
+	MappedGlyph glyph;
+	glyph.valid = true;
+	glyph.width = readU32(record + 1);
+	glyph.height = readU32(record + 5);
+	glyph.bearing_x = readS32(record + 9);
+	glyph.bearing_y = readS32(record + 13);
+	glyph.advance_x = readU32(record + 17);
+	glyph.advance_y = readU32(record + 21);
+	glyph.metricWidth = readFloat(record + 25);
+	glyph.metricHeight = readFloat(record + 29);
+	glyph.horiBearingX = readFloat(record + 33);
+	glyph.horiBearingY = readFloat(record + 37);
+	glyph.horiAdvance = readFloat(record + 41);
+	glyph.vertBearingX = readFloat(record + 45);
+	glyph.vertBearingY = readFloat(record + 49);
+	glyph.vertAdvance = readFloat(record + 53);
+	const uint32_t sdfLength = readU32(record + 57);
+	if(offset + GLYPH_RECORD_HEADER_SIZE + sdfLength > mappingSize) throw std::runtime_error("Truncated glyph record in font pack!");
+	glyph.sdf = std::span<const uint8_t>(record + GLYPH_RECORD_HEADER_SIZE, sdfLength);
+	return glyph;
+}
@@ -0,0 +1,105 @@
+/**
+ * @file MappedFontFace.hpp
+ * @brief Read-only, memory-mapped view of a .wodf font pack.
+ *
+ * PreprocessedFontFace::fromData() copies every glyph of a pack into memory before
+ * returning, so opening a large CJK pack costs its full size in RAM and load time.
+ * MappedFontFace maps the file instead and only parses the header, the glyph table of
+ * contents and the kerning; glyphs are decoded on demand straight from the mapping.
+ */
+
+#ifndef MAPPEDFONTFACE_HPP
+#define MAPPEDFONTFACE_HPP
+#include <QFile>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+#include "PreprocessedFontFace.hpp"
+
+/**
+ * @brief Metrics and encoded SDF of a single glyph of a mapped pack.
+ *
+ * The metrics are decoded from the mapping when the glyph is looked up; sdf points
+ * straight into the mapping and stays valid for as long as the MappedFontFace lives.
+ *
+ * @struct MappedGlyph
+ */
+struct MappedGlyph : GlyphMetrics {
+	std::span<const uint8_t> sdf;  ///< Encoded SDF image, inside the mapping
+
+	/**
+	 * @brief Copy the glyph into an owning StoredCharacter.
+	 * @return Character with the same metrics and a copy of the SDF bytes.
+	 */
+	StoredCharacter toStoredCharacter() const;
+};
+
+/**
+ * @brief Memory-mapped .wodf pack with on-demand glyph access.
+ *
+ * The face metadata and kerning are available through getFace(), whose storedCharacters
+ * stays empty. Glyphs are found by binary search in the table of contents.
+ *
+ * @class MappedFontFace
+ */
+class MappedFontFace {
+private:
+	QFile file;                                                 ///< Mapped file
+	const uint8_t* mapping;                                     ///< Start of the mapping
+	qint64 mappingSize;                                         ///< Size of the mapping in bytes
+	PreprocessedFontFace face;                                  ///< Header and kerning (no glyphs)
+	std::vector<std::pair<uint32_t,uint64_t>> tableOfContents;  ///< (code point, file offset), sorted by code point
+
+	MappedFontFace(const MappedFontFace&) = delete;
+	MappedFontFace& operator=(const MappedFontFace&) = delete;
+
+public:
+	/**
+	 * @brief Map a pack and parse its header, table of contents and kerning.
+	 * @param path Path to the .wodf file.
+	 * @throws std::runtime_error If the file cannot be mapped or is not a valid pack.
+	 */
+	explicit MappedFontFace(const QString& path);
+
+	/**
+	 * @brief Unmap the file. Spans returned by glyph() become invalid.
+	 */
+	~MappedFontFace();
+
+	/**
+	 * @brief Get the face metadata and kerning.
+	 * @return Face with every field but storedCharacters filled in.
+	 */
+	const PreprocessedFontFace& getFace() const;
+
+	/**
+	 * @brief Get the number of glyphs in the pack.
+	 * @return Number of table of contents entries.
+	 */
+	size_t glyphCount() const;
+
+	/**
+	 * @brief Get the code points of the pack.
+	 * @return Code points in ascending order.
+	 */
+	std::vector<uint32_t> codePoints() const;
+
+	/**
+	 * @brief Check whether the pack has a glyph for a code point.
+	 * @param codePoint Unicode code point.
+	 * @return True if the table of contents lists it.
+	 */
+	bool contains(uint32_t codePoint) const;
+
+	/**
+	 * @brief Decode a glyph from the mapping.
+	 * @param codePoint Unicode code point.
+	 * @return The glyph, or nothing if the pack does not contain a valid glyph for it.
+	 * @throws std::runtime_error If the glyph record extends past the end of the file.
+	 */
+	std::optional<MappedGlyph> glyph(uint32_t codePoint) const;
+};
+
+#endif // MAPPEDFONTFACE_HPP
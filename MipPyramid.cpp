@@ -0,0 +1,188 @@
+#include "MipPyramid.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(__AVX2__)
+#define MIP_PYRAMID_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIP_PYRAMID_SSE2
+#include <emmintrin.h>
+#endif
+
+/// Rows of levels start on this boundary, so vector loads of a row never split a cache line needlessly.
+#define LEVEL_ALIGNMENT 32
+/// Below this many destination rows, the threads cost more than they save.
+#define PARALLEL_MIN_ROWS 128
+
+static inline uint8_t average4(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+	return static_cast<uint8_t>((static_cast<unsigned>(a) + b + c + d + 2) / 4);
+}
+
+static inline uint8_t average2(uint8_t a, uint8_t b) {
+	return static_cast<uint8_t>((static_cast<unsigned>(a) + b + 1) / 2);
+}
+
+template <bool Maximize> static void halveGrayscaleRow(const uint8_t* row0, const uint8_t* row1, uint8_t* out, int width)
+{
+	int x = 0;
+#if defined(MIP_PYRAMID_AVX2)
+	const __m256i lowBytes = _mm256_set1_epi16(0x00FF);
+	const __m256i two = _mm256_set1_epi16(2);
+	for(; x + 32 <= width; x += 32) {
+		const __m256i a0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row0 + 2 * x));
+		const __m256i a1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row0 + 2 * x + 32));
+		const __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row1 + 2 * x));
+		const __m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row1 + 2 * x + 32));
+		__m256i lo, hi;
+		if constexpr (Maximize) {
+			const __m256i m0 = _mm256_max_epu8(a0, b0);
+			const __m256i m1 = _mm256_max_epu8(a1, b1);
+			lo = _mm256_and_si256(_mm256_max_epu8(m0, _mm256_srli_epi16(m0, 8)), lowBytes);
+			hi = _mm256_and_si256(_mm256_max_epu8(m1, _mm256_srli_epi16(m1, 8)), lowBytes);
+		} else {
+			auto pairSums = [&](__m256i v) { return _mm256_add_epi16(_mm256_and_si256(v, lowBytes), _mm256_srli_epi16(v, 8)); };
+			lo = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(pairSums(a0), pairSums(b0)), two), 2);
+			hi = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(pairSums(a1), pairSums(b1)), two), 2);
+		}
+		// packus works per 128-bit lane, so the quarters come out as 0, 2, 1, 3
+		const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), _MM_SHUFFLE(3, 1, 2, 0));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x), packed);
+	}
+#elif defined(MIP_PYRAMID_SSE2)
+	const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+	const __m128i two = _mm_set1_epi16(2);
+	for(; x + 16 <= width; x += 16) {
+		const __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + 2 * x));
+		const __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + 2 * x + 16));
+		const __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + 2 * x));
+		const __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + 2 * x + 16));
+		__m128i lo, hi;
+		if constexpr (Maximize) {
+			const __m128i m0 = _mm_max_epu8(a0, b0);
+			const __m128i m1 = _mm_max_epu8(a1, b1);
+			lo = _mm_and_si128(_mm_max_epu8(m0, _mm_srli_epi16(m0, 8)), lowBytes);
+			hi = _mm_and_si128(_mm_max_epu8(m1, _mm_srli_epi16(m1, 8)), lowBytes);
+		} else {
+			auto pairSums = [&](__m128i v) { return _mm_add_epi16(_mm_and_si128(v, lowBytes), _mm_srli_epi16(v, 8)); };
+			lo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(pairSums(a0), pairSums(b0)), two), 2);
+			hi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(pairSums(a1), pairSums(b1)), two), 2);
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm_packus_epi16(lo, hi));
+	}
+#endif
+	for(; x < width; ++x) {
+		const uint8_t in00 = row0[2 * x];
+		const uint8_t in01 = row0[2 * x + 1];
+		const uint8_t in10 = row1[2 * x];
+		const uint8_t in11 = row1[2 * x + 1];
+		out[x] = Maximize ? std::max(std::max(in00, in01), std::max(in10, in11)) : average4(in00, in01, in10, in11);
+	}
+}
+
+template <bool Maximize> static void halveRgbaRow(const uint8_t* row0, const uint8_t* row1, uint8_t* out, int width)
+{
+	int x = 0;
+#if defined(MIP_PYRAMID_AVX2)
+	const __m256i evensFirst = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+	auto combine = [](__m256i a, __m256i b) { return Maximize ? _mm256_max_epu8(a, b) : _mm256_avg_epu8(a, b); };
+	// Reduce 16 source pixels to 8: left and right pixels of each pair go to separate registers
+	auto halveHorizontally = [&](const uint8_t* row) {
+		const __m256i p0 = _mm256_permutevar8x32_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(row)), evensFirst);
+		const __m256i p1 = _mm256_permutevar8x32_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + 32)), evensFirst);
+		return combine(_mm256_permute2x128_si256(p0, p1, 0x20), _mm256_permute2x128_si256(p0, p1, 0x31));
+	};
+	for(; x + 8 <= width; x += 8) {
+		const __m256i top = halveHorizontally(row0 + 8 * x);
+		const __m256i bottom = halveHorizontally(row1 + 8 * x);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 4 * x), combine(top, bottom));
+	}
+#elif defined(MIP_PYRAMID_SSE2)
+	auto combine = [](__m128i a, __m128i b) { return Maximize ? _mm_max_epu8(a, b) : _mm_avg_epu8(a, b); };
+	// Reduce 8 source pixels to 4: left and right pixels of each pair go to separate registers
+	auto halveHorizontally = [&](const uint8_t* row) {
+		const __m128i p0 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row)), _MM_SHUFFLE(3, 1, 2, 0));
+		const __m128i p1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + 16)), _MM_SHUFFLE(3, 1, 2, 0));
+		return combine(_mm_unpacklo_epi64(p0, p1), _mm_unpackhi_epi64(p0, p1));
+	};
+	for(; x + 4 <= width; x += 4) {
+		const __m128i top = halveHorizontally(row0 + 8 * x);
+		const __m128i bottom = halveHorizontally(row1 + 8 * x);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4 * x), combine(top, bottom));
+	}
+#endif
+	for(; x < width; ++x) {
+		for(int c = 0; c < 4; ++c) {
+			const uint8_t in00 = row0[8 * x + c];
+			const uint8_t in01 = row0[8 * x + 4 + c];
+			const uint8_t in10 = row1[8 * x + c];
+			const uint8_t in11 = row1[8 * x + 4 + c];
+			out[4 * x + c] = Maximize ? std::max(std::max(in00, in01), std::max(in10, in11))
+									  : average2(average2(in00, in01), average2(in10, in11));
+		}
+	}
+}
+
+template <bool Maximize> static void halveRows(const uint8_t* src, qsizetype srcStride, uint8_t* dst, qsizetype dstStride, int width, int height, bool rgba)
+{
+	auto halveRow = [=](int y) {
+		const uint8_t* row0 = src + (2 * y) * srcStride;
+		const uint8_t* row1 = row0 + srcStride;
+		uint8_t* out = dst + y * dstStride;
+		if(rgba) halveRgbaRow<Maximize>(row0, row1, out, width);
+		else halveGrayscaleRow<Maximize>(row0, row1, out, width);
+	};
+	// Not an OpenMP if clause: even a team of one costs more than halving a small level
+	if(height >= PARALLEL_MIN_ROWS) {
+#pragma omp parallel for
+		for(int y = 0; y < height; ++y) halveRow(y);
+	} else {
+		for(int y = 0; y < height; ++y) halveRow(y);
+	}
+}
+
+void MipPyramid::halve(const uint8_t* src, qsizetype srcStride, uint8_t* dst, qsizetype dstStride, int width, int height, QImage::Format format, bool maximize)
+{
+	const bool rgba = format == QImage::Format_RGBA8888;
+	if(maximize) halveRows<true>(src, srcStride, dst, dstStride, width, height, rgba);
+	else halveRows<false>(src, srcStride, dst, dstStride, width, height, rgba);
+}
+
+MipPyramid::MipPyramid(const QImage& source, bool maximize, size_t maxLevels)
+	: format(source.format())
+{
+	if(format != QImage::Format_Grayscale8 && format != QImage::Format_RGBA8888) {
+		throw std::runtime_error("Mip pyramids can only be built from Grayscale8 and RGBA8888 images.");
+	}
+	const qsizetype bytesPerPixel = format == QImage::Format_RGBA8888 ? 4 : 1;
+	// Level 0 is the source itself, shared rather than copied
+	levels.push_back({ source.width(), source.height(), source.bytesPerLine(), 0 });
+	size_t bufferSize = 0;
+	while((!maxLevels || levels.size() < maxLevels) && levels.back().width > 1 && levels.back().height > 1) {
+		Level next;
+		next.width = levels.back().width / 2;
+		next.height = levels.back().height / 2;
+		next.stride = (next.width * bytesPerPixel + 3) / 4 * 4;
+		next.offset = bufferSize;
+		bufferSize += (static_cast<size_t>(next.stride) * next.height + LEVEL_ALIGNMENT - 1) / LEVEL_ALIGNMENT * LEVEL_ALIGNMENT;
+		levels.push_back(next);
+	}
+	buffer.reset(new uint8_t[bufferSize]);
+	base = source;
+	for(size_t i = 1; i < levels.size(); ++i) {
+		const uint8_t* src = i == 1 ? base.constBits() : buffer.get() + levels[i - 1].offset;
+		halve(src, levels[i - 1].stride, buffer.get() + levels[i].offset, levels[i].stride, levels[i].width, levels[i].height, format, maximize);
+	}
+}
+
+size_t MipPyramid::levelCount() const
+{
+	return levels.size();
+}
+
+QImage MipPyramid::level(size_t level) const
+{
+	if(!level) return base;
+	const Level& it = levels[level];
+	return QImage(static_cast<const uint8_t*>(buffer.get()) + it.offset, it.width, it.height, it.stride, format);
+}
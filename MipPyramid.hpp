@@ -0,0 +1,86 @@
+/**
+ * @file MipPyramid.hpp
+ * @brief 2x2 box and max downsampling of SDF images into a single preallocated pyramid.
+ *
+ * Every glyph is rendered large and halved several times, and vector images may keep every
+ * level as a mipmap. Allocating a QImage per level and reducing one pixel at a time made
+ * this a visible part of the generation time. The kernels here process whole scanlines
+ * with SSE2 (or AVX2 when the compiler targets it) and write all levels into one buffer.
+ */
+
+#ifndef MIPPYRAMID_HPP
+#define MIPPYRAMID_HPP
+#include <QImage>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief All halvings of an SDF image, stored in one buffer.
+ *
+ * Level 0 is the source image itself, shared rather than copied; level i + 1 halves level
+ * i, dropping the last row and column of odd-sized levels. Averaging rounds to nearest:
+ * Grayscale8 texels are (a + b + c + d + 2) / 4, RGBA8888 channels average the horizontal
+ * pairs, then the two results, each rounded up, as RGBA8888::averageWith() does.
+ *
+ * Only Grayscale8 and RGBA8888 images are supported.
+ *
+ * @class MipPyramid
+ */
+class MipPyramid {
+private:
+	/// Placement of one level in the buffer.
+	struct Level {
+		int width;
+		int height;
+		qsizetype stride;   ///< Bytes per row, a multiple of 4 as QImage requires
+		size_t offset;      ///< Byte offset of the first row
+	};
+
+	QImage::Format format;          ///< Format of every level
+	QImage base;                    ///< Level 0
+	std::unique_ptr<uint8_t[]> buffer;  ///< Every other level, one after the other (left uninitialized)
+	std::vector<Level> levels;      ///< Levels, largest first
+
+public:
+	/**
+	 * @brief Build the pyramid of an image.
+	 * @param source Grayscale8 or RGBA8888 image.
+	 * @param maximize Take the maximum of each 2x2 block instead of the average.
+	 * @param maxLevels Number of levels to build at most, including level 0 (0 = until a side reaches 1).
+	 * @throws std::runtime_error if the image format is not supported.
+	 */
+	MipPyramid(const QImage& source, bool maximize, size_t maxLevels = 0);
+
+	/**
+	 * @brief Get the number of levels.
+	 * @return Level count, at least 1.
+	 */
+	size_t levelCount() const;
+
+	/**
+	 * @brief Get a level as an image.
+	 *
+	 * The image shares the pyramid's memory, so it must not outlive the pyramid; call
+	 * QImage::copy() to keep it longer.
+	 *
+	 * @param level Level index, 0 being the source size.
+	 * @return Read-only image of the level.
+	 */
+	QImage level(size_t level) const;
+
+	/**
+	 * @brief Halve an image into another one.
+	 * @param src Pointer to the first row of the source.
+	 * @param srcStride Bytes per source row.
+	 * @param dst Pointer to the first row of the destination, at least width x height texels.
+	 * @param dstStride Bytes per destination row.
+	 * @param width Destination width in texels.
+	 * @param height Destination height in texels.
+	 * @param format Grayscale8 or RGBA8888.
+	 * @param maximize Take the maximum of each 2x2 block instead of the average.
+	 */
+	static void halve(const uint8_t* src, qsizetype srcStride, uint8_t* dst, qsizetype dstStride, int width, int height, QImage::Format format, bool maximize);
+};
+
+#endif // MIPPYRAMID_HPP
@@ -5,13 +5,13 @@
  * Implements conversion between PreprocessedFontFace structures and:
  * - CBOR format (for JSON-like serialization)
  * - Binary QDataStream format (see BINARY_FORMAT.md)
- * 
- * Also implements kerning map serialization operators.
  */
 
 #include "PreprocessedFontFace.hpp"
 #include "StoredCharacter.hpp"
 #include "ConstStrings.hpp"
+#include "FontPackWriter.hpp"
+#include "SkylinePacker.hpp"
 #include <harfbuzz/hb-ft.h>
 #include <QTextStream>
 #include <ft2build.h>
@@ -29,6 +29,13 @@
 #include <QBitArray>
 #include <QCborArray>
 
+/// First format version with 64-bit glyph offsets and the index after the glyph data.
+#define INDEX_AT_END_VERSION 2
+/// First format version with atlas pages after the kerning.
+#define ATLAS_VERSION 3
+/// First format version with the tight glyph bounds flag in the header.
+#define TIGHT_BOUNDS_VERSION 4
+
 namespace {
 
 void validatePreprocessedFontFaceVersion(uint32_t version)
@@ -72,23 +79,47 @@ void PreprocessedFontFace::toCbor(QCborMap& cbor) const
 	cbor.insert(FACE_HEIGHT_KEY, faceHeight);
 	cbor.insert(MAX_ADVANCE_KEY, maxAdvance);
 	cbor.insert(UNITS_PER_EM_KEY, unitsPerEm);
+	cbor.insert(TIGHT_BOUNDS_KEY, tightBounds);
 	QCborMap tmpMap;
-	for(auto it = std::begin(storedCharacters); it != std::end(storedCharacters); ++it) {
-		tmpMap.insert(it.key(),it.value().toCbor());
+	for(size_t i = 0; i < storedCharacters.size(); ++i) {
+		tmpMap.insert(storedCharacters.codePointAt(i),storedCharacters.at(i).toCbor());
 	}
 	cbor.insert(GLYPHS_KEY, tmpMap);
 	QCborMap kerningMap;
-	for(auto it = std::begin(kerning) ; it != std::end(kerning) ; ++it ) {
+	for(size_t row = 0; row < kerning.rowCount(); ++row) {
+		const std::span<const uint32_t> seconds = kerning.rowSeconds(row);
+		const std::span<const Vec2f> values = kerning.rowValues(row);
 		QCborMap kerningMap2;
-		for(auto zt = std::begin(it.value()) ; zt != std::end(it.value()) ; ++zt ) {
+		for(size_t i = 0; i < seconds.size(); ++i) {
 			QCborArray arr;
-			arr.push_back(zt.value().first);
-			arr.push_back(zt.value().second);
-			kerningMap2.insert(zt.key(),arr);
+			arr.push_back(values[i].first);
+			arr.push_back(values[i].second);
+			kerningMap2.insert(seconds[i],arr);
 		}
-		kerningMap.insert(it.key(),kerningMap2);
+		kerningMap.insert(kerning.rowCodePoint(row),kerningMap2);
 	}
 	cbor.insert(KERNING_KEY, kerningMap);
+	if(!atlas.isEmpty()) {
+		QCborMap atlasMap;
+		QCborArray pageArray;
+		QCborMap placementMap;
+		for(const QByteArray& page : atlas.pages) {
+			pageArray.push_back(page);
+		}
+		for(const AtlasPlacement& placement : atlas.placements) {
+			QCborArray arr;
+			arr.push_back(placement.page);
+			arr.push_back(placement.x);
+			arr.push_back(placement.y);
+			arr.push_back(placement.width);
+			arr.push_back(placement.height);
+			placementMap.insert(placement.codePoint, arr);
+		}
+		atlasMap.insert(ATLAS_PAGE_SIZE_KEY, atlas.pageSize);
+		atlasMap.insert(ATLAS_PAGES_KEY, pageArray);
+		atlasMap.insert(ATLAS_PLACEMENTS_KEY, placementMap);
+		cbor.insert(ATLAS_KEY, atlasMap);
+	}
 }
 
 QCborMap PreprocessedFontFace::toCbor() const
@@ -116,7 +147,10 @@ void PreprocessedFontFace::fromCbor(const QCborMap& cbor)
 	this->faceHeight = cbor[FACE_HEIGHT_KEY].toDouble();
 	this->maxAdvance = cbor[MAX_ADVANCE_KEY].toDouble();
 	this->unitsPerEm = cbor[UNITS_PER_EM_KEY].toInteger();
+	this->tightBounds = cbor[TIGHT_BOUNDS_KEY].toBool(false);
 	QCborMap tmpMap = cbor[GLYPHS_KEY].toMap();
+	storedCharacters.clear();
+	storedCharacters.reserve(tmpMap.size());
 	for(auto it = std::begin(tmpMap); it != std::end(tmpMap); ++it) {
 		unsigned charCode = it.key().toInteger();
 		StoredCharacter storedChar;
@@ -124,47 +158,64 @@ void PreprocessedFontFace::fromCbor(const QCborMap& cbor)
 		storedCharacters.insert(charCode, storedChar);
 	}
 	QCborMap kerningMap = cbor[KERNING_KEY].toMap();
+	std::vector<KerningTable::Entry> kerningEntries;
 	for(auto it = std::begin(kerningMap) ; it != std::end(kerningMap) ; ++it ) {
 		QCborMap kerningMap2 = it.value().toMap();
-		PerCharacterKerning perCharKern;
 		for(auto zt = std::begin(kerningMap2) ; zt != std::end(kerningMap2) ; ++zt ) {
 			QCborArray arr = zt->toArray();
 			Vec2f tmpVec = { arr[0].toDouble(), arr[1].toDouble() };
-			perCharKern.insert(zt.key().toInteger(),tmpVec);
+			kerningEntries.push_back({ static_cast<uint32_t>(it.key().toInteger()), static_cast<uint32_t>(zt.key().toInteger()), tmpVec });
 		}
-		kerning.insert(it.key().toInteger(),perCharKern);
+	}
+	kerning.assign(std::move(kerningEntries));
+	atlas.clear();
+	if(cbor.contains(ATLAS_KEY)) {
+		QCborMap atlasMap = cbor[ATLAS_KEY].toMap();
+		atlas.pageSize = atlasMap[ATLAS_PAGE_SIZE_KEY].toInteger();
+		QCborArray pageArray = atlasMap[ATLAS_PAGES_KEY].toArray();
+		for(const auto& page : pageArray) {
+			atlas.pages.push_back(page.toByteArray());
+		}
+		QCborMap placementMap = atlasMap[ATLAS_PLACEMENTS_KEY].toMap();
+		for(auto it = std::begin(placementMap); it != std::end(placementMap); ++it) {
+			QCborArray arr = it.value().toArray();
+			atlas.placements.push_back({ static_cast<uint32_t>(it.key().toInteger()), static_cast<uint32_t>(arr[0].toInteger()),
+				static_cast<uint32_t>(arr[1].toInteger()), static_cast<uint32_t>(arr[2].toInteger()),
+				static_cast<uint32_t>(arr[3].toInteger()), static_cast<uint32_t>(arr[4].toInteger()) });
+		}
+		std::sort(atlas.placements.begin(), atlas.placements.end(), [](const AtlasPlacement& a, const AtlasPlacement& b) {
+			return a.codePoint < b.codePoint;
+		});
 	}
 }
 
 void PreprocessedFontFace::toData(QDataStream& dataStream) const
 {
-	QByteArray utf8str = this->fontFamilyName.toUtf8();
-	dataStream.writeRawData(BINARY_MAGIC.data(), BINARY_MAGIC.size());
-	dataStream << version;
-	dataStream << static_cast<uint32_t>(utf8str.size());
-	dataStream.writeRawData(utf8str.data(),utf8str.length());
-	dataStream << static_cast<uint8_t>(type) << static_cast<uint8_t>(distType) << bitmap_size << bitmap_logical_size << bitmap_padding << hasVert;
-	dataStream.writeRawData(imageFormat.data(), imageFormat.size());
-	dataStream << ascender << descender << faceHeight << maxAdvance << unitsPerEm << static_cast<uint32_t>(storedCharacters.size());
-	// Write table of contents
-	QMap<uint32_t,uint32_t> offsets;
-	auto currOffset = dataStream.device()->pos();
-	for(qsizetype i = 0; i < storedCharacters.size(); ++i) {
-		dataStream << uint32_t(0) << uint32_t(0);
-	}
-	dataStream << kerning;
-	for(auto it = std::begin(storedCharacters); it != std::end(storedCharacters); ++it) {
-		auto glyphOffset = dataStream.device()->pos();
-		offsets.insert(it.key(), glyphOffset);
-		it->toData(dataStream);
-	}
-	dataStream.device()->seek(currOffset);
-	for(auto it = std::begin(offsets); it != std::end(offsets); ++it) {
-		dataStream << it.key() << it.value();
+	FontPackWriter writer(dataStream);
+	writer.writeHeader(*this);
+	for(size_t i = 0; i < storedCharacters.size(); ++i) {
+		writer.writeGlyph(storedCharacters.codePointAt(i), storedCharacters.at(i));
 	}
+	writer.finish(kerning, atlas);
 }
 
 void PreprocessedFontFace::fromData(QDataStream& dataStream)
+{
+	std::vector<std::pair<uint32_t,uint64_t>> tableOfContents;
+	headerFromData(dataStream, tableOfContents);
+	// Sorted by code point so every insertion appends to the glyph table
+	std::sort(tableOfContents.begin(), tableOfContents.end());
+	storedCharacters.clear();
+	storedCharacters.reserve(tableOfContents.size());
+	for(const auto& it : tableOfContents) {
+		dataStream.device()->seek(it.second);
+		StoredCharacter tmpChar;
+		tmpChar.fromData(dataStream);
+		storedCharacters.insert(it.first,tmpChar);
+	}
+}
+
+void PreprocessedFontFace::headerFromData(QDataStream& dataStream, std::vector<std::pair<uint32_t,uint64_t>>& tableOfContents)
 {
 	{
 		validatePreprocessedFontFaceMagic(dataStream);
@@ -181,22 +232,38 @@ void PreprocessedFontFace::fromData(QDataStream& dataStream)
 	dataStream >> tmpType >> tmpDist >> bitmap_size >> bitmap_logical_size >> bitmap_padding >> hasVert;
 	dataStream.readRawData(imageFormat.data(), imageFormat.size());
 	imageFormat.back() = '\0';
-	dataStream >> ascender >> descender >> faceHeight >> maxAdvance >> unitsPerEm >> charCount;
+	dataStream >> ascender >> descender >> faceHeight >> maxAdvance >> unitsPerEm;
+	tightBounds = false;
+	if(version >= TIGHT_BOUNDS_VERSION) dataStream >> tightBounds;
 	this->type = static_cast<SDFType>(tmpType);
 	this->distType = static_cast<DistanceType>(tmpDist);
-	QMap<uint32_t,uint32_t> offsets;
+	if(version >= INDEX_AT_END_VERSION) {
+		// The index follows the glyphs, so the header only points at it
+		uint64_t indexOffset;
+		dataStream >> indexOffset;
+		if(dataStream.status() != QDataStream::Ok || !dataStream.device()->seek(indexOffset)) {
+			throw std::runtime_error("Invalid PreprocessedFontFace index offset.");
+		}
+	}
+	dataStream >> charCount;
+	tableOfContents.clear();
+	tableOfContents.reserve(charCount);
 	for(uint32_t i = 0; i < charCount; ++i) {
-		uint32_t k,v;
-		dataStream >> k >> v;
-		offsets.insert(k,v);
+		uint32_t k;
+		if(version >= INDEX_AT_END_VERSION) {
+			uint64_t v;
+			dataStream >> k >> v;
+			tableOfContents.emplace_back(k,v);
+		} else {
+			uint32_t v;
+			dataStream >> k >> v;
+			tableOfContents.emplace_back(k,v);
+		}
 	}
 	dataStream >> kerning;
-	for(auto it = std::begin(offsets); it != std::end(offsets); ++it) {
-		dataStream.device()->seek(it.value());
-		StoredCharacter tmpChar;
-		tmpChar.fromData(dataStream);
-		storedCharacters.insert(it.key(),tmpChar);
-	}
+	if(version >= ATLAS_VERSION) dataStream >> atlas;
+	else atlas.clear();
+	if(dataStream.status() != QDataStream::Ok) throw std::runtime_error("Truncated PreprocessedFontFace index.");
 }
 
 void PreprocessedFontFace::setImageFormat(const QByteArray& format)
@@ -214,54 +281,120 @@ QByteArray PreprocessedFontFace::imageFormatBytes() const
 	return QByteArray(imageFormat.data(), std::distance(imageFormat.begin(), terminator));
 }
 
-void PreprocessedFontFace::outToFolder(const QString& pattern) const
+TexelCodec::Format PreprocessedFontFace::texelFormat() const
 {
-	for(auto it = std::begin(storedCharacters); it != std::end(storedCharacters); ++it) {
-		QFile fil(pattern.arg(it.key()));
-		if(fil.open(QFile::WriteOnly)) {
-			fil.write(it.value().sdf);
-		}
-	}
+	return TexelCodec::fromName(imageFormatBytes());
 }
 
+uint32_t PreprocessedFontFace::glyphImageSize() const
+{
+	return bitmap_size ? bitmap_size : bitmap_logical_size;
+}
 
-QDataStream &operator<<(QDataStream &stream, const PerCharacterKerning &processedFontFace) {
-	stream << static_cast<uint32_t>(processedFontFace.size());
-	for( auto it = std::begin(processedFontFace) ; it != std::end(processedFontFace) ; ++it ) {
-		stream << it.key() << it.value();
-	}
-	return stream;
+std::pair<uint32_t,uint32_t> PreprocessedFontFace::glyphImageSize(size_t index) const
+{
+	if(!tightBounds) return { glyphImageSize(), glyphImageSize() };
+	const GlyphMetrics& metrics = storedCharacters.metricsAt(index);
+	return { metrics.width, metrics.height };
 }
-QDataStream &operator>>(QDataStream &stream, PerCharacterKerning &processedFontFace) {
-	uint32_t rawSize;
-	stream >> rawSize;
-	for(uint32_t i = 0; i < rawSize; ++i) {
-		uint32_t k;
-		Vec2f v;
-		stream >> k >> v;
-		processedFontFace.insert(k,v);
+
+QImage PreprocessedFontFace::glyphImage(size_t index) const
+{
+	const AtlasPlacement* placement = storedCharacters.sdfAt(index).isEmpty() ? atlas.find(storedCharacters.codePointAt(index)) : nullptr;
+	if(!placement) {
+		const std::pair<uint32_t,uint32_t> size = glyphImageSize(index);
+		return TexelCodec::toImage(storedCharacters.sdfAt(index).toByteArray(), imageFormatBytes(), type, size.first, size.second);
 	}
-	return stream;
+	if(placement->page >= static_cast<uint32_t>(atlas.pages.size())) return QImage();
+	const QImage page = TexelCodec::toImage(atlas.pages[placement->page], imageFormatBytes(), type, atlas.pageSize, atlas.pageSize);
+	if(page.isNull()) return QImage();
+	return page.copy(placement->x, placement->y, placement->width, placement->height);
 }
-QDataStream &operator<<(QDataStream &stream, const KerningMap &processedFontFace) {
-	stream << static_cast<uint32_t>(processedFontFace.size());
-	for( auto it = std::begin(processedFontFace) ; it != std::end(processedFontFace) ; ++it ) {
-		stream << it.key() << it.value();
+
+void PreprocessedFontFace::packAtlas(uint32_t pageSize, uint32_t spacing)
+{
+	if(!atlas.isEmpty()) throw std::runtime_error("The font face is already packed into an atlas!");
+	if(!pageSize) throw std::runtime_error("Atlas page size must be greater than zero!");
+	const QImage::Format pageFormat = (type == SDFType::SDF) ? QImage::Format_Grayscale8 : QImage::Format_RGBA8888;
+	const QByteArray format = imageFormatBytes();
+	FontAtlas packed;
+	packed.pageSize = pageSize;
+	// Compressed pages share one set of endpoints per block: no block may cover two glyphs
+	SkylinePacker packer(pageSize, spacing, TexelCodec::blockSize(TexelCodec::fromName(format)));
+	QImage page;
+	auto flushPage = [&]() {
+		if(page.isNull()) return;
+		packed.pages.push_back(TexelCodec::fromImage(page, format, type));
+		page = QImage();
+		packer.clear();
+	};
+	// Tight cells come in every size; the skyline stays flattest when the tallest go first
+	std::vector<size_t> order;
+	for(size_t i = 0; i < storedCharacters.size(); ++i) {
+		if(!storedCharacters.sdfAt(i).isEmpty()) order.push_back(i);
 	}
-	return stream;
+	std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+		return glyphImageSize(a).second > glyphImageSize(b).second;
+	});
+	for(const size_t i : order) {
+		const QImage img = glyphImage(i).convertToFormat(pageFormat);
+		if(img.isNull()) throw std::runtime_error("Failed to decode a glyph for the atlas!");
+		std::optional<std::pair<uint32_t,uint32_t>> position = packer.insert(img.width(), img.height());
+		if(!position) {
+			flushPage();
+			position = packer.insert(img.width(), img.height());
+			if(!position) throw std::runtime_error("Glyph does not fit on an atlas page!");
+		}
+		if(page.isNull()) {
+			page = QImage(pageSize, pageSize, pageFormat);
+			page.fill(0);
+		}
+		const size_t rowBytes = static_cast<size_t>(img.width()) * (img.depth() / 8);
+		for(int y = 0; y < img.height(); ++y) {
+			std::memcpy(page.scanLine(position->second + y) + position->first * (page.depth() / 8), img.constScanLine(y), rowBytes);
+		}
+		packed.placements.push_back({ storedCharacters.codePointAt(i), static_cast<uint32_t>(packed.pages.size()),
+			position->first, position->second, static_cast<uint32_t>(img.width()), static_cast<uint32_t>(img.height()) });
+	}
+	flushPage();
+	// FontAtlas::find() looks placements up by code point
+	std::sort(packed.placements.begin(), packed.placements.end(), [](const AtlasPlacement& a, const AtlasPlacement& b) {
+		return a.codePoint < b.codePoint;
+	});
+	GlyphTable glyphs;
+	glyphs.reserve(storedCharacters.size(), 0);
+	for(size_t i = 0; i < storedCharacters.size(); ++i) {
+		StoredCharacter character;
+		static_cast<GlyphMetrics&>(character) = storedCharacters.metricsAt(i);
+		glyphs.insert(storedCharacters.codePointAt(i), character);
+	}
+	storedCharacters = std::move(glyphs);
+	atlas = std::move(packed);
 }
-QDataStream &operator>>(QDataStream &stream, KerningMap &processedFontFace) {
-	uint32_t rawSize;
-	stream >> rawSize;
-	for(uint32_t i = 0; i < rawSize; ++i) {
-		uint32_t k;
-		PerCharacterKerning v;
-		stream >> k >> v;
-		processedFontFace.insert(k,v);
+
+void PreprocessedFontFace::outToFolder(const QString& pattern) const
+{
+	const QByteArray format = imageFormatBytes();
+	std::vector<QImage> pages(atlas.pages.size()); // Decoded on first use
+	for(size_t i = 0; i < storedCharacters.size(); ++i) {
+		QFile fil(pattern.arg(storedCharacters.codePointAt(i)));
+		if(!fil.open(QFile::WriteOnly)) continue;
+		const QByteArrayView sdf = storedCharacters.sdfAt(i);
+		const AtlasPlacement* placement = sdf.isEmpty() ? atlas.find(storedCharacters.codePointAt(i)) : nullptr;
+		if(!placement) {
+			fil.write(sdf.data(), sdf.size());
+			continue;
+		}
+		// Atlas glyphs only live on their page: cut them out and encode each one on its own
+		if(placement->page >= pages.size()) throw std::runtime_error("Atlas placement refers to a missing page!");
+		QImage& page = pages[placement->page];
+		if(page.isNull()) page = TexelCodec::toImage(atlas.pages[placement->page], format, type, atlas.pageSize, atlas.pageSize);
+		if(page.isNull()) throw std::runtime_error("Failed to decode an atlas page!");
+		fil.write(TexelCodec::fromImage(page.copy(placement->x, placement->y, placement->width, placement->height), format, type));
 	}
-	return stream;
 }
 
+
 QDataStream& operator<<(QDataStream& stream, const PreprocessedFontFace& processedFontFace) {
 	processedFontFace.toData(stream);
 	return stream;
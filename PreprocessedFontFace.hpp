@@ -7,63 +7,16 @@
 #define PREPROCESSEDFONTFACE_HPP
 #include <array>
 #include <cstdint>
+#include <vector>
 #include <QByteArray>
 #include <QString>
 #include <QCborMap>
 #include "SDFGenerationArguments.hpp"
+#include "FontAtlas.hpp"
+#include "GlyphTable.hpp"
+#include "KerningTable.hpp"
 #include "StoredCharacter.hpp"
-
-/**
- * @brief 2D vector type represented as a pair of floats.
- * @typedef Vec2f
- */
-typedef std::pair<float,float> Vec2f;
-
-/**
- * @brief Map of character code points to kerning offset vectors.
- * @typedef PerCharacterKerning
- * Maps a second character code point to a Vec2f kerning offset when paired with a first character.
- */
-typedef QMap<uint32_t,Vec2f> PerCharacterKerning;
-
-/**
- * @brief Map of character code points to per-character kerning data.
- * @typedef KerningMap
- * Maps a first character code point to its PerCharacterKerning map.
- */
-typedef QMap<uint32_t,PerCharacterKerning> KerningMap;
-
-/**
- * @brief Serialize PerCharacterKerning to QDataStream.
- * @param stream The data stream to write to.
- * @param processedFontFace The kerning data to serialize.
- * @return Reference to the stream.
- */
-QDataStream &operator<<(QDataStream &stream, const PerCharacterKerning &processedFontFace);
-
-/**
- * @brief Deserialize PerCharacterKerning from QDataStream.
- * @param stream The data stream to read from.
- * @param processedFontFace The kerning data to populate.
- * @return Reference to the stream.
- */
-QDataStream &operator>>(QDataStream &stream, PerCharacterKerning &processedFontFace);
-
-/**
- * @brief Serialize KerningMap to QDataStream.
- * @param stream The data stream to write to.
- * @param processedFontFace The kerning map to serialize.
- * @return Reference to the stream.
- */
-QDataStream &operator<<(QDataStream &stream, const KerningMap &processedFontFace);
-
-/**
- * @brief Deserialize KerningMap from QDataStream.
- * @param stream The data stream to read from.
- * @param processedFontFace The kerning map to populate.
- * @return Reference to the stream.
- */
-QDataStream &operator>>(QDataStream &stream, KerningMap &processedFontFace);
+#include "TexelCodec.hpp"
 
 /**
  * @brief Main structure containing all preprocessed font face data.
@@ -74,7 +27,7 @@ QDataStream &operator>>(QDataStream &stream, KerningMap &processedFontFace);
  */
 struct PreprocessedFontFace {
 	static constexpr std::array<char,4> BINARY_MAGIC{{'W','O','D','F'}};
-	static constexpr uint32_t CURRENT_VERSION = 1;
+	static constexpr uint32_t CURRENT_VERSION = 4;
 
 	uint32_t version = CURRENT_VERSION;             ///< PreprocessedFontFace serialization format version.
 	QString fontFamilyName;                    ///< Font family name (UTF-8)
@@ -90,8 +43,10 @@ struct PreprocessedFontFace {
 	float faceHeight = 0.0f;                   ///< Scaled baseline-to-baseline distance in pixels
 	float maxAdvance = 0.0f;                   ///< Scaled maximum advance in pixels
 	uint32_t unitsPerEm = 0;                   ///< Original font units per EM
-	KerningMap kerning;                        ///< Kerning information for character pairs
-	QMap<uint32_t,StoredCharacter> storedCharacters; ///< Map of Unicode code points to glyph data
+	bool tightBounds = false;                  ///< Whether each glyph SDF is a width x height cell around its ink box instead of a square
+	KerningTable kerning;                      ///< Kerning information for character pairs
+	GlyphTable storedCharacters;               ///< Glyph data, keyed by Unicode code point
+	FontAtlas atlas;                           ///< Atlas pages holding the glyph SDFs (empty unless packAtlas() was called)
 	
 	/**
 	 * @brief Serialize to CBOR format.
@@ -112,8 +67,8 @@ struct PreprocessedFontFace {
 	void fromCbor(const QCborMap& cbor);
 	
 	/**
-	 * @brief Serialize to binary QDataStream format.
-	 * @param dataStream The data stream to write to (must be Qt_4_0, BigEndian).
+	 * @brief Serialize to binary QDataStream format (current version, through FontPackWriter).
+	 * @param dataStream The data stream to write to (must be Qt_4_0, BigEndian, on a seekable device).
 	 * @see BINARY_FORMAT.md for format specification.
 	 */
 	void toData(QDataStream& dataStream) const;
@@ -125,21 +80,81 @@ struct PreprocessedFontFace {
 	 */
 	void fromData(QDataStream& dataStream);
 
+	/**
+	 * @brief Deserialize everything but the glyph data from binary QDataStream format.
+	 *
+	 * Reads the header, the glyph table of contents, the kerning and the atlas of any
+	 * format version, seeking to the index if it follows the glyph data. storedCharacters
+	 * is left untouched.
+	 *
+	 * @param dataStream The data stream to read from (must be Qt_4_0, BigEndian, on a seekable device).
+	 * @param tableOfContents Receives the (code point, file offset) pairs of the TOC, in file order.
+	 * @see BINARY_FORMAT.md for format specification.
+	 */
+	void headerFromData(QDataStream& dataStream, std::vector<std::pair<uint32_t,uint64_t>>& tableOfContents);
+
 	/**
 	 * @brief Set the null-terminated encoded glyph image format.
-	 * @param format Image format name accepted by QImageWriter (e.g. PNG, JPG, WEBP).
+	 * @param format Image format name accepted by QImageWriter (e.g. PNG, JPG, WEBP) or a TexelCodec format (RAW, BC1, BC3, BC4).
 	 */
 	void setImageFormat(const QByteArray& format);
 
 	/**
 	 * @brief Get the encoded glyph image format as a null-terminated byte array.
-	 * @return Image format name accepted by QImageWriter.
+	 * @return Image format name accepted by QImageWriter, or a TexelCodec format name.
 	 */
 	QByteArray imageFormatBytes() const;
+
+	/**
+	 * @brief Get the payload format of the glyphs.
+	 * @return TexelCodec::ENCODED_IMAGE for image files, otherwise the texel format.
+	 */
+	TexelCodec::Format texelFormat() const;
+
+	/**
+	 * @brief Get the edge length of the square glyph images.
+	 * @return bitmap_size, or bitmap_logical_size if no intended size was set.
+	 */
+	uint32_t glyphImageSize() const;
+
+	/**
+	 * @brief Get the size of a glyph's image in texels.
+	 * @param index Index of the glyph in storedCharacters.
+	 * @return The glyph's width and height with tight bounds, otherwise glyphImageSize() squared.
+	 */
+	std::pair<uint32_t,uint32_t> glyphImageSize(size_t index) const;
+
+	/**
+	 * @brief Decode the SDF of a glyph, whatever its payload format.
+	 *
+	 * Glyphs packed into the atlas are cut out of their page, which is decoded for every call.
+	 *
+	 * @param index Index of the glyph in storedCharacters.
+	 * @return The image; null if it cannot be decoded.
+	 */
+	QImage glyphImage(size_t index) const;
+
+	/**
+	 * @brief Move every glyph SDF onto shared atlas pages.
+	 *
+	 * Glyphs are placed in code point order by a SkylinePacker, starting a new page whenever
+	 * the current one is full. Pages are encoded in imageFormat, and the per-glyph SDFs are
+	 * emptied afterwards; glyphs with an empty SDF get no placement.
+	 *
+	 * @param pageSize Edge length of the square pages in texels.
+	 * @param spacing Empty texels kept between neighbouring glyphs.
+	 * @throws std::runtime_error If the face already has an atlas, a glyph cannot be decoded or does not fit on a page.
+	 */
+	void packAtlas(uint32_t pageSize, uint32_t spacing);
 	
 	/**
 	 * @brief Export glyph SDF data to individual files.
+	 *
+	 * Glyphs packed into the atlas are cut out of their page and encoded again, so every file
+	 * holds the glyph's own image either way.
+	 *
 	 * @param pattern File path pattern with %1 placeholder for character code (e.g., "glyph_%1.bin").
+	 * @throws std::runtime_error If an atlas page is missing or cannot be decoded.
 	 */
 	void outToFolder(const QString& pattern) const;
 };
@@ -0,0 +1,138 @@
+#include "Profiler.hpp"
+#include <QFile>
+#include <QTextStream>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+/// Events reserved per thread up front, so the first few hundred glyphs never reallocate.
+#define EVENTS_PER_THREAD_RESERVE 4096
+
+namespace {
+
+struct Event {
+	const char* name;
+	int64_t start;
+	int64_t end;
+};
+
+struct ThreadLog {
+	uint32_t id;
+	std::vector<Event> events;
+};
+
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ThreadLog>> threadLogs;  ///< Owned here, so logs outlive the threads that filled them
+thread_local ThreadLog* currentLog = nullptr;
+int64_t origin = 0;
+
+const char* const COUNTER_NAMES[Profiler::COUNTER_COUNT] = {
+	"glyphs", "edges", "pixels evaluated", "bytes encoded", "bytes written"
+};
+
+ThreadLog& threadLog()
+{
+	if(!currentLog) {
+		std::lock_guard<std::mutex> lock(registryMutex);
+		threadLogs.push_back(std::make_unique<ThreadLog>());
+		currentLog = threadLogs.back().get();
+		currentLog->id = static_cast<uint32_t>(threadLogs.size());
+		currentLog->events.reserve(EVENTS_PER_THREAD_RESERVE);
+	}
+	return *currentLog;
+}
+
+QString microseconds(int64_t nanoseconds)
+{
+	return QString::number(static_cast<double>(nanoseconds) / 1000.0, 'f', 3);
+}
+
+}
+
+int64_t Profiler::now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count() - origin;
+}
+
+void Profiler::enable()
+{
+	if(enabled) return;
+	origin = now();
+	enabled = true;
+}
+
+void Profiler::record(const char* name, int64_t start, int64_t end)
+{
+	threadLog().events.push_back({ name, start, end });
+}
+
+void Profiler::writeTrace(const QString& path)
+{
+	QFile file(path);
+	if(!file.open(QFile::WriteOnly | QFile::Truncate)) {
+		throw std::runtime_error("Failed to open the profile trace for writing.");
+	}
+	QTextStream out(&file);
+	std::lock_guard<std::mutex> lock(registryMutex);
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+	for(const auto& log : threadLogs) {
+		out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << log->id
+			<< ",\"args\":{\"name\":\"thread " << log->id << "\"}}";
+		first = false;
+		for(const Event& event : log->events) {
+			out << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << log->id
+				<< ",\"ts\":" << microseconds(event.start) << ",\"dur\":" << microseconds(event.end - event.start) << '}';
+		}
+	}
+	out << "\n],\"otherData\":{";
+	for(int i = 0; i < COUNTER_COUNT; ++i) {
+		out << (i ? "," : "") << '"' << COUNTER_NAMES[i] << "\":" << counters[i].load();
+	}
+	out << "}}\n";
+	out.flush();
+	if(out.status() != QTextStream::Ok) throw std::runtime_error("Failed to write the profile trace.");
+}
+
+QString Profiler::summary()
+{
+	struct Totals {
+		uint64_t calls = 0;
+		int64_t total = 0;
+		int64_t longest = 0;
+	};
+	std::map<QString, Totals> stages;
+	int64_t wall = 0;
+	{
+		std::lock_guard<std::mutex> lock(registryMutex);
+		for(const auto& log : threadLogs) {
+			for(const Event& event : log->events) {
+				Totals& totals = stages[QString::fromLatin1(event.name)];
+				++totals.calls;
+				totals.total += event.end - event.start;
+				totals.longest = std::max(totals.longest, event.end - event.start);
+				wall = std::max(wall, event.end);
+			}
+		}
+	}
+	std::vector<std::pair<QString, Totals>> sorted(stages.begin(), stages.end());
+	std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.second.total > b.second.total; });
+
+	QString toReturn = QStringLiteral("%1 %2 %3 %4 %5\n").arg(QStringLiteral("Stage"), -24).arg(QStringLiteral("calls"), 10)
+		.arg(QStringLiteral("total ms"), 12).arg(QStringLiteral("mean us"), 12).arg(QStringLiteral("max us"), 12);
+	for(const auto& it : sorted) {
+		toReturn += QStringLiteral("%1 %2 %3 %4 %5\n").arg(it.first, -24).arg(it.second.calls, 10)
+			.arg(static_cast<double>(it.second.total) / 1e6, 12, 'f', 2)
+			.arg(static_cast<double>(it.second.total) / 1e3 / static_cast<double>(it.second.calls), 12, 'f', 1)
+			.arg(static_cast<double>(it.second.longest) / 1e3, 12, 'f', 1);
+	}
+	toReturn += QStringLiteral("Wall time: %1 ms\n").arg(static_cast<double>(wall) / 1e6, 0, 'f', 2);
+	for(int i = 0; i < COUNTER_COUNT; ++i) {
+		toReturn += QStringLiteral("%1 %2\n").arg(QString::fromLatin1(COUNTER_NAMES[i]) + QStringLiteral(":"), -24).arg(counters[i].load());
+	}
+	return toReturn;
+}
@@ -0,0 +1,102 @@
+/**
+ * @file Profiler.hpp
+ * @brief Scoped timers and counters for the stages of a build, exported as a Chrome trace.
+ *
+ * The hot paths of glyph generation open a Profiler::Scope per stage (glyph loading,
+ * decomposition, colouring, distance evaluation, downsampling, encoding, kerning and
+ * serialization) and add to a few global counters. Nothing is recorded until enable()
+ * is called; until then a scope costs one relaxed atomic load.
+ */
+
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+#include <QString>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief Process-wide recorder of stage timings and counters.
+ *
+ * Every thread appends to its own event list, so recording takes no lock after the first
+ * event of a thread. writeTrace() and summary() must only be called once the threads that
+ * recorded events are idle.
+ *
+ * @class Profiler
+ */
+class Profiler {
+public:
+	/// Quantities summed over the whole build.
+	enum Counter {
+		GLYPHS,            ///< Glyphs loaded from the font
+		EDGES,             ///< Edge segments of decomposed outlines
+		PIXELS_EVALUATED,  ///< Pixels the distance engines computed, before downsampling
+		BYTES_ENCODED,     ///< Bytes of encoded SDF images
+		BYTES_WRITTEN,     ///< Bytes of output files
+		COUNTER_COUNT
+	};
+
+	/**
+	 * @brief Times the enclosing block as one event of a stage.
+	 * @class Profiler::Scope
+	 */
+	class Scope {
+	private:
+		const char* name;
+		int64_t start;     ///< Negative if the profiler was disabled when the scope opened
+
+	public:
+		/**
+		 * @brief Start timing a stage.
+		 * @param name Name of the stage; must be a string literal (it is kept by pointer).
+		 */
+		explicit Scope(const char* name) : name(name), start(isEnabled() ? now() : -1) {}
+		~Scope() { if(start >= 0) record(name, start, now()); }
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+	};
+
+	/**
+	 * @brief Start recording; the trace timeline begins here.
+	 */
+	static void enable();
+
+	/**
+	 * @brief Whether events and counters are being recorded.
+	 * @return True after enable().
+	 */
+	static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+	/**
+	 * @brief Add to a counter, if recording.
+	 * @param counter Counter to add to.
+	 * @param amount Amount to add.
+	 */
+	static void count(Counter counter, uint64_t amount) {
+		if(isEnabled()) counters[counter].fetch_add(amount, std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Write the recorded events as Chrome trace event JSON (loadable in Perfetto and chrome://tracing).
+	 * @param path Path of the JSON file.
+	 * @throws std::runtime_error If the file cannot be written.
+	 */
+	static void writeTrace(const QString& path);
+
+	/**
+	 * @brief Describe the time spent in every stage and the counters, as a text table.
+	 *
+	 * Stage times include the stages nested inside them, and are summed over threads.
+	 *
+	 * @return Multi-line summary.
+	 */
+	static QString summary();
+
+private:
+	static inline std::atomic<bool> enabled = false;
+	static inline std::atomic<uint64_t> counters[COUNTER_COUNT] = {};
+
+	static int64_t now();
+	static void record(const char* name, int64_t start, int64_t end);
+};
+
+#endif // PROFILER_HPP
@@ -1,5 +1,9 @@
 #include "SDFGenerationArguments.hpp"
 #include "ConstStrings.hpp"
+#include "TexelCodec.hpp"
+#include <QFile>
+#include <algorithm>
+#include <stdexcept>
 
 #ifdef HIRES
 const unsigned INTERNAL_RENDER_SIZE = 4096;
@@ -9,6 +13,8 @@ const unsigned INTERNAL_RENDER_SIZE = 1024;
 const unsigned PADDING = 100;
 #endif
 const unsigned INTENDED_SIZE = 32;
+const unsigned DEFAULT_CACHE_SIZE_MIB = 1024;
+const unsigned MAX_SUPERSAMPLE = 16;
 const QString DEFAULT_IMAGE_FORMAT = QStringLiteral("PNG");
 
 /*
@@ -17,9 +23,76 @@ extern const QString MIDPOINT_ADJUSTMENT_KEY;
 extern const QString MAXIMIZE_INSTEAD_OF_AVERAGE_KEY;
 */
 
+using CharRanges = std::vector<std::pair<uint32_t,uint32_t>>;
+
+static uint32_t parseCharcode(QString text)
+{
+	text = text.trimmed();
+	int base = 0;
+	if(text.startsWith(QStringLiteral("U+"), Qt::CaseInsensitive)) {
+		text = text.mid(2);
+		base = 16;
+	}
+	bool ok = false;
+	const uint32_t charcode = text.toUInt(&ok, base);
+	if(!ok) throw std::runtime_error("Invalid code point in character ranges: " + text.toStdString());
+	return charcode;
+}
+
+/// Parse a comma-separated list such as "0x20-0x7E,U+00A0-U+00FF,8364".
+static void parseCharRanges(const QString& text, CharRanges& ranges)
+{
+	for(const QString& item : text.split(QChar(','), Qt::SkipEmptyParts)) {
+		const qsizetype dash = item.indexOf(QChar('-'));
+		const uint32_t first = parseCharcode(dash < 0 ? item : item.left(dash));
+		const uint32_t last = dash < 0 ? first : parseCharcode(item.mid(dash + 1));
+		if(last < first) throw std::runtime_error("Invalid character range: " + item.trimmed().toStdString());
+		ranges.emplace_back(first, last);
+	}
+}
+
+/// Every distinct code point of a UTF-8 text corpus.
+static void readCharsetFile(const QString& path, CharRanges& ranges)
+{
+	QFile file(path);
+	if(!file.open(QFile::ReadOnly)) throw std::runtime_error("Failed to open charset file " + path.toStdString() + "!");
+	std::vector<uint32_t> charcodes;
+	for(const uint charcode : QString::fromUtf8(file.readAll()).toUcs4()) charcodes.push_back(charcode);
+	std::sort(charcodes.begin(), charcodes.end());
+	charcodes.erase(std::unique(charcodes.begin(), charcodes.end()), charcodes.end());
+	for(const uint32_t charcode : charcodes) ranges.emplace_back(charcode, charcode);
+}
+
+/// Sort the ranges and merge the ones that overlap or touch.
+static void normalizeCharRanges(CharRanges& ranges)
+{
+	std::sort(ranges.begin(), ranges.end());
+	CharRanges merged;
+	for(const auto& range : ranges) {
+		if(!merged.empty() && static_cast<uint64_t>(merged.back().second) + 1 >= range.first) {
+			merged.back().second = std::max(merged.back().second, range.second);
+		} else {
+			merged.push_back(range);
+		}
+	}
+	ranges = std::move(merged);
+}
+
+bool SDFGenerationArguments::includesCharcode(uint32_t charcode) const
+{
+	if(charcode < char_min || charcode >= char_max) return false;
+	if(charset.empty()) return true;
+	auto it = std::upper_bound(charset.begin(), charset.end(), charcode, [](uint32_t value, const std::pair<uint32_t,uint32_t>& range) {
+		return value < range.first;
+	});
+	return it != charset.begin() && charcode <= std::prev(it)->second;
+}
+
 void SDFGenerationArguments::fromArgs(const QVariantMap& args)
 {
 	this->createMipmaps = args.contains(CREATE_MIPMAPS_KEY);
+	this->distanceTransform = args.contains(DISTANCE_TRANSFORM_KEY);
+	this->tightBounds = args.contains(TIGHT_BOUNDS_KEY);
 	this->msdfgenColouring = args.contains(MSDFGEN_COLOURING);
 	this->invert = args.contains(INVERT_KEY);
 	this->imageFormat = args.value(IMAGE_FORMAT_KEY, DEFAULT_IMAGE_FORMAT).toString().trimmed().toUpper().toLatin1();
@@ -34,6 +107,19 @@ void SDFGenerationArguments::fromArgs(const QVariantMap& args)
 	this->samples_to_check_y = args.value(SAMPLES_TO_CHECK_Y_KEY, 0).toUInt();
 	this->char_min = args.value(CHAR_MIN_KEY, 0).toUInt();
 	this->char_max = args.value(CHAR_MAX_KEY, 0xE007F).toUInt();
+	// Explicit charsets are unioned, then intersected with [char_min, char_max) by includesCharcode()
+	this->charset.clear();
+	if(args.contains(CHAR_RANGES_KEY)) parseCharRanges(args.value(CHAR_RANGES_KEY).toString(), this->charset);
+	if(args.contains(CHARSET_FILE_KEY)) readCharsetFile(args.value(CHARSET_FILE_KEY).toString(), this->charset);
+	if((args.contains(CHAR_RANGES_KEY) || args.contains(CHARSET_FILE_KEY)) && this->charset.empty()) {
+		throw std::runtime_error("The requested character set is empty.");
+	}
+	normalizeCharRanges(this->charset);
+	this->threads = args.value(THREADS_KEY, 0).toUInt();
+	this->encoderThreads = args.value(ENCODER_THREADS_KEY, 0).toUInt();
+	this->supersample = args.value(SUPERSAMPLE_KEY, 0).toUInt();
+	this->cacheDirectory = args.value(CACHE_DIR_KEY).toString();
+	this->cacheSizeMiB = args.value(CACHE_SIZE_KEY, DEFAULT_CACHE_SIZE_MIB).toUInt();
 	this->font_path = args.value(IN_FONT_KEY, DEFAULT_FONT_PATH).toString();
 	// Midpoint bias
 	if(args.contains(MIDPOINT_ADJUSTMENT_KEY)) {
@@ -149,4 +235,19 @@ void SDFGenerationArguments::fromArgs(const QVariantMap& args)
 			}
 		}
 	}
+	if(!TexelCodec::supports(TexelCodec::fromName(this->imageFormat), this->type)) {
+		throw std::runtime_error("The requested texel format cannot store this SDF type.");
+	}
+	if(this->distanceTransform && this->mode != SDfGenerationMode::SOFTWARE) {
+		throw std::runtime_error("The bitmap distance transform is only supported in software mode.");
+	}
+	if(this->tightBounds && this->mode != SDfGenerationMode::SOFTWARE) {
+		throw std::runtime_error("Tight glyph bounds are only supported in software mode.");
+	}
+	if(this->supersample) {
+		if(this->mode != SDfGenerationMode::SOFTWARE) throw std::runtime_error("Direct generation with supersampling is only supported in software mode.");
+		if(this->supersample > MAX_SUPERSAMPLE || (this->supersample & (this->supersample - 1))) {
+			throw std::runtime_error("Supersampling must be a power of two no greater than 16.");
+		}
+	}
 }
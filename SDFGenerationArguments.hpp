@@ -10,6 +10,8 @@
 #include <QVariant>
 #include <QByteArray>
 #include <optional>
+#include <utility>
+#include <vector>
 
 /**
  * @brief Generation mode for SDF computation.
@@ -69,6 +71,7 @@ struct SDFGenerationArguments {
 	QString font_path;                            ///< Path to font file
 	uint32_t char_min;                            ///< Minimum Unicode code point to process
 	uint32_t char_max;                            ///< Maximum Unicode code point to process
+	std::vector<std::pair<uint32_t,uint32_t>> charset; ///< Sorted, disjoint inclusive code point ranges to process (empty = everything in [char_min, char_max))
 	bool msdfgenColouring;                        ///< Use msdfgen-style edge coloring algorithm
 	bool invert;                                  ///< Invert the SDF (inside becomes outside)
 	QByteArray imageFormat;                      ///< Encoded glyph image format (PNG, JPG, WEBP, ...)
@@ -77,12 +80,26 @@ struct SDFGenerationArguments {
 	bool maximizeInsteadOfAverage;                ///< Use maximum instead of average when downsampling
 	std::optional<float> midpointAdjustment;     ///< Optional adjustment to SDF midpoint threshold
 	bool createMipmaps;                          ///< Whether to create mipmaps or not. Only used for regular vector images.
+	bool distanceTransform;                      ///< Use a linear-time exact distance transform for bitmap SDFs instead of the windowed search (software mode)
+	bool tightBounds;                            ///< Render each glyph at its own aspect ratio and the shared face scale instead of stretching it into a square cell (software mode)
+	uint32_t supersample;                        ///< Render outline glyphs directly at the intended size with this many samples per texel side (0 = render at internalProcessSize and downsample; software mode)
+	QString cacheDirectory;                       ///< Directory of the per-glyph build cache (empty = no cache)
+	uint32_t cacheSizeMiB;                        ///< Size limit of the build cache in MiB; least recently used glyphs are evicted
+	uint32_t threads;                            ///< Number of glyphs processed concurrently by processFont (0 = one per hardware thread, software mode)
+	uint32_t encoderThreads;                     ///< Threads encoding finished glyph SDFs while generation goes on (0 = encode on the generating thread)
 	
 	/**
 	 * @brief Parse arguments from a QVariantMap (typically from command-line or UI).
 	 * @param args Map of argument keys to values.
 	 */
 	void fromArgs(const QVariantMap& args);
+
+	/**
+	 * @brief Check whether a code point was requested.
+	 * @param charcode Unicode code point.
+	 * @return True if it lies in [char_min, char_max) and, when a charset is given, within one of its ranges.
+	 */
+	bool includesCharcode(uint32_t charcode) const;
 };
 
 #endif // SDFGENERATIONARGUMENTS_HPP
@@ -0,0 +1,164 @@
+#include "SdfEncodeStage.hpp"
+#include "GlyphCache.hpp"
+#include "Profiler.hpp"
+#include "TexelCodec.hpp"
+#include <algorithm>
+
+/// Images that may wait for an encoder, per encoder thread.
+#define QUEUED_IMAGES_PER_ENCODER 4
+/// Glyphs that may wait for an earlier index, per generator thread, on top of the queued images.
+#define REORDERED_GLYPHS_PER_GENERATOR 4
+
+static uint64_t nanosecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+SdfEncodeStage::SdfEncodeStage(const SDFGenerationArguments& args, GlyphCache* cache, unsigned generatorThreads, size_t heldBack, Sink sink)
+	: args(args), cache(cache), sink(std::move(sink)),
+	  capacity(QUEUED_IMAGES_PER_ENCODER * std::max<size_t>(1, args.encoderThreads)),
+	  // Every generator must be able to get past a slow or held back glyph, or they would all wait on it
+	  window(capacity + (REORDERED_GLYPHS_PER_GENERATOR + heldBack) * size_t(std::max(1u, generatorThreads))),
+	  generatorThreads(std::max(1u, generatorThreads)), started(std::chrono::steady_clock::now())
+{
+	const unsigned threadCount = std::max<unsigned>(1, args.encoderThreads);
+	threads.reserve(threadCount);
+	for(unsigned i = 0; i < threadCount; ++i) threads.emplace_back(&SdfEncodeStage::encoderLoop, this);
+}
+
+SdfEncodeStage::~SdfEncodeStage()
+{
+	stop();
+}
+
+void SdfEncodeStage::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		queue.clear();
+		stopping = true;
+	}
+	jobAvailable.notify_all();
+	spaceAvailable.notify_all();
+	for(std::thread& thread : threads) {
+		if(thread.joinable()) thread.join();
+	}
+}
+
+void SdfEncodeStage::fail(std::exception_ptr error)
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		if(!failure) failure = error;
+		failed = true;
+	}
+	spaceAvailable.notify_all();
+}
+
+void SdfEncodeStage::encoderLoop()
+{
+	while(true) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			jobAvailable.wait(lock, [this]() { return stopping || !queue.empty(); });
+			if(queue.empty()) return;
+			job = std::move(queue.front());
+			queue.pop_front();
+			++encoding;
+		}
+		spaceAvailable.notify_one();
+		if(!failed) {
+			const auto start = std::chrono::steady_clock::now();
+			try {
+				Profiler::Scope profileScope("encoding");
+				job.character.sdf = TexelCodec::fromImage(std::move(job.pending.image), args.imageFormat, args.type);
+				Profiler::count(Profiler::BYTES_ENCODED, job.character.sdf.size());
+				if(cache && !job.pending.cacheKey.isEmpty()) cache->store(job.pending.cacheKey, job.character);
+			} catch(...) {
+				fail(std::current_exception());
+			}
+			encoder.busyNanoseconds += nanosecondsSince(start);
+			++encoder.items;
+			deliver(job.index, std::move(job.character));
+		}
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			--encoding;
+		}
+		// finish() waits on the same condition for the last job to leave
+		spaceAvailable.notify_all();
+	}
+}
+
+void SdfEncodeStage::deliver(size_t index, StoredCharacter&& character)
+{
+	std::lock_guard<std::mutex> lock(deliveryMutex);
+	// Waking the generators under the lock keeps them from missing a failure set just before
+	windowAvailable.notify_all();
+	if(failed) return;
+	finished.emplace(index, std::move(character));
+	for(auto it = finished.begin(); it != finished.end() && it->first == nextIndex; it = finished.erase(it)) {
+		try {
+			sink(it->first, it->second);
+		} catch(...) {
+			fail(std::current_exception());
+			return;
+		}
+		++nextIndex;
+	}
+}
+
+void SdfEncodeStage::submit(size_t index, StoredCharacter&& character, PendingSdf&& pending, uint64_t generationNanoseconds)
+{
+	++generation.items;
+	generation.busyNanoseconds += generationNanoseconds;
+	const auto start = std::chrono::steady_clock::now();
+	// The glyph at nextIndex is always inside the window, so the wait cannot stall delivery
+	{
+		std::unique_lock<std::mutex> lock(deliveryMutex);
+		windowAvailable.wait(lock, [this, index]() { return failed || index < nextIndex + window; });
+	}
+	if(pending.image.isNull()) {
+		blockedNanoseconds += nanosecondsSince(start);
+		deliver(index, std::move(character));
+	} else {
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			spaceAvailable.wait(lock, [this]() { return failed || queue.size() < capacity; });
+			if(!failed) queue.push_back(Job{ index, std::move(character), std::move(pending) });
+		}
+		blockedNanoseconds += nanosecondsSince(start);
+		jobAvailable.notify_one();
+	}
+	if(failed) {
+		std::lock_guard<std::mutex> lock(queueMutex);
+		std::rethrow_exception(failure);
+	}
+}
+
+void SdfEncodeStage::finish()
+{
+	{
+		std::unique_lock<std::mutex> lock(queueMutex);
+		spaceAvailable.wait(lock, [this]() { return failed || (queue.empty() && !encoding); });
+	}
+	stop();
+	wallSeconds = static_cast<double>(nanosecondsSince(started)) * 1e-9;
+	if(failure) std::rethrow_exception(failure);
+}
+
+QString SdfEncodeStage::report() const
+{
+	const double wall = std::max(wallSeconds, 1e-9);
+	auto utilization = [wall](const StageCounters& counters, size_t threadCount) {
+		return 100.0 * static_cast<double>(counters.busyNanoseconds.load()) * 1e-9 / (wall * static_cast<double>(threadCount));
+	};
+	return QStringLiteral("Generation: %1 glyphs, %2 glyphs/s, %3% busy on %4 threads, %5 s waiting for encoders\n"
+						  "Encoding: %6 images, %7 images/s, %8% busy on %9 threads")
+		.arg(generation.items.load()).arg(static_cast<double>(generation.items.load()) / wall, 0, 'f', 1)
+		.arg(utilization(generation, generatorThreads), 0, 'f', 1).arg(generatorThreads)
+		.arg(static_cast<double>(blockedNanoseconds.load()) * 1e-9, 0, 'f', 2)
+		.arg(encoder.items.load()).arg(static_cast<double>(encoder.items.load()) / wall, 0, 'f', 1)
+		.arg(utilization(encoder, threads.size()), 0, 'f', 1).arg(threads.size());
+}
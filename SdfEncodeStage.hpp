@@ -0,0 +1,153 @@
+/**
+ * @file SdfEncodeStage.hpp
+ * @brief Pool of threads that encode finished glyph SDFs while the generators move on.
+ *
+ * Encoding a glyph (PNG compression by default) used to run on the thread that had just
+ * computed its distances, so at small intended sizes the distance engine sat idle for a
+ * noticeable share of the run. With this stage, generators only hand over the finished
+ * QImage; a bounded queue feeds the encoder threads, and finished characters are
+ * delivered strictly in glyph order, so the output does not depend on thread timing.
+ */
+
+#ifndef SDFENCODESTAGE_HPP
+#define SDFENCODESTAGE_HPP
+#include <QByteArray>
+#include <QImage>
+#include <QString>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "SDFGenerationArguments.hpp"
+#include "StoredCharacter.hpp"
+
+class GlyphCache;
+
+/**
+ * @brief SDF of a glyph whose encoding was deferred.
+ *
+ * Filled in by the glyph functions of SdfGenerationContext when they are given one,
+ * instead of setting StoredCharacter::sdf themselves.
+ *
+ * @struct PendingSdf
+ */
+struct PendingSdf {
+	QImage image;         ///< Finished SDF, null if the character needs no encoding (empty glyph or cache hit)
+	QByteArray cacheKey;  ///< Glyph cache key to store the encoded character under, empty if it is not cached
+};
+
+/**
+ * @brief Bounded producer/consumer stage between SDF generation and encoding.
+ *
+ * Every index from 0 up must be submitted exactly once, from any number of threads and in
+ * any order. Characters reach the sink in index order, one at a time. submit() blocks while
+ * the queue of images waiting for an encoder is full, which bounds the memory held by
+ * images that are done but not yet encoded, and while its index is too far ahead of the
+ * next one to deliver, which bounds the characters waiting for a slow earlier glyph.
+ *
+ * @class SdfEncodeStage
+ */
+class SdfEncodeStage {
+public:
+	/// Receives finished characters in index order; may throw, failing the stage.
+	typedef std::function<void(size_t index, StoredCharacter& character)> Sink;
+
+private:
+	/// Glyph waiting for an encoder.
+	struct Job {
+		size_t index;
+		StoredCharacter character;
+		PendingSdf pending;
+	};
+
+	/// Work counters of one side of the stage.
+	struct StageCounters {
+		std::atomic<uint64_t> items = 0;          ///< Glyphs handled
+		std::atomic<uint64_t> busyNanoseconds = 0; ///< Time spent working, summed over threads
+	};
+
+	const SDFGenerationArguments& args;
+	GlyphCache* cache;
+	Sink sink;
+	size_t capacity;                            ///< Most images waiting for an encoder at once
+	size_t window;                              ///< Most indices past nextIndex submitted at once
+	unsigned generatorThreads;                  ///< Threads submitting glyphs, for the report
+
+	std::mutex queueMutex;                      ///< Guards queue, stopping and failure
+	std::condition_variable jobAvailable;
+	std::condition_variable spaceAvailable;
+	std::deque<Job> queue;
+	size_t encoding = 0;                        ///< Jobs taken by encoders and not yet delivered
+	bool stopping = false;
+	std::exception_ptr failure;
+	std::atomic<bool> failed = false;
+
+	std::mutex deliveryMutex;                   ///< Guards finished and nextIndex, serializes the sink
+	std::condition_variable windowAvailable;    ///< Signalled when nextIndex moves or the stage fails
+	std::map<size_t, StoredCharacter> finished; ///< Characters waiting for an earlier index
+	size_t nextIndex = 0;                       ///< Next index to hand to the sink
+
+	StageCounters generation;
+	StageCounters encoder;
+	std::atomic<uint64_t> blockedNanoseconds = 0; ///< Time generators waited for room in the queue or window
+	std::chrono::steady_clock::time_point started;
+	double wallSeconds = 0.0;                   ///< Set by finish()
+	std::vector<std::thread> threads;
+
+	void encoderLoop();
+	void deliver(size_t index, StoredCharacter&& character);
+	void fail(std::exception_ptr error);
+	void stop();
+
+public:
+	/**
+	 * @brief Start the encoder threads.
+	 * @param args Generation arguments (image format, SDF type, encoderThreads); must outlive the stage.
+	 * @param cache Glyph cache that encoded characters with a cache key are stored in (may be null).
+	 * @param generatorThreads Number of threads that will submit glyphs, used by report().
+	 * @param heldBack Most glyphs a generator may still hold while it submits later ones.
+	 * @param sink Receiver of finished characters.
+	 */
+	SdfEncodeStage(const SDFGenerationArguments& args, GlyphCache* cache, unsigned generatorThreads, size_t heldBack, Sink sink);
+
+	/**
+	 * @brief Stop the encoder threads, dropping glyphs that were not delivered yet.
+	 */
+	~SdfEncodeStage();
+
+	/**
+	 * @brief Hand over a generated glyph.
+	 *
+	 * Glyphs without a pending image skip the encoders and only wait for their turn. Blocks
+	 * until the index is within the window after the next index to deliver, then until the
+	 * queue has room.
+	 *
+	 * @param index Position of the glyph in the output.
+	 * @param character Character with everything but the SDF filled in.
+	 * @param pending Image to encode, taken over by the stage.
+	 * @param generationNanoseconds Time the generator spent on the glyph, for report().
+	 * @throws Whatever an encoder or the sink threw, if the stage already failed.
+	 */
+	void submit(size_t index, StoredCharacter&& character, PendingSdf&& pending, uint64_t generationNanoseconds);
+
+	/**
+	 * @brief Wait until every submitted glyph is delivered, then stop the encoder threads.
+	 * @throws Whatever an encoder or the sink threw first.
+	 */
+	void finish();
+
+	/**
+	 * @brief Describe the throughput and utilization of both stages, after finish().
+	 * @return Two-line report.
+	 */
+	QString report() const;
+};
+
+#endif // SDFENCODESTAGE_HPP
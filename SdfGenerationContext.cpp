@@ -10,8 +10,13 @@
  * - FreeType outline decomposition callbacks
  */
 
-#include "RGBA8888.hpp"
 #include "SdfGenerationContext.hpp"
+#include "MipPyramid.hpp"
+#include "FontKerningReader.hpp"
+#include "FontPackWriter.hpp"
+#include "TexelCodec.hpp"
+#include "SdfEncodeStage.hpp"
+#include "Profiler.hpp"
 #include <stdexcept>
 #include <QTextStream>
 #include <cstdint>
@@ -19,6 +24,13 @@
 #include <QBitArray>
 #include <cctype>
 #include <algorithm>
+#include <cmath>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <optional>
+#include <map>
+#include <omp.h>
 extern "C" {
 #include <svgtiny.h>
 }
@@ -73,22 +85,21 @@ static SvgDiagramPtr parseSvgDiagram(const QByteArray& buff)
 	return diagram;
 }
 
-static QImage downsampleImageForArgs(const QImage& img, const SDFGenerationArguments& args)
+/// Halve an image several times; the intermediate levels share one buffer instead of each getting a QImage.
+static void halveImage(QImage& img, const SDFGenerationArguments& args, int steps)
 {
-	return args.maximizeInsteadOfAverage
-			   ? SdfGenerationContext::dowsanmpleImageByMaxing(img)
-			   : SdfGenerationContext::downsampleImageByAveraging(img);
+	if(steps <= 0) return;
+	const MipPyramid pyramid(img, args.maximizeInsteadOfAverage, static_cast<size_t>(steps) + 1);
+	img = pyramid.level(pyramid.levelCount() - 1).copy();
 }
 
 static void downsampleToIntendedSize(QImage& img, const SDFGenerationArguments& args)
 {
+	Profiler::Scope profileScope("downsampling");
 	if(!args.intendedSize) return;
 	if(!args.internalProcessSize) throw std::runtime_error("Internal processing size must be greater than zero.");
 	const unsigned powerOfTwoTarget = nextPowerOf2(args.intendedSize);
-	const int steps = std::max(0, __builtin_clz(powerOfTwoTarget) - __builtin_clz(args.internalProcessSize));
-	for(int i = 0; i < steps; ++i) {
-		img = downsampleImageForArgs(img, args);
-	}
+	halveImage(img, args, __builtin_clz(powerOfTwoTarget) - __builtin_clz(args.internalProcessSize));
 	if(img.width() != static_cast<int>(args.intendedSize)) {
 		img = img.scaled(args.intendedSize,args.intendedSize,Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
 	}
@@ -96,13 +107,50 @@ static void downsampleToIntendedSize(QImage& img, const SDFGenerationArguments&
 
 static QByteArray encodeSdfImage(QImage img, const SDFGenerationArguments& args)
 {
-	if(args.type == SDFType::MSDF) img = img.convertToFormat(QImage::Format_RGB888);
-	QByteArray bytes;
-	QBuffer buff(&bytes);
-	buff.open(QIODevice::WriteOnly);
-	if(!img.save(&buff, args.imageFormat.constData(), -1)) throw std::runtime_error("Failed to save image!");
-	buff.close();
-	return bytes;
+	Profiler::Scope profileScope("encoding");
+	QByteArray encoded = TexelCodec::fromImage(std::move(img), args.imageFormat, args.type);
+	Profiler::count(Profiler::BYTES_ENCODED, encoded.size());
+	return encoded;
+}
+
+/// Encode a finished glyph SDF and cache it, or leave both to the encode stage when deferred.
+static void finishSdf(StoredCharacter& output, QImage& img, const SDFGenerationArguments& args, QByteArray& cacheKey, GlyphCache* glyphCache, PendingSdf* deferred)
+{
+	if(deferred) {
+		deferred->image = std::move(img);
+		deferred->cacheKey = std::move(cacheKey);
+		return;
+	}
+	output.sdf = encodeSdfImage(std::move(img), args);
+	if(glyphCache && !cacheKey.isEmpty()) glyphCache->store(cacheKey, output);
+}
+
+static void downsampleToTexelSize(QImage& img, const SDFGenerationArguments& args, uint32_t texelWidth, uint32_t texelHeight)
+{
+	Profiler::Scope profileScope("downsampling");
+	// Halve while both sides stay at or above the target, then scale the rest of the way
+	int steps = 0;
+	while((img.width() >> (steps + 1)) >= static_cast<int>(texelWidth) && (img.height() >> (steps + 1)) >= static_cast<int>(texelHeight)) ++steps;
+	halveImage(img, args, steps);
+	if(img.width() != static_cast<int>(texelWidth) || img.height() != static_cast<int>(texelHeight)) {
+		img = img.scaled(texelWidth, texelHeight, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+	}
+}
+
+/// Canvas (processing pixels) and texel size of a tight glyph cell around an ink box of inkWidth x inkHeight processing pixels.
+static void tightCellSize(uint32_t inkWidth, uint32_t inkHeight, const SDFGenerationArguments& args, uint32_t& canvasWidth, uint32_t& canvasHeight, uint32_t& texelWidth, uint32_t& texelHeight)
+{
+	// When the intended size divides the processing size, round the canvas up to whole texels so every glyph has the same texel density
+	const uint32_t step = (args.intendedSize && args.internalProcessSize % args.intendedSize == 0) ? args.internalProcessSize / args.intendedSize : 1;
+	canvasWidth = (inkWidth + 2 * args.padding + step - 1) / step * step;
+	canvasHeight = (inkHeight + 2 * args.padding + step - 1) / step * step;
+	if(!args.intendedSize) {
+		texelWidth = canvasWidth;
+		texelHeight = canvasHeight;
+		return;
+	}
+	texelWidth = std::max<uint32_t>(1, (uint64_t(canvasWidth) * args.intendedSize + args.internalProcessSize - 1) / args.internalProcessSize);
+	texelHeight = std::max<uint32_t>(1, (uint64_t(canvasHeight) * args.intendedSize + args.internalProcessSize - 1) / args.internalProcessSize);
 }
 
 static float effectiveDistanceRange(uint32_t samplesToCheck, const SDFGenerationArguments& args, uint32_t actualSize)
@@ -155,33 +203,33 @@ double SdfGenerationContext::convert16_16ToDouble(int32_t fixedPointValue) {
 
 int SdfGenerationContext::Outline_MoveToFunc(const FT_Vector* to, void* user)
 {
-	SdfGenerationContext* ctx = static_cast<SdfGenerationContext*>(user);
+	FontOutlineDecompositionContext* ctx = static_cast<FontOutlineDecompositionContext*>(user);
 	glm::fvec2 toConverted(convert26_6ToDouble(to->x), convert26_6ToDouble(to->y));
-	return ctx->decompositionContext.moveTo(toConverted);
+	return ctx->moveTo(toConverted);
 }
 
 int SdfGenerationContext::Outline_LineToFunc(const FT_Vector* to, void* user)
 {
-	SdfGenerationContext* ctx = static_cast<SdfGenerationContext*>(user);
+	FontOutlineDecompositionContext* ctx = static_cast<FontOutlineDecompositionContext*>(user);
 	glm::fvec2 toConverted(convert26_6ToDouble(to->x), convert26_6ToDouble(to->y));
-	return ctx->decompositionContext.lineTo(toConverted);
+	return ctx->lineTo(toConverted);
 }
 
 int SdfGenerationContext::Outline_ConicToFunc(const FT_Vector* control, const FT_Vector* to, void* user)
 {
-	SdfGenerationContext* ctx = static_cast<SdfGenerationContext*>(user);
+	FontOutlineDecompositionContext* ctx = static_cast<FontOutlineDecompositionContext*>(user);
 	glm::fvec2 controlConverted(convert26_6ToDouble(control->x), convert26_6ToDouble(control->y));
 	glm::fvec2 toConverted(convert26_6ToDouble(to->x), convert26_6ToDouble(to->y));
-	return ctx->decompositionContext.conicTo(controlConverted, toConverted);
+	return ctx->conicTo(controlConverted, toConverted);
 }
 
 int SdfGenerationContext::Outline_CubicToFunc(const FT_Vector* control1, const FT_Vector* control2, const FT_Vector* to, void* user)
 {
-	SdfGenerationContext* ctx = static_cast<SdfGenerationContext*>(user);
+	FontOutlineDecompositionContext* ctx = static_cast<FontOutlineDecompositionContext*>(user);
 	glm::fvec2 control1Converted(convert26_6ToDouble(control1->x), convert26_6ToDouble(control1->y));
 	glm::fvec2 control2Converted(convert26_6ToDouble(control2->x), convert26_6ToDouble(control2->y));
 	glm::fvec2 toConverted(convert26_6ToDouble(to->x), convert26_6ToDouble(to->y));
-	return ctx->decompositionContext.cubicTo(control1Converted, control2Converted, toConverted);
+	return ctx->cubicTo(control1Converted, control2Converted, toConverted);
 }
 
 SdfGenerationContext::SdfGenerationContext() {
@@ -196,46 +244,11 @@ SdfGenerationContext::~SdfGenerationContext()
 	FT_Done_FreeType( library );
 }
 
-uint8_t round4Num(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
-	uint32_t sum = static_cast<uint32_t>(r) + static_cast<uint32_t>(g) + static_cast<uint32_t>(b) + static_cast<uint32_t>(a);
-	return static_cast<uint8_t>( (sum + 2) / 4 );
-}
-
 QImage SdfGenerationContext::downsampleImageByAveraging(const QImage& src)
 {
 	QImage toReturn(src.width() / 2, src.height() / 2, src.format());
-	if(src.format() == QImage::Format_Grayscale8) {
-		for( int y = 0; y < toReturn.height(); ++y ) {
-			uchar* outputScanline = toReturn.scanLine(y);
-			const uchar* inputScanline0 = src.scanLine(y*2);
-			const uchar* inputScanline1 = src.scanLine( (y*2)+1 );
-			for ( int x = 0; x < toReturn.width() ; ++x ) {  // Fixed: ++x instead of ++y
-				uchar& output = outputScanline[x];
-				uchar in00 = inputScanline0[x*2];
-				uchar in01 = inputScanline0[(x*2)+1];
-				uchar in10 = inputScanline1[x*2];
-				uchar in11 = inputScanline1[(x*2)+1];
-				output = round4Num(in00,in01,in10,in11);
-			}
-		}
-	} else if (src.format() == QImage::Format_RGBA8888) {
-		for( int y = 0; y < toReturn.height(); ++y ) {
-			RGBA8888* outputScanline = reinterpret_cast<RGBA8888*>(toReturn.scanLine(y));
-			const RGBA8888* inputScanline0 = reinterpret_cast<const RGBA8888*>(src.scanLine(y*2));
-			const RGBA8888* inputScanline1 = reinterpret_cast<const RGBA8888*>(src.scanLine((y*2)+1));
-
-			for ( int x = 0; x < toReturn.width() ; ++x ) {
-				const RGBA8888& in00 = inputScanline0[x*2];
-				const RGBA8888& in01 = inputScanline0[(x*2)+1];
-				const RGBA8888& in10 = inputScanline1[x*2];
-				const RGBA8888& in11 = inputScanline1[(x*2)+1];
-
-				// Average components
-				RGBA8888 top = in00.averageWith(in01);
-				RGBA8888 bottom = in10.averageWith(in11);
-				outputScanline[x] = top.averageWith(bottom);
-			}
-		}
+	if(src.format() == QImage::Format_Grayscale8 || src.format() == QImage::Format_RGBA8888) {
+		MipPyramid::halve(src.constBits(), src.bytesPerLine(), toReturn.bits(), toReturn.bytesPerLine(), toReturn.width(), toReturn.height(), src.format(), false);
 	}
 	return toReturn;
 }
@@ -243,46 +256,21 @@ QImage SdfGenerationContext::downsampleImageByAveraging(const QImage& src)
 QImage SdfGenerationContext::dowsanmpleImageByMaxing(const QImage& src)
 {
 	QImage toReturn(src.width() / 2, src.height() / 2, src.format());
-	if(src.format() == QImage::Format_Grayscale8) {
-		for( int y = 0; y < toReturn.height(); ++y ) {
-			uchar* outputScanline = toReturn.scanLine(y);
-			const uchar* inputScanline0 = src.scanLine(y*2);
-			const uchar* inputScanline1 = src.scanLine( (y*2)+1 );
-			for ( int x = 0; x < toReturn.width() ; ++x ) {  // Fixed: ++x instead of ++y
-				uchar& output = outputScanline[x];
-				uchar in00 = inputScanline0[x*2];
-				uchar in01 = inputScanline0[(x*2)+1];
-				uchar in10 = inputScanline1[x*2];
-				uchar in11 = inputScanline1[(x*2)+1];
-				output = std::max( std::max(in00,in01), std::max(in10,in11) );
-			}
-		}
-	} else if (src.format() == QImage::Format_RGBA8888) {
-		for( int y = 0; y < toReturn.height(); ++y ) {
-			RGBA8888* outputScanline = reinterpret_cast<RGBA8888*>(toReturn.scanLine(y));
-			const RGBA8888* inputScanline0 = reinterpret_cast<const RGBA8888*>(src.scanLine(y*2));
-			const RGBA8888* inputScanline1 = reinterpret_cast<const RGBA8888*>(src.scanLine((y*2)+1));
-
-			for ( int x = 0; x < toReturn.width() ; ++x ) {
-				const RGBA8888& in00 = inputScanline0[x*2];
-				const RGBA8888& in01 = inputScanline0[(x*2)+1];
-				const RGBA8888& in10 = inputScanline1[x*2];
-				const RGBA8888& in11 = inputScanline1[(x*2)+1];
-
-				// Max components
-				RGBA8888 top = in00.maxWith(in01);
-				RGBA8888 bottom = in10.maxWith(in11);
-				outputScanline[x] = top.maxWith(bottom);
-			}
-		}
+	if(src.format() == QImage::Format_Grayscale8 || src.format() == QImage::Format_RGBA8888) {
+		MipPyramid::halve(src.constBits(), src.bytesPerLine(), toReturn.bits(), toReturn.bytesPerLine(), toReturn.width(), toReturn.height(), src.format(), true);
 	}
 	return toReturn;
 }
 
 void SdfGenerationContext::processOutlineGlyph(StoredCharacter& output, FT_GlyphSlot glyphSlot, const SDFGenerationArguments& args)
+{
+	processOutlineGlyph(output, glyphSlot, args, decompositionContext);
+}
+
+void SdfGenerationContext::processOutlineGlyph(StoredCharacter& output, FT_GlyphSlot glyphSlot, const SDFGenerationArguments& args, FontOutlineDecompositionContext& decomposition, PendingSdf* deferred)
 {
 	output.valid = true;
-	decompositionContext.clear();
+	decomposition.clear();
 	output.width = glyphSlot->bitmap.width;
 	output.height = glyphSlot->bitmap.rows;
 	output.bearing_x = glyphSlot->bitmap_left;
@@ -297,24 +285,97 @@ void SdfGenerationContext::processOutlineGlyph(StoredCharacter& output, FT_Glyph
 	output.vertBearingX = convert26_6ToDouble(glyphSlot->metrics.vertBearingX);
 	output.vertBearingY = convert26_6ToDouble(glyphSlot->metrics.vertBearingY);
 	output.vertAdvance = convert26_6ToDouble(glyphSlot->metrics.vertAdvance);
-	auto orientation = FT_Outline_Get_Orientation(&glyphSlot->outline);
-	FT_Outline_Decompose(&glyphSlot->outline,&outlineFuncs,this);
-	decompositionContext.closeShape();
-	decompositionContext.makeShapeIdsSigend( orientation != FT_ORIENTATION_TRUETYPE);
-	decompositionContext.orientContours();
-	processOutlineGlyphEnd(output, args);
+	{
+		Profiler::Scope profileScope("FT_Outline_Decompose");
+		auto orientation = FT_Outline_Get_Orientation(&glyphSlot->outline);
+		FT_Outline_Decompose(&glyphSlot->outline,&outlineFuncs,&decomposition);
+		decomposition.closeShape();
+		decomposition.makeShapeIdsSigend( orientation != FT_ORIENTATION_TRUETYPE);
+	}
+	Profiler::count(Profiler::EDGES, decomposition.edges.size());
+	{
+		Profiler::Scope profileScope("orientContours");
+		decomposition.orientContours();
+	}
+	if(args.tightBounds) processTightOutlineGlyphEnd(output, decomposition, args, deferred);
+	else processOutlineGlyphEnd(output, decomposition, args, true, deferred);
 }
 
-void SdfGenerationContext::processOutlineGlyphEnd(StoredCharacter& output, const SDFGenerationArguments& args, bool flipY)
+void SdfGenerationContext::processOutlineGlyphEnd(StoredCharacter& output, FontOutlineDecompositionContext& decomposition, const SDFGenerationArguments& args, bool flipY, PendingSdf* deferred)
 {
-	decompositionContext.translateToNewSize(args.internalProcessSize,args.internalProcessSize,args.padding,args.padding, output.metricWidth, output.metricHeight, output.horiBearingX, output.horiBearingY, flipY);
-	if(args.msdfgenColouring) decompositionContext.assignColoursMsdfgen();
-	else decompositionContext.assignColours();
+	decomposition.translateToNewSize(args.internalProcessSize,args.internalProcessSize,args.padding,args.padding, output.metricWidth, output.metricHeight, output.horiBearingX, output.horiBearingY, flipY);
+	renderOutlineGlyph(output, decomposition, args, args.internalProcessSize, args.internalProcessSize, false, deferred);
+}
 
-	QImage img = produceOutlineSdf(decompositionContext, args);
+void SdfGenerationContext::processTightOutlineGlyphEnd(StoredCharacter& output, FontOutlineDecompositionContext& decomposition, const SDFGenerationArguments& args, PendingSdf* deferred)
+{
+	// Grid-fit the ink box the way FreeType places rendered bitmaps, so outline and raster glyphs share one placement rule
+	const float left = std::floor(output.horiBearingX);
+	const float top = std::ceil(output.horiBearingY);
+	const float right = std::ceil(output.horiBearingX + output.metricWidth);
+	const float bottom = std::floor(output.horiBearingY - output.metricHeight);
+	output.bearing_x = static_cast<int32_t>(left);
+	output.bearing_y = static_cast<int32_t>(top);
+	uint32_t canvasWidth, canvasHeight;
+	tightCellSize(static_cast<uint32_t>(right - left), static_cast<uint32_t>(top - bottom), args, canvasWidth, canvasHeight, output.width, output.height);
+	decomposition.translateToOrigin(left - static_cast<float>(args.padding), top + static_cast<float>(args.padding));
+	renderOutlineGlyph(output, decomposition, args, canvasWidth, canvasHeight, true, deferred);
+}
 
-	downsampleToIntendedSize(img, args);
-	output.sdf = encodeSdfImage(img, args);
+void SdfGenerationContext::renderOutlineGlyph(StoredCharacter& output, FontOutlineDecompositionContext& decomposition, const SDFGenerationArguments& args, uint32_t canvasWidth, uint32_t canvasHeight, bool tightCell, PendingSdf* deferred)
+{
+	if(args.msdfgenColouring) {
+		Profiler::Scope profileScope("assignColoursMsdfgen");
+		decomposition.assignColoursMsdfgen();
+	} else {
+		Profiler::Scope profileScope("assignColours");
+		decomposition.assignColours();
+	}
+
+	QByteArray cacheKey;
+	if(glyphCache) {
+		Profiler::Scope profileScope("cache lookup");
+		cacheKey = GlyphCache::outlineKey(output, decomposition, args);
+		if(glyphCache->load(cacheKey, output)) return;
+	}
+
+	if(outlineQueue && !tightCell && !(args.supersample && args.intendedSize)) {
+		// processFont() fills in the rest of the entry and renders it with its batch
+		QueuedOutline& queued = outlineQueue->emplace_back();
+		std::swap(queued.decomposition, decomposition);
+		queued.cacheKey = std::move(cacheKey);
+		return;
+	}
+
+	QImage img;
+	if(args.supersample && args.intendedSize) {
+		img = tightCell ? produceDirectOutlineSdf(decomposition, args, canvasWidth, canvasHeight, output.width, output.height)
+						: produceDirectOutlineSdf(decomposition, args, canvasWidth, canvasHeight, args.intendedSize, args.intendedSize);
+	} else {
+		img = produceOutlineSdf(decomposition, args, canvasWidth, canvasHeight);
+		if(tightCell) downsampleToTexelSize(img, args, output.width, output.height);
+		else downsampleToIntendedSize(img, args);
+	}
+	finishSdf(output, img, args, cacheKey, glyphCache.get(), deferred);
+}
+
+QImage SdfGenerationContext::produceDirectOutlineSdf(FontOutlineDecompositionContext& decomposition, const SDFGenerationArguments& args, uint32_t canvasWidth, uint32_t canvasHeight, uint32_t texelWidth, uint32_t texelHeight)
+{
+	const uint32_t samples = std::max<uint32_t>(1, args.supersample);
+	const float scaleX = static_cast<float>(texelWidth * samples) / static_cast<float>(canvasWidth);
+	const float scaleY = static_cast<float>(texelHeight * samples) / static_cast<float>(canvasHeight);
+	decomposition.scale(scaleX, scaleY);
+	// Keep the distance range: the search window shrinks with the grid
+	SDFGenerationArguments sampled = args;
+	const float searchWidth = static_cast<float>(args.samples_to_check_x ? args.samples_to_check_x / 2 : args.padding);
+	const float searchHeight = static_cast<float>(args.samples_to_check_y ? args.samples_to_check_y / 2 : args.padding);
+	sampled.samples_to_check_x = 2 * std::max<uint32_t>(1, static_cast<uint32_t>(std::lround(searchWidth * scaleX)));
+	sampled.samples_to_check_y = 2 * std::max<uint32_t>(1, static_cast<uint32_t>(std::lround(searchHeight * scaleY)));
+	sampled.padding = std::max<uint32_t>(1, static_cast<uint32_t>(std::lround(args.padding * std::min(scaleX, scaleY))));
+	QImage img = produceOutlineSdf(decomposition, sampled, texelWidth * samples, texelHeight * samples);
+	Profiler::Scope profileScope("downsampling");
+	halveImage(img, args, __builtin_ctz(samples));
+	return img;
 }
 
 void SdfGenerationContext::processOutlineGlyphEnd(StoredVectorImage& output, const SDFGenerationArguments& args, bool flipY)
@@ -330,7 +391,7 @@ void SdfGenerationContext::processOutlineGlyphEnd(StoredVectorImage& output, con
 	if(args.msdfgenColouring) decompositionContext.assignColoursMsdfgen();
 	else decompositionContext.assignColours();
 
-	QImage img = produceOutlineSdf(decompositionContext, args);
+	QImage img = produceOutlineSdf(decompositionContext, args, args.internalProcessSize, args.internalProcessSize);
 	downsampleToIntendedSize(img, args);
 
 	output.actualSize = static_cast<uint32_t>(img.width());
@@ -339,10 +400,9 @@ void SdfGenerationContext::processOutlineGlyphEnd(StoredVectorImage& output, con
 	output.encodingFlags = vectorEncodingFlags(args);
 	output.midpointAdjustment = args.midpointAdjustment.value_or(1.0f);
 
-	while(true) {
-		output.mipmaps.push_back(encodeSdfImage(img, args));
-		if(!args.createMipmaps || img.width() <= 1 || img.height() <= 1) break;
-		img = downsampleImageForArgs(img, args);
+	const MipPyramid pyramid(img, args.maximizeInsteadOfAverage, args.createMipmaps ? 0 : 1);
+	for(size_t level = 0; level < pyramid.levelCount(); ++level) {
+		output.mipmaps.push_back(encodeSdfImage(pyramid.level(level), args));
 	}
 }
 
@@ -390,9 +450,13 @@ QImage SdfGenerationContext::FTBitmap2QImage(const FT_Bitmap_& bitmap, unsigned
 	return toReturn;
 }
 
-void SdfGenerationContext::processBitmapGlyph(StoredCharacter& output, FT_GlyphSlot glyphSlot, const SDFGenerationArguments& args)
+void SdfGenerationContext::processBitmapGlyph(StoredCharacter& output, FT_GlyphSlot glyphSlot, const SDFGenerationArguments& args, PendingSdf* deferred)
 {
-	auto error = FT_Render_Glyph( glyphSlot, FT_RENDER_MODE_NORMAL);
+	FT_Error error;
+	{
+		Profiler::Scope profileScope("FT_Render_Glyph");
+		error = FT_Render_Glyph( glyphSlot, FT_RENDER_MODE_NORMAL);
+	}
 	if ( error ) {
 		output.valid = false; // Will be removed after the fact.
 		return;
@@ -421,23 +485,83 @@ void SdfGenerationContext::processBitmapGlyph(StoredCharacter& output, FT_GlyphS
 	}
 	output.valid = true;
 
+	if(args.tightBounds) {
+		// Keep the rendered bitmap at the face scale; its origin is already bitmap_left/bitmap_top
+		uint32_t canvasWidth, canvasHeight;
+		tightCellSize(glyphSlot->bitmap.width, glyphSlot->bitmap.rows, args, canvasWidth, canvasHeight, output.width, output.height);
+		QImage oldImg = FTBitmap2QImage(glyphSlot->bitmap, 0, 0);
+		oldImg = producePaddedVariantOfImage(oldImg, padding);
+		if(oldImg.width() != static_cast<int>(canvasWidth) || oldImg.height() != static_cast<int>(canvasHeight)) {
+			QImage canvas(canvasWidth, canvasHeight, QImage::Format_Grayscale8);
+			canvas.fill(0);
+			for(int y = 0; y < oldImg.height(); ++y) {
+				memcpy(canvas.scanLine(y), oldImg.constScanLine(y), oldImg.width());
+			}
+			oldImg = canvas;
+		}
+		QImage img = produceBitmapSdf(oldImg, args);
+		downsampleToTexelSize(img, args, output.width, output.height);
+		QByteArray noCacheKey;
+		finishSdf(output, img, args, noCacheKey, nullptr, deferred);
+		return;
+	}
+
 	QImage oldImg = FTBitmap2QImage(glyphSlot->bitmap, args.internalProcessSize - (args.padding*2), args.internalProcessSize - (args.padding*2));
 	oldImg = producePaddedVariantOfImage(oldImg, padding);
 	QImage img = produceBitmapSdf(oldImg, args);
 
 	downsampleToIntendedSize(img, args);
-	output.sdf = encodeSdfImage(img, args);
+	QByteArray noCacheKey;
+	finishSdf(output, img, args, noCacheKey, nullptr, deferred);
 }
 
-void SdfGenerationContext::processFont(PreprocessedFontFace& output, const SDFGenerationArguments& args)
+bool SdfGenerationContext::supportsConcurrentGlyphs() const
+{
+	return false;
+}
+
+std::vector<QImage> SdfGenerationContext::produceOutlineSdfs(std::span<const FontOutlineDecompositionContext* const> sources, const SDFGenerationArguments& args)
+{
+	std::vector<QImage> images;
+	images.reserve(sources.size());
+	for(const FontOutlineDecompositionContext* source : sources) {
+		images.push_back(produceOutlineSdf(*source, args, args.internalProcessSize, args.internalProcessSize));
+	}
+	return images;
+}
+
+size_t SdfGenerationContext::outlineBatchSize(const SDFGenerationArguments& args) const
+{
+	(void)args;
+	return 1;
+}
+
+void SdfGenerationContext::submitOutlineSdfs(std::span<const FontOutlineDecompositionContext* const> sources, const SDFGenerationArguments& args)
+{
+	submittedOutlineSdfs.push_back(produceOutlineSdfs(sources, args));
+}
+
+std::vector<QImage> SdfGenerationContext::collectOutlineSdfs(const SDFGenerationArguments& args)
+{
+	(void)args;
+	if(submittedOutlineSdfs.empty()) throw std::runtime_error("No outline batch was submitted!");
+	std::vector<QImage> images = std::move(submittedOutlineSdfs.front());
+	submittedOutlineSdfs.pop_front();
+	return images;
+}
+
+void SdfGenerationContext::discardOutlineSdfs()
+{
+	submittedOutlineSdfs.clear();
+}
+
+size_t SdfGenerationContext::outlineBatchesInFlight() const
+{
+	return 0;
+}
+
+FT_Face SdfGenerationContext::openFontFace(FT_Library library, const SDFGenerationArguments& args)
 {
-	output.version = PreprocessedFontFace::CURRENT_VERSION;
-	output.type = args.type;
-	output.distType = args.distType;
-	output.bitmap_size = args.intendedSize;
-	output.bitmap_logical_size = args.internalProcessSize;
-	output.bitmap_padding = args.padding;
-	output.setImageFormat(args.imageFormat);
 	unsigned to_scale = args.internalProcessSize - args.padding;
 	FT_Face face;
 	auto fpath = args.font_path.toStdString();
@@ -450,62 +574,297 @@ void SdfGenerationContext::processFont(PreprocessedFontFace& output, const SDFGe
 	{
 		throw std::runtime_error("Font file could not be read! Does it even exist?");
 	}
-	output.hasVert = FT_HAS_VERTICAL(face);
-	output.fontFamilyName = QString::fromUtf8(face->family_name);
 	error = FT_Set_Pixel_Sizes(face,to_scale,to_scale);
 	if ( error ) {
+		FT_Done_Face(face);
 		throw std::runtime_error("Failed to set character sizes.");
 	}
+	FT_Set_Transform(face,nullptr,nullptr);
+	return face;
+}
+
+void SdfGenerationContext::processGlyph(StoredCharacter& output, FT_Face face, uint32_t glyphIndex, const SDFGenerationArguments& args, FontOutlineDecompositionContext& decomposition, PendingSdf* deferred)
+{
+	Profiler::Scope profileScope("glyph");
+	Profiler::count(Profiler::GLYPHS, 1);
+	FT_Error error;
+	{
+		Profiler::Scope loadScope("FT_Load_Glyph");
+		error = FT_Load_Glyph(face,glyphIndex,FT_LOAD_NO_BITMAP);
+	}
+	if ( error ) throw std::runtime_error("Failed to load glyph.");
+	if( (face->glyph->outline.n_contours && face->glyph->outline.n_points) && !args.forceRaster ) {
+		processOutlineGlyph(output,face->glyph, args, decomposition, deferred);
+	} else {
+		processBitmapGlyph(output,face->glyph, args, deferred);
+	}
+}
+
+void SdfGenerationContext::processFont(PreprocessedFontFace& output, const SDFGenerationArguments& args, FontPackWriter* streamTo)
+{
+	output.version = PreprocessedFontFace::CURRENT_VERSION;
+	output.type = args.type;
+	output.distType = args.distType;
+	output.bitmap_size = args.intendedSize;
+	output.bitmap_logical_size = args.internalProcessSize;
+	output.bitmap_padding = args.padding;
+	output.setImageFormat(args.imageFormat);
+	output.tightBounds = args.tightBounds;
+	glyphCache.reset();
+	if(!args.cacheDirectory.isEmpty()) glyphCache = std::make_unique<GlyphCache>(args.cacheDirectory, qint64(args.cacheSizeMiB) * 1024 * 1024);
+	FT_Face face = openFontFace(library, args);
+	output.hasVert = FT_HAS_VERTICAL(face);
+	output.fontFamilyName = QString::fromUtf8(face->family_name);
 	output.ascender = convert26_6ToDouble(face->size->metrics.ascender);
 	output.descender = convert26_6ToDouble(face->size->metrics.descender);
 	output.faceHeight = convert26_6ToDouble(face->size->metrics.height);
 	output.maxAdvance = convert26_6ToDouble(face->size->metrics.max_advance);
 	output.unitsPerEm = face->units_per_EM;
-	FT_Set_Transform(face,nullptr,nullptr);
-	if ( error ) {
-		throw std::runtime_error("Failed to set transform.");
-	}
-	auto minChar = args.char_min;
-	auto maxChar = args.char_max;
 
-	QMap<uint32_t,uint32_t> charcodeToGlyphIndex;
-	for(uint32_t charcode = minChar; charcode < maxChar; ++charcode) {
-		auto glyph_index = FT_Get_Char_Index( face, charcode );
-		if(glyph_index) {
-			error = FT_Load_Glyph(face,glyph_index,FT_LOAD_NO_BITMAP);
-			if ( error ) throw std::runtime_error("Failed to load glyph.");
-			StoredCharacter strdChr{};
-			if( (face->glyph->outline.n_contours && face->glyph->outline.n_points) && !args.forceRaster ) {
-				processOutlineGlyph(strdChr,face->glyph, args);
-			} else {
-				processBitmapGlyph(strdChr,face->glyph, args);
+	// Walk the charmap instead of probing every code point of the range: a small font only has a few
+	// hundred entries. Charcodes come out in ascending order, which also fixes the order of the results.
+	std::vector<std::pair<uint32_t,uint32_t>> glyphs;
+	FT_UInt glyph_index = 0;
+	for(FT_ULong charcode = FT_Get_First_Char(face, &glyph_index); glyph_index && charcode < args.char_max; charcode = FT_Get_Next_Char(face, charcode, &glyph_index)) {
+		if(args.includesCharcode(charcode)) glyphs.emplace_back(charcode, glyph_index);
+	}
+	// When streaming, finished glyphs go straight to the pack and only their validity is kept
+	output.storedCharacters.clear();
+	std::vector<StoredCharacter> results(streamTo ? 0 : glyphs.size());
+	std::vector<uint8_t> validGlyphs(glyphs.size(), 0);
+	if(streamTo) streamTo->writeHeader(output);
+	// Concurrent workers finish glyphs out of order; streamed ones wait here for the earlier
+	// indices so the records land in glyph order, like the encode stage delivers them
+	std::map<size_t, StoredCharacter> unwritten;
+	size_t nextToWrite = 0;
+	auto finishGlyph = [&](size_t i, StoredCharacter& character) {
+		validGlyphs[i] = character.valid;
+		if(!streamTo) {
+			if(character.valid) results[i] = std::move(character);
+			return;
+		}
+		// Exceptions may not leave a critical section, so a failed write is rethrown after it
+		std::exception_ptr writeFailure;
+#pragma omp critical(fontPackWriter)
+		{
+			try {
+				unwritten.emplace(i, std::move(character));
+				for(auto it = unwritten.begin(); it != unwritten.end() && it->first == nextToWrite; it = unwritten.erase(it)) {
+					if(it->second.valid) streamTo->writeGlyph(glyphs[it->first].first, it->second);
+					++nextToWrite;
+				}
+			} catch(...) {
+				writeFailure = std::current_exception();
+			}
+		}
+		if(writeFailure) std::rethrow_exception(writeFailure);
+	};
+
+	const int threadCount = args.threads ? static_cast<int>(args.threads) : omp_get_max_threads();
+	const bool concurrent = threadCount > 1 && glyphs.size() > 1 && supportsConcurrentGlyphs();
+	// With encoder threads, generators only hand over finished images; the stage delivers them in glyph order
+	const size_t batchSize = outlineBatchSize(args);
+	const size_t batchesInFlight = outlineBatchesInFlight();
+	// Serial batches hold outline glyphs back while the glyphs after them are submitted
+	const size_t heldBack = (!concurrent && batchSize > 1) ? batchSize * (batchesInFlight + 1) : 0;
+	std::unique_ptr<SdfEncodeStage> encodeStage;
+	if(args.encoderThreads) encodeStage = std::make_unique<SdfEncodeStage>(args, glyphCache.get(), concurrent ? threadCount : 1, heldBack, finishGlyph);
+	// Outline glyphs renderOutlineGlyph() queued while outlineQueue points here (serial runs only),
+	// then batches submitted to the engine and not collected yet, oldest first
+	std::vector<QueuedOutline> queuedOutlines;
+	std::deque<std::vector<QueuedOutline>> submittedOutlines;
+	auto collectOutlines = [&]() {
+		std::vector<QueuedOutline> batch = std::move(submittedOutlines.front());
+		submittedOutlines.pop_front();
+		const auto start = std::chrono::steady_clock::now();
+		std::vector<QImage> images = collectOutlineSdfs(args);
+		const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+		const uint64_t share = static_cast<uint64_t>(elapsed.count()) / batch.size();
+		for(size_t j = 0; j < batch.size(); ++j) {
+			QueuedOutline& queued = batch[j];
+			downsampleToIntendedSize(images[j], args);
+			if(!encodeStage) {
+				finishSdf(queued.character, images[j], args, queued.cacheKey, glyphCache.get(), nullptr);
+				finishGlyph(queued.index, queued.character);
+				continue;
 			}
-			if(strdChr.valid) {
-				output.storedCharacters.insert(charcode, strdChr);
-				charcodeToGlyphIndex.insert(charcode,glyph_index);
+			PendingSdf pending;
+			finishSdf(queued.character, images[j], args, queued.cacheKey, glyphCache.get(), &pending);
+			encodeStage->submit(queued.index, std::move(queued.character), std::move(pending), queued.generationNanoseconds + share);
+		}
+	};
+	auto submitQueuedOutlines = [&]() {
+		if(queuedOutlines.empty()) return;
+		const auto start = std::chrono::steady_clock::now();
+		std::vector<const FontOutlineDecompositionContext*> sources;
+		sources.reserve(queuedOutlines.size());
+		for(const QueuedOutline& queued : queuedOutlines) sources.push_back(&queued.decomposition);
+		submitOutlineSdfs(sources, args);
+		const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+		for(QueuedOutline& queued : queuedOutlines) queued.generationNanoseconds += static_cast<uint64_t>(elapsed.count()) / queuedOutlines.size();
+		submittedOutlines.push_back(std::move(queuedOutlines));
+		queuedOutlines.clear();
+		while(submittedOutlines.size() > batchesInFlight) collectOutlines();
+	};
+	auto generateGlyph = [&](size_t i, FT_Face glyphFace, FontOutlineDecompositionContext& decomposition) {
+		StoredCharacter character{};
+		PendingSdf pending;
+		const size_t alreadyQueued = queuedOutlines.size();
+		const auto start = std::chrono::steady_clock::now();
+		processGlyph(character, glyphFace, glyphs[i].second, args, decomposition, encodeStage ? &pending : nullptr);
+		const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+		if(queuedOutlines.size() > alreadyQueued) {
+			QueuedOutline& queued = queuedOutlines.back();
+			queued.index = i;
+			queued.character = std::move(character);
+			queued.generationNanoseconds = static_cast<uint64_t>(elapsed.count());
+			if(queuedOutlines.size() >= batchSize) submitQueuedOutlines();
+			return;
+		}
+		if(!encodeStage) {
+			finishGlyph(i, character);
+			return;
+		}
+		encodeStage->submit(i, std::move(character), std::move(pending), static_cast<uint64_t>(elapsed.count()));
+	};
+	if(concurrent) {
+		// FreeType faces and decomposition contexts are not thread-safe, so every worker opens its own.
+		// The per-pixel loops inside the engine are nested regions and run on the worker alone.
+		std::exception_ptr failure;
+		std::atomic<bool> failed = false;
+#pragma omp parallel num_threads(threadCount)
+		{
+			FT_Library threadLibrary = nullptr;
+			FT_Face threadFace = nullptr;
+			FontOutlineDecompositionContext threadDecomposition;
+			try {
+				if(FT_Init_FreeType(&threadLibrary)) throw std::runtime_error("An error occurred during library initialization!");
+				threadFace = openFontFace(threadLibrary, args);
+			} catch(...) {
+#pragma omp critical
+				if(!failure) failure = std::current_exception();
+				failed = true;
 			}
+#pragma omp for schedule(dynamic)
+			for(size_t i = 0; i < glyphs.size(); ++i) {
+				if(failed) continue;
+				try {
+					generateGlyph(i, threadFace, threadDecomposition);
+				} catch(...) {
+#pragma omp critical
+					if(!failure) failure = std::current_exception();
+					failed = true;
+				}
+			}
+			if(threadFace) FT_Done_Face(threadFace);
+			if(threadLibrary) FT_Done_FreeType(threadLibrary);
+		}
+		if(failure) {
+			encodeStage.reset();
+			FT_Done_Face(face);
+			std::rethrow_exception(failure);
+		}
+	} else {
+		if(batchSize > 1) outlineQueue = &queuedOutlines;
+		try {
+			for(size_t i = 0; i < glyphs.size(); ++i) generateGlyph(i, face, decompositionContext);
+			submitQueuedOutlines();
+			while(!submittedOutlines.empty()) collectOutlines();
+		} catch(...) {
+			outlineQueue = nullptr;
+			discardOutlineSdfs();
+			encodeStage.reset();
+			FT_Done_Face(face);
+			throw;
+		}
+		outlineQueue = nullptr;
+	}
+	if(encodeStage) {
+		try {
+			encodeStage->finish();
+		} catch(...) {
+			FT_Done_Face(face);
+			throw;
 		}
+		QTextStream(stdout) << encodeStage->report() << '\n';
+		encodeStage.reset();
 	}
 
+	QMap<uint32_t,uint32_t> charcodeToGlyphIndex;
+	for(size_t i = 0; i < glyphs.size(); ++i) {
+		if(validGlyphs[i]) charcodeToGlyphIndex.insert(glyphs[i].first, glyphs[i].second);
+	}
+	if(!streamTo) {
+		qsizetype sdfBytes = 0;
+		for(const StoredCharacter& result : results) sdfBytes += result.sdf.size();
+		output.storedCharacters.reserve(glyphs.size(), sdfBytes);
+		for(size_t i = 0; i < glyphs.size(); ++i) {
+			if(validGlyphs[i]) output.storedCharacters.insert(glyphs[i].first, results[i]);
+		}
+		results.clear();
+	}
 
-	if( FT_HAS_KERNING(face) )
+
+	// Ended before the pack is finished, so serialization does not show up as part of kerning
+	std::optional<Profiler::Scope> kerningScope(std::in_place, "kerning");
+	// The tables list glyph pairs, while kerning is stored per code point (several may share a glyph).
+	// Pairs are collected in order of precedence; the kerning table keeps the first one given for a pair.
+	std::vector<bool> keptGlyphs(face->num_glyphs, false);
+	QMultiMap<uint32_t,uint32_t> glyphIndexToCharcodes;
+	for( auto it = std::begin(charcodeToGlyphIndex); it != std::end(charcodeToGlyphIndex); ++it) {
+		keptGlyphs[it.value()] = true;
+		glyphIndexToCharcodes.insert(it.value(), it.key());
+	}
+	std::vector<KerningTable::Entry> kerningEntries;
+	auto storeKerning = [&](uint32_t left, uint32_t right, const Vec2f& kerning) {
+		for(const uint32_t first : glyphIndexToCharcodes.values(left)) {
+			for(const uint32_t second : glyphIndexToCharcodes.values(right)) {
+				kerningEntries.push_back({ first, second, kerning });
+			}
+		}
+	};
+	const FontKerningReader kerningReader(face, keptGlyphs);
+	if( FT_HAS_KERNING(face) && !kerningReader.hasKernTable() )
 	{
+		// No table to enumerate (e.g. Type 1 fonts with AFM metrics), so every pair has to be probed
 		FT_Vector kernVector;
 		for( auto it = std::begin(charcodeToGlyphIndex); it != std::end(charcodeToGlyphIndex); ++it) {
-			PerCharacterKerning tmpKern;
 			for( auto zt = std::begin(charcodeToGlyphIndex); zt != std::end(charcodeToGlyphIndex); ++zt) {
 				auto gotKerning = FT_Get_Kerning(face, it.value(), zt.value(), FT_KERNING_DEFAULT, &kernVector);
 				if(!gotKerning && (kernVector.x || kernVector.y)) {
 					Vec2f tmpVec;
 					tmpVec.first = convert26_6ToDouble(kernVector.x);
 					tmpVec.second = convert26_6ToDouble(kernVector.y);
-					tmpKern.insert(zt.key(),tmpVec);
+					kerningEntries.push_back({ it.key(), zt.key(), tmpVec });
 				}
 			}
-			if(tmpKern.size()) output.kerning.insert(it.key(),tmpKern);
 		}
 	}
+	else if( FT_HAS_KERNING(face) )
+	{
+		FT_Vector kernVector;
+		for(const auto& pair : kerningReader.getKernPairs()) {
+			auto gotKerning = FT_Get_Kerning(face, pair.first, pair.second, FT_KERNING_DEFAULT, &kernVector);
+			if(!gotKerning && (kernVector.x || kernVector.y)) {
+				storeKerning(pair.first, pair.second, Vec2f(convert26_6ToDouble(kernVector.x), convert26_6ToDouble(kernVector.y)));
+			}
+		}
+	}
+	// GPOS only fills in pairs the kern table leaves out, so fonts that have one keep their previous kerning
+	for(const auto& it : kerningReader.getGposPairs()) {
+		// Scaled and grid-fitted the way FT_KERNING_DEFAULT treats kern table values
+		const FT_Pos kerning = (FT_MulFix(it.second, face->size->metrics.x_scale) + 32) & -64;
+		if(kerning) storeKerning(it.first.first, it.first.second, Vec2f(convert26_6ToDouble(kerning), 0.0f));
+	}
+	output.kerning.assign(std::move(kerningEntries));
+	kerningScope.reset();
+	if(streamTo) streamTo->finish(output.kerning);
 	FT_Done_Face(face);
+	if(glyphCache) {
+		glyphCache->evict();
+		QTextStream(stdout) << glyphCache->report() << '\n';
+		glyphCache.reset();
+	}
 }
 
 void SdfGenerationContext::processSvg(PreprocessedFontFace& output, const QByteArray& buff, const SDFGenerationArguments& args)
@@ -518,6 +877,7 @@ void SdfGenerationContext::processSvg(PreprocessedFontFace& output, const QByteA
 	output.bitmap_logical_size = args.internalProcessSize;
 	output.bitmap_padding = args.padding;
 	output.setImageFormat(args.imageFormat);
+	output.tightBounds = false;
 	output.hasVert = false;
 	output.fontFamilyName = QStringLiteral("SVG");
 	output.ascender = diagram->height;
@@ -607,7 +967,7 @@ void SdfGenerationContext::processSvgShape(StoredCharacter& output, const svgtin
 	decompositionContext.clear();
 	decomposeSvgShape(decompositionContext, shape, isFirstShape);
 	//decompositionContext.orientContours();
-	processOutlineGlyphEnd(output,args,false);
+	processOutlineGlyphEnd(output,decompositionContext,args,false);
 }
 
 void SdfGenerationContext::processSvgShape(StoredVectorImage& output, const svgtiny_shape& shape, const SDFGenerationArguments& args, bool isFirstShape)
@@ -637,7 +997,7 @@ void SdfGenerationContext::processSvgShapes(StoredCharacter& output, const std::
 		isFirstShape = false;
 	}
 	//decompositionContext.orientContours();
-	processOutlineGlyphEnd(output,args,false);
+	processOutlineGlyphEnd(output,decompositionContext,args,false);
 }
 
 void SdfGenerationContext::processSvgShapes(StoredVectorImage& output, const std::span<const svgtiny_shape>& shapes, const SDFGenerationArguments& args)
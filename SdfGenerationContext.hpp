@@ -15,6 +15,11 @@
 #include "StoredCharacter.hpp"
 #include "StoredVectorImage.hpp"
 #include "FontOutlineDecompositionContext.hpp"
+#include "GlyphCache.hpp"
+#include <deque>
+#include <memory>
+#include <span>
+#include <vector>
 #include <harfbuzz/hb-ft.h>
 #include <ft2build.h>
 #include FT_FREETYPE_H
@@ -22,6 +27,8 @@
 
 struct FT_Bitmap_;
 struct svgtiny_shape;
+class FontPackWriter;
+struct PendingSdf;
 
 /**
  * @brief Abstract base class for SDF generation contexts.
@@ -35,10 +42,36 @@ private:
 	/**
 	 * @brief Finalize outline glyph processing and generate SDF.
 	 * @param output Output character structure to populate.
+	 * @param decomposition Decomposed outline of the glyph.
 	 * @param args Generation arguments.
 	 * @param flipY Whether to flip Y coordinates (default: true).
+	 * @param deferred If not null, receives the SDF image instead of output.sdf, to be encoded later.
 	 */
-	void processOutlineGlyphEnd(StoredCharacter& output, const SDFGenerationArguments& args, bool flipY = true);
+	void processOutlineGlyphEnd(StoredCharacter& output, FontOutlineDecompositionContext& decomposition, const SDFGenerationArguments& args, bool flipY = true, PendingSdf* deferred = nullptr);
+	/**
+	 * @brief Finalize outline glyph processing on a tight cell around the glyph's ink box.
+	 *
+	 * The outline keeps the face scale; the cell is the grid-fitted ink box plus padding on
+	 * every side. Sets bearing_x/bearing_y to the top-left of the ink box and width/height
+	 * to the size of the SDF in texels.
+	 *
+	 * @param output Output character structure to populate.
+	 * @param decomposition Decomposed outline of the glyph, in face pixels.
+	 * @param args Generation arguments.
+	 * @param deferred If not null, receives the SDF image instead of output.sdf, to be encoded later.
+	 */
+	void processTightOutlineGlyphEnd(StoredCharacter& output, FontOutlineDecompositionContext& decomposition, const SDFGenerationArguments& args, PendingSdf* deferred = nullptr);
+	/**
+	 * @brief Colour a translated outline, then render, downsample and encode its SDF (or load it from the cache).
+	 * @param output Output character structure to populate.
+	 * @param decomposition Decomposed outline, already translated to the canvas.
+	 * @param args Generation arguments.
+	 * @param canvasWidth Width of the canvas in processing pixels.
+	 * @param canvasHeight Height of the canvas in processing pixels.
+	 * @param tightCell Whether to downsample to output.width x output.height texels instead of the square intended size.
+	 * @param deferred If not null, receives the SDF image and cache key instead of encoding and caching it here.
+	 */
+	void renderOutlineGlyph(StoredCharacter& output, FontOutlineDecompositionContext& decomposition, const SDFGenerationArguments& args, uint32_t canvasWidth, uint32_t canvasHeight, bool tightCell, PendingSdf* deferred = nullptr);
 	/**
 	 * @brief Finalize outline glyph processing and generate SDF.
 	 * @param output Output vector image structure to populate.
@@ -46,10 +79,43 @@ private:
 	 * @param flipY Whether to flip Y coordinates (default: true).
 	 */
 	void processOutlineGlyphEnd(StoredVectorImage& output, const SDFGenerationArguments& args, bool flipY = true);
+	/**
+	 * @brief Load a glyph and generate its SDF through the outline or the bitmap path.
+	 * @param output Output character structure to populate.
+	 * @param face Face to load the glyph from.
+	 * @param glyphIndex Index of the glyph within the face.
+	 * @param args Generation arguments.
+	 * @param decomposition Decomposition context to use for outline glyphs.
+	 * @param deferred If not null, receives the SDF image instead of output.sdf, to be encoded later.
+	 */
+	void processGlyph(StoredCharacter& output, FT_Face face, uint32_t glyphIndex, const SDFGenerationArguments& args, FontOutlineDecompositionContext& decomposition, PendingSdf* deferred = nullptr);
+	/**
+	 * @brief Open the font of the arguments and scale it for processing.
+	 * @param library FreeType library to open the face with.
+	 * @param args Generation arguments.
+	 * @return Opened face, to be released with FT_Done_Face().
+	 * @throws std::runtime_error If the font cannot be opened or scaled.
+	 */
+	static FT_Face openFontFace(FT_Library library, const SDFGenerationArguments& args);
+
+	/**
+	 * @brief Outline glyph of the running processFont() waiting for the rest of its batch.
+	 * @struct QueuedOutline
+	 */
+	struct QueuedOutline {
+		size_t index = 0;                              ///< Position of the glyph among the glyphs of processFont()
+		StoredCharacter character;                     ///< Everything but the SDF
+		FontOutlineDecompositionContext decomposition; ///< Coloured outline on the square internalProcessSize canvas
+		QByteArray cacheKey;                           ///< Glyph cache key to store the result under, empty if it is not cached
+		uint64_t generationNanoseconds = 0;            ///< Time spent on the glyph before it was queued
+	};
+	std::vector<QueuedOutline>* outlineQueue = nullptr;  ///< Receives square outline glyphs in processFont() instead of rendering them (null if glyphs render one by one)
+	std::deque<std::vector<QImage>> submittedOutlineSdfs; ///< Results of the default submitOutlineSdfs(), waiting for collectOutlineSdfs()
 	
 protected:
 	FT_Library library;                                    ///< FreeType library instance
 	FontOutlineDecompositionContext decompositionContext;  ///< Context for decomposing font outlines
+	std::unique_ptr<GlyphCache> glyphCache;                ///< Build cache of the running processFont() (null if disabled)
 	
 public:
 	/**
@@ -88,9 +154,66 @@ public:
 	 * @brief Generate SDF from font outline decomposition (pure virtual).
 	 * @param source Font outline decomposition context.
 	 * @param args Generation arguments.
+	 * @param width Width of the canvas the outline was translated to, in pixels.
+	 * @param height Height of the canvas the outline was translated to, in pixels.
 	 * @return Generated SDF image.
 	 */
-	virtual QImage produceOutlineSdf(const FontOutlineDecompositionContext& source, const SDFGenerationArguments& args) = 0;
+	virtual QImage produceOutlineSdf(const FontOutlineDecompositionContext& source, const SDFGenerationArguments& args, uint32_t width, uint32_t height) = 0;
+
+	/**
+	 * @brief Generate the SDFs of several outlines, all translated to the square internalProcessSize canvas.
+	 *
+	 * The default renders them one by one with produceOutlineSdf(). Engines with a high fixed
+	 * cost per call override it to upload, dispatch and read back the whole batch at once.
+	 *
+	 * @param sources Outlines to render.
+	 * @param args Generation arguments.
+	 * @return One SDF image per outline, in the order of sources.
+	 */
+	virtual std::vector<QImage> produceOutlineSdfs(std::span<const FontOutlineDecompositionContext* const> sources, const SDFGenerationArguments& args);
+
+	/**
+	 * @brief Most outline glyphs processFont() collects for one produceOutlineSdfs() call.
+	 *
+	 * Only glyphs rendered on the square canvas are batched, so tight bounds and
+	 * supersampling keep rendering every glyph on its own.
+	 *
+	 * @param args Generation arguments.
+	 * @return 1 by default, which renders every glyph as soon as it is loaded.
+	 */
+	virtual size_t outlineBatchSize(const SDFGenerationArguments& args) const;
+
+	/**
+	 * @brief Start generating the SDFs of at most outlineBatchSize() outlines (see produceOutlineSdfs()).
+	 *
+	 * The results are fetched with collectOutlineSdfs(), oldest batch first. The default
+	 * renders the batch right away; engines that compute asynchronously return once the work
+	 * is queued, so the caller can load the next glyphs and finish earlier ones meanwhile.
+	 * The outlines are only read during the call.
+	 *
+	 * @param sources Outlines to render, translated to the square internalProcessSize canvas.
+	 * @param args Generation arguments.
+	 */
+	virtual void submitOutlineSdfs(std::span<const FontOutlineDecompositionContext* const> sources, const SDFGenerationArguments& args);
+
+	/**
+	 * @brief Wait for the oldest submitted batch and return its SDFs.
+	 * @param args Generation arguments, the same as for submitOutlineSdfs().
+	 * @return One SDF image per outline of the batch, in submission order.
+	 * @throws std::runtime_error If no batch is pending.
+	 */
+	virtual std::vector<QImage> collectOutlineSdfs(const SDFGenerationArguments& args);
+
+	/**
+	 * @brief Drop every submitted batch that was not collected yet (e.g. after a failure).
+	 */
+	virtual void discardOutlineSdfs();
+
+	/**
+	 * @brief Number of batches processFont() leaves submitted while it prepares the next one.
+	 * @return 0 by default, which collects every batch right after submitting it.
+	 */
+	virtual size_t outlineBatchesInFlight() const;
 	
 	/**
 	 * @brief Process a glyph from FreeType outline data.
@@ -100,20 +223,74 @@ public:
 	 */
 	void processOutlineGlyph(StoredCharacter& output, FT_GlyphSlot glyphSlot, const SDFGenerationArguments& args);
 	
+	/**
+	 * @brief Process a glyph from FreeType outline data, using a caller-owned decomposition context.
+	 * @param output Output character structure to populate.
+	 * @param glyphSlot FreeType glyph slot containing outline data.
+	 * @param args Generation arguments.
+	 * @param decomposition Decomposition context to fill (one per worker thread).
+	 * @param deferred If not null, receives the SDF image instead of output.sdf, to be encoded later.
+	 */
+	void processOutlineGlyph(StoredCharacter& output, FT_GlyphSlot glyphSlot, const SDFGenerationArguments& args, FontOutlineDecompositionContext& decomposition, PendingSdf* deferred = nullptr);
+
+	/**
+	 * @brief Render a translated outline directly at its final texel size.
+	 *
+	 * The outline is scaled from the canvas onto a grid of texelWidth x texelHeight texels,
+	 * args.supersample samples per texel side, and the distance range is scaled with it. The
+	 * samples are then halved down to one per texel. This replaces rendering the whole
+	 * canvas and downsampling it, so the work no longer grows with internalProcessSize.
+	 *
+	 * @param decomposition Decomposed outline, translated to the canvas (scaled in place).
+	 * @param args Generation arguments (supersample 0 is treated as 1).
+	 * @param canvasWidth Width of the canvas the outline was translated to, in processing pixels.
+	 * @param canvasHeight Height of the canvas the outline was translated to, in processing pixels.
+	 * @param texelWidth Width of the result in texels.
+	 * @param texelHeight Height of the result in texels.
+	 * @return SDF image of texelWidth x texelHeight.
+	 */
+	QImage produceDirectOutlineSdf(FontOutlineDecompositionContext& decomposition, const SDFGenerationArguments& args, uint32_t canvasWidth, uint32_t canvasHeight, uint32_t texelWidth, uint32_t texelHeight);
+	
+	/**
+	 * @brief Whether produceOutlineSdf() and produceBitmapSdf() may run on several threads at once.
+	 *
+	 * processFont() only hands glyphs to a worker pool when this returns true.
+	 *
+	 * @return False by default.
+	 */
+	virtual bool supportsConcurrentGlyphs() const;
+	
 	/**
 	 * @brief Process a glyph from FreeType bitmap data.
 	 * @param output Output character structure to populate.
 	 * @param glyphSlot FreeType glyph slot containing bitmap data.
 	 * @param args Generation arguments.
+	 * @param deferred If not null, receives the SDF image instead of output.sdf, to be encoded later.
 	 */
-	void processBitmapGlyph(StoredCharacter& output, FT_GlyphSlot glyphSlot, const SDFGenerationArguments& args);
+	void processBitmapGlyph(StoredCharacter& output, FT_GlyphSlot glyphSlot, const SDFGenerationArguments& args, PendingSdf* deferred = nullptr);
 	
 	/**
 	 * @brief Process an entire font file and generate glyphs.
+	 *
+	 * With SDFGenerationArguments::threads other than 1 and an engine that supports
+	 * concurrent glyphs, the glyphs are spread over a pool of OpenMP threads, each with
+	 * its own FreeType library, face and decomposition context. The results are still
+	 * stored in codepoint order, identical to a serial run.
+	 *
+	 * With a writer, each glyph is appended to the pack as soon as it is finished and
+	 * output only receives the metadata and kerning, so memory use no longer grows with
+	 * the size of the font.
+	 *
+	 * When glyphs are processed serially and outlineBatchSize() exceeds 1, outline glyphs
+	 * are collected and rendered in batches through submitOutlineSdfs(); the results are
+	 * the same as rendering them one by one. Up to outlineBatchesInFlight() batches stay
+	 * submitted while the next glyphs are loaded, so asynchronous engines keep computing.
+	 *
 	 * @param output Preprocessed font face to populate.
 	 * @param args Generation arguments.
+	 * @param streamTo Writer to stream the glyphs to instead of storing them in output (optional).
 	 */
-	void processFont(PreprocessedFontFace& output, const SDFGenerationArguments& args);
+	void processFont(PreprocessedFontFace& output, const SDFGenerationArguments& args, FontPackWriter* streamTo = nullptr);
 	
 	/**
 	 * @brief Process an SVG file and generate glyphs.
@@ -1,9 +1,20 @@
 #include "SdfGenerationContextSoft.hpp"
+#include "EdgeSpatialIndex.hpp"
+#include "Profiler.hpp"
+#include "SdfQuantizer.hpp"
 #include <glm/glm.hpp>
 #include <QBitArray>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 SdfGenerationContextSoft::SdfGenerationContextSoft() {}
 
+bool SdfGenerationContextSoft::supportsConcurrentGlyphs() const
+{
+	return true;
+}
+
 template <typename T> struct aligned_arr {
 private:
 	aligned_arr(const aligned_arr& cpy) = delete;
@@ -27,24 +38,147 @@ public:
 	}
 };
 
-struct TmpStoredDist {
-	float f;
-	bool isInside;
+static constexpr int DT_INFINITY = std::numeric_limits<int>::max() / 4;
+
+/// Distance along a line to the closest feature pixel in [x-halfWindow, x+halfWindow), the window of the brute-force search.
+static void distanceToFeatureInLine(const uint8_t* isFeature, size_t stride, int length, int halfWindow, int* out) {
+	int lastFeature = -DT_INFINITY;
+	for(int x = 0; x < length; ++x) {
+		if(isFeature[x * stride]) lastFeature = x;
+		out[x] = (x - lastFeature <= halfWindow) ? (x - lastFeature) : DT_INFINITY;
+	}
+	int nextFeature = DT_INFINITY;
+	for(int x = length - 1; x >= 0; --x) {
+		if(isFeature[x * stride]) nextFeature = x;
+		if(nextFeature - x < halfWindow) out[x] = std::min(out[x], nextFeature - x);
+	}
+}
+
+/// out[y] = min over y' in [y-halfWindow, y+halfWindow) of in[y'] + |y-y'|, using two sliding-window minima.
+static void windowedManhattanPass(const int* in, int length, int halfWindow, int* out, std::vector<int>& queue) {
+	queue.resize(length);
+	// Candidates above (y' <= y): minimize in[y'] - y'
+	size_t head = 0, tail = 0;
+	for(int y = 0; y < length; ++y) {
+		while(tail > head && in[queue[tail-1]] - queue[tail-1] >= in[y] - y) --tail;
+		queue[tail++] = y;
+		while(queue[head] < y - halfWindow) ++head;
+		out[y] = in[queue[head]] - queue[head] + y;
+	}
+	// Candidates below (y' >= y): minimize in[y'] + y'
+	head = 0; tail = 0;
+	for(int y = length - 1; y >= 0; --y) {
+		while(tail > head && in[queue[tail-1]] + queue[tail-1] >= in[y] + y) --tail;
+		queue[tail++] = y;
+		while(head < tail && queue[head] > y + halfWindow - 1) ++head;
+		if(head < tail) out[y] = std::min(out[y], in[queue[head]] + queue[head] - y);
+	}
+}
+
+/// Felzenszwalb & Huttenlocher lower envelope of parabolas: out[q] = min over p of (q-p)^2 + lineDistances[p]^2.
+static void squaredEuclideanPass(const int* lineDistances, int length, double* out, std::vector<int>& v, std::vector<double>& z) {
+	v.resize(length);
+	z.resize(length + 1);
+	auto f = [lineDistances](int q) { return static_cast<double>(lineDistances[q]) * static_cast<double>(lineDistances[q]); };
+	int k = -1;
+	for(int q = 0; q < length; ++q) {
+		if(lineDistances[q] >= DT_INFINITY) continue;
+		if(k < 0) {
+			k = 0;
+			v[0] = q;
+			z[0] = -std::numeric_limits<double>::infinity();
+			z[1] = std::numeric_limits<double>::infinity();
+			continue;
+		}
+		double s = ((f(q) + static_cast<double>(q) * q) - (f(v[k]) + static_cast<double>(v[k]) * v[k])) / (2.0 * q - 2.0 * v[k]);
+		while(s <= z[k]) {
+			--k;
+			s = ((f(q) + static_cast<double>(q) * q) - (f(v[k]) + static_cast<double>(v[k]) * v[k])) / (2.0 * q - 2.0 * v[k]);
+		}
+		++k;
+		v[k] = q;
+		z[k] = s;
+		z[k+1] = std::numeric_limits<double>::infinity();
+	}
+	if(k < 0) {
+		std::fill(out, out + length, std::numeric_limits<double>::infinity());
+		return;
+	}
+	k = 0;
+	for(int q = 0; q < length; ++q) {
+		while(z[k+1] < q) ++k;
+		const double d = static_cast<double>(q - v[k]);
+		out[q] = d * d + f(v[k]);
+	}
+}
+
+/// A set of parallel lines (all rows or all columns) of a row-major image.
+struct ImageLines {
+	int count;       ///< Number of lines
+	int length;      ///< Pixels per line
+	size_t step;     ///< Offset between the first pixels of consecutive lines
+	size_t stride;   ///< Offset between consecutive pixels of a line
 };
 
-QImage SdfGenerationContextSoft::produceBitmapSdf(const QImage& source, const SDFGenerationArguments& args)
+/**
+ * Exact distance from every pixel to the closest feature pixel, restricted like the windowed search.
+ * The first pass only sees features within the window along its lines; the Manhattan second pass is windowed too.
+ * The Euclidean second pass is not, so it runs along the wider half-window: anything it finds outside the window
+ * is at least that far away, which is already beyond sqrt(halfX * halfY), the cap applied afterwards.
+ * Runs in O(width*height) regardless of the window size.
+ */
+static void distanceToFeatures(const std::vector<uint8_t>& isFeature, int width, int height, int halfX, int halfY, DistanceType distType, std::vector<float>& out)
 {
-	const auto width = args.internalProcessSize;
-	const auto height = args.internalProcessSize;
-	QImage sdf(width,height,QImage::Format_Grayscale8);
-	QBitArray bitArr(width*height,false);
-	for(unsigned y = 0; y < height; ++y) {
-		const uint8_t* iRowStart = static_cast<const uint8_t*>( source.scanLine(y) );
-		const size_t oRowStart = y*width;
-		for(unsigned x = 0; x < width; ++x) {
-			bitArr.setBit(oRowStart+x,iRowStart[x] >= 127 );
+	out.resize(static_cast<size_t>(width) * height);
+	if(!halfX || !halfY) {
+		std::fill(out.begin(), out.end(), std::numeric_limits<float>::max());
+		return;
+	}
+	const ImageLines rows = { height, width, static_cast<size_t>(width), 1 };
+	const ImageLines columns = { width, height, 1, static_cast<size_t>(width) };
+	const bool rowsFirst = (distType == DistanceType::Manhattan) || (halfX < halfY);
+	const ImageLines& first = rowsFirst ? rows : columns;
+	const ImageLines& second = rowsFirst ? columns : rows;
+	const int firstHalfWindow = rowsFirst ? halfX : halfY;
+	const int secondHalfWindow = rowsFirst ? halfY : halfX;
+
+	std::vector<int> lineDistances(static_cast<size_t>(width) * height);
+#pragma omp parallel for
+	for(int i = 0; i < first.count; ++i) {
+		std::vector<int> result(first.length);
+		distanceToFeatureInLine(&isFeature[i * first.step], first.stride, first.length, firstHalfWindow, result.data());
+		for(int j = 0; j < first.length; ++j) lineDistances[i * first.step + j * first.stride] = result[j];
+	}
+#pragma omp parallel for
+	for(int i = 0; i < second.count; ++i) {
+		std::vector<int> line(second.length);
+		for(int j = 0; j < second.length; ++j) line[j] = lineDistances[i * second.step + j * second.stride];
+		if(distType == DistanceType::Manhattan) {
+			std::vector<int> queue;
+			std::vector<int> result(second.length);
+			windowedManhattanPass(line.data(), second.length, secondHalfWindow, result.data(), queue);
+			for(int j = 0; j < second.length; ++j) {
+				out[i * second.step + j * second.stride] = result[j] >= DT_INFINITY ? std::numeric_limits<float>::max() : static_cast<float>(result[j]);
+			}
+		} else {
+			std::vector<int> v;
+			std::vector<double> z;
+			std::vector<double> result(second.length);
+			squaredEuclideanPass(line.data(), second.length, result.data(), v, z);
+			for(int j = 0; j < second.length; ++j) {
+				out[i * second.step + j * second.stride] = std::isinf(result[j]) ? std::numeric_limits<float>::max() : std::sqrt(static_cast<float>(result[j]));
+			}
 		}
 	}
+}
+
+QImage SdfGenerationContextSoft::produceBitmapSdf(const QImage& source, const SDFGenerationArguments& args)
+{
+	Profiler::Scope profileScope("distance evaluation");
+	Profiler::count(Profiler::PIXELS_EVALUATED, static_cast<uint64_t>(source.width()) * source.height());
+	const unsigned width = static_cast<unsigned>(source.width());
+	const unsigned height = static_cast<unsigned>(source.height());
+	QImage sdf(width,height,QImage::Format_Grayscale8);
 
 	//std::vector<float> tmpFloat(with * height);
 	//double maxDist = sqrt(static_cast<double>(source.width()) * static_cast<double>(source.height()));
@@ -55,80 +189,237 @@ QImage SdfGenerationContextSoft::produceBitmapSdf(const QImage& source, const SD
 							  ? (std::sqrt(static_cast<float>(half_samples_to_check_x) * static_cast<float>(half_samples_to_check_y)))
 							  : static_cast<float>(half_samples_to_check_x+half_samples_to_check_y);
 
-	const auto distanceCalculator = (args.distType == DistanceType::Euclidean)
-										?
-										( [](const glm::ivec2& a, const glm::ivec2& b) {
-											return glm::distance(glm::fvec2(a),glm::fvec2(b));
-										} )
-										:
-										( [](const glm::ivec2& a, const glm::ivec2& b) {
-											return static_cast<float>(std::abs(a.x - b.x) + std::abs(a.y - b.y));
-										} );
-
-	std::vector<TmpStoredDist> storedDists(width * height);
-
-	auto calculateSdfForPixel = [&bitArr,&distanceCalculator,maxDist,half_samples_to_check_x,half_samples_to_check_y,width,height](unsigned x, unsigned y, bool isInside) {
-		const unsigned min_offset_x = static_cast<unsigned>(std::max( static_cast<int>(x)-static_cast<int>(half_samples_to_check_x), 0 ));
-		const unsigned max_offset_x = static_cast<unsigned>(std::min( static_cast<int>(x)+static_cast<int>(half_samples_to_check_x), static_cast<int>(width) ));
-		const unsigned min_offset_y = static_cast<unsigned>(std::max( static_cast<int>(y)-static_cast<int>(half_samples_to_check_y), 0 ));
-		const unsigned max_offset_y = static_cast<unsigned>(std::min( static_cast<int>(y)+static_cast<int>(half_samples_to_check_y), static_cast<int>(height) ));
-		float minDistance = maxDist;
-		for(unsigned offset_y = min_offset_y; offset_y < max_offset_y; ++offset_y ) {
-			const unsigned row_start = offset_y * width;
-			for(unsigned offset_x = min_offset_x; offset_x < max_offset_x; ++offset_x ) {
-				bool isEdge = bitArr.testBit(row_start+offset_x) != isInside;
-				if(isEdge) {
-					float dist = distanceCalculator(glm::ivec2(x,y),glm::ivec2(offset_x,offset_y));
-					if(dist <= minDistance) minDistance = dist;
-				}
+	// Signed distances, positive inside
+	std::vector<float> storedDists(width * height);
+
+	if(args.distanceTransform) {
+		// One transform towards the outside pixels (read by inside pixels), one towards the inside pixels
+		std::vector<uint8_t> isInside(width * height);
+		std::vector<uint8_t> isOutside(width * height);
+		for(unsigned y = 0; y < height; ++y) {
+			const uint8_t* iRowStart = static_cast<const uint8_t*>( source.scanLine(y) );
+			for(unsigned x = 0; x < width; ++x) {
+				isInside[y * width + x] = iRowStart[x] >= 127;
+				isOutside[y * width + x] = !isInside[y * width + x];
 			}
 		}
-		return minDistance;
-	};
+		std::vector<float> distToOutside;
+		std::vector<float> distToInside;
+		distanceToFeatures(isOutside, width, height, half_samples_to_check_x, half_samples_to_check_y, args.distType, distToOutside);
+		distanceToFeatures(isInside, width, height, half_samples_to_check_x, half_samples_to_check_y, args.distType, distToInside);
+		for(size_t i = 0; i < storedDists.size(); ++i) {
+			storedDists[i] = isInside[i] ? std::min(maxDist, distToOutside[i]) : -std::min(maxDist, distToInside[i]);
+		}
+	} else {
+		QBitArray bitArr(width*height,false);
+		for(unsigned y = 0; y < height; ++y) {
+			const uint8_t* iRowStart = static_cast<const uint8_t*>( source.scanLine(y) );
+			const size_t oRowStart = y*width;
+			for(unsigned x = 0; x < width; ++x) {
+				bitArr.setBit(oRowStart+x,iRowStart[x] >= 127 );
+			}
+		}
+
+		const auto distanceCalculator = (args.distType == DistanceType::Euclidean)
+											?
+											( [](const glm::ivec2& a, const glm::ivec2& b) {
+												return glm::distance(glm::fvec2(a),glm::fvec2(b));
+											} )
+											:
+											( [](const glm::ivec2& a, const glm::ivec2& b) {
+												return static_cast<float>(std::abs(a.x - b.x) + std::abs(a.y - b.y));
+											} );
+
+		auto calculateSdfForPixel = [&bitArr,&distanceCalculator,maxDist,half_samples_to_check_x,half_samples_to_check_y,width,height](unsigned x, unsigned y, bool isInside) {
+			const unsigned min_offset_x = static_cast<unsigned>(std::max( static_cast<int>(x)-static_cast<int>(half_samples_to_check_x), 0 ));
+			const unsigned max_offset_x = static_cast<unsigned>(std::min( static_cast<int>(x)+static_cast<int>(half_samples_to_check_x), static_cast<int>(width) ));
+			const unsigned min_offset_y = static_cast<unsigned>(std::max( static_cast<int>(y)-static_cast<int>(half_samples_to_check_y), 0 ));
+			const unsigned max_offset_y = static_cast<unsigned>(std::min( static_cast<int>(y)+static_cast<int>(half_samples_to_check_y), static_cast<int>(height) ));
+			float minDistance = maxDist;
+			for(unsigned offset_y = min_offset_y; offset_y < max_offset_y; ++offset_y ) {
+				const unsigned row_start = offset_y * width;
+				for(unsigned offset_x = min_offset_x; offset_x < max_offset_x; ++offset_x ) {
+					bool isEdge = bitArr.testBit(row_start+offset_x) != isInside;
+					if(isEdge) {
+						float dist = distanceCalculator(glm::ivec2(x,y),glm::ivec2(offset_x,offset_y));
+						if(dist <= minDistance) minDistance = dist;
+					}
+				}
+			}
+			return minDistance;
+		};
 #pragma omp parallel for collapse(2)
-	for(int y = 0; y < height;++y) {
-		for(int x = 0; x < width; ++x) {
-			TmpStoredDist* out_row_start = &storedDists[y * width];
-			const unsigned in_row_start = y * width;
-			const bool isInside = bitArr.testBit(in_row_start+x);
-			out_row_start[x].isInside = isInside;
-			out_row_start[x].f = calculateSdfForPixel(x,y,isInside);
+		for(int y = 0; y < height;++y) {
+			for(int x = 0; x < width; ++x) {
+				float* out_row_start = &storedDists[y * width];
+				const unsigned in_row_start = y * width;
+				const bool isInside = bitArr.testBit(in_row_start+x);
+				const float dist = calculateSdfForPixel(x,y,isInside);
+				out_row_start[x] = isInside ? dist : -dist;
+			}
 		}
 	}
 
-	float maxDistIn = std::numeric_limits<float>::epsilon();
-	float maxDistOut = std::numeric_limits<float>::epsilon();
-	for(const auto& it : storedDists) {
-		if(it.isInside) {
-			maxDistIn = std::max(maxDistIn,it.f);
-		} else {
-			maxDistOut = std::max(maxDistOut,it.f);
+	SdfQuantizer::quantize(sdf, storedDists.data(), args);
+	return sdf;
+}
+
+/// Crossing of an edge with a horizontal scanline, used for the non-zero winding rule.
+struct ScanlineCrossing {
+	float x;
+	int dy;
+};
+
+static void collectScanlineCrossings(const std::vector<EdgeSegment>& edges, std::span<const uint32_t> band, double y, std::vector<ScanlineCrossing>& crossings) {
+	crossings.clear();
+	double x[3];
+	int dy[3];
+	for(const uint32_t i : band) {
+		const int count = edges[i].scanlineIntersections(x, dy, y);
+		for(int i = 0; i < count; ++i) {
+			crossings.push_back({ static_cast<float>(x[i]), dy[i] });
 		}
 	}
-	// Add a small epsilon to avoid division by zero
-	for(auto& it : storedDists) {
-		if(it.isInside) {
-			it.f /= maxDistIn;
-			it.f = 0.5f + (it.f * 0.5f);
-		} else {
-			it.f /= maxDistOut;
-			it.f = 0.5f - (it.f * 0.5f);
+	std::sort(crossings.begin(), crossings.end(), [](const ScanlineCrossing& a, const ScanlineCrossing& b) { return a.x < b.x; });
+}
+
+static inline bool edgeHasChannel(const EdgeSegment& edge, int channel) {
+	return ((edge.clr >> (16 - (channel * 8))) & 0xFF) != 0;
+}
+
+QImage SdfGenerationContextSoft::produceOutlineSdf(const FontOutlineDecompositionContext& source, const SDFGenerationArguments& args, uint32_t canvasWidth, uint32_t canvasHeight)
+{
+	Profiler::Scope profileScope("distance evaluation");
+	Profiler::count(Profiler::PIXELS_EVALUATED, static_cast<uint64_t>(canvasWidth) * canvasHeight);
+	const int width = static_cast<int>(canvasWidth);
+	const int height = static_cast<int>(canvasHeight);
+	const float searchWidth = static_cast<float>(args.samples_to_check_x ? args.samples_to_check_x / 2 : args.padding);
+	const float searchHeight = static_cast<float>(args.samples_to_check_y ? args.samples_to_check_y / 2 : args.padding);
+	// Same cap as the compute shaders: distances beyond this are clamped
+	const float maxDistance = (args.distType == DistanceType::Euclidean)
+								  ? std::sqrt(searchWidth * searchWidth + searchHeight * searchHeight)
+								  : (searchWidth + searchHeight);
+	const bool isManhattan = args.distType == DistanceType::Manhattan;
+	auto distanceMetric = [isManhattan](const glm::fvec2& offset) {
+		return isManhattan ? (std::abs(offset.x) + std::abs(offset.y)) : glm::length(offset);
+	};
+
+	const std::vector<EdgeSegment>& edges = source.edges;
+	const EdgeSpatialIndex index(edges, width, height, maxDistance, args.distType);
+
+	if(args.type == SDFType::SDF) {
+		std::vector<float> storedDists(static_cast<size_t>(width) * static_cast<size_t>(height));
+#pragma omp parallel for schedule(dynamic)
+		for(int y = 0; y < height; ++y) {
+			std::vector<ScanlineCrossing> crossings;
+			const float posY = static_cast<float>(y) + 0.5f;
+			collectScanlineCrossings(edges, index.getBandEdges(posY), posY, crossings);
+			int windingToTheRight = 0;
+			for(const auto& it : crossings) windingToTheRight += it.dy;
+			size_t crossingIndex = 0;
+			float* outRow = &storedDists[static_cast<size_t>(y) * width];
+			for(int x = 0; x < width; ++x) {
+				const glm::fvec2 pos(static_cast<float>(x) + 0.5f, posY);
+				while(crossingIndex < crossings.size() && crossings[crossingIndex].x <= pos.x) {
+					windingToTheRight -= crossings[crossingIndex].dy;
+					++crossingIndex;
+				}
+				float minDistance = maxDistance;
+				const EdgeBounds cell = index.getCellBounds(pos);
+				for(const uint32_t i : index.getCellEdges(pos)) {
+					const EdgeBounds& box = index.getBounds(i);
+					// Nearest boxes come first: once one is out of reach from the whole cell, so are the rest
+					if(box.gap(cell, args.distType) > minDistance) break;
+					if(box.gap(pos, args.distType) > minDistance) continue;
+					float param;
+					const glm::fvec2 closest = edges[i].closestPoint(pos, param);
+					minDistance = std::min(minDistance, distanceMetric(pos - closest));
+				}
+				outRow[x] = windingToTheRight != 0 ? minDistance : -minDistance;
+			}
 		}
+
+		QImage sdf(width, height, QImage::Format_Grayscale8);
+		SdfQuantizer::quantize(sdf, storedDists.data(), args);
+		return sdf;
 	}
 
-	for(int y = 0; y < height;++y) {
-		uchar* row = sdf.scanLine(y);
-		const TmpStoredDist* in_row_start = &storedDists[y * width];
+	// MSDF / MSDFA: RGB hold per-channel pseudo-distances, A holds the true signed distance
+	std::vector<glm::fvec4> rawDistances(static_cast<size_t>(width) * static_cast<size_t>(height));
+#pragma omp parallel for schedule(dynamic)
+	for(int y = 0; y < height; ++y) {
+		std::vector<ScanlineCrossing> crossings;
+		const float posY = static_cast<float>(y) + 0.5f;
+		collectScanlineCrossings(edges, index.getBandEdges(posY), posY, crossings);
+		int windingToTheRight = 0;
+		for(const auto& it : crossings) windingToTheRight += it.dy;
+		size_t crossingIndex = 0;
+		glm::fvec4* outRow = &rawDistances[static_cast<size_t>(y) * width];
 		for(int x = 0; x < width; ++x) {
-			const TmpStoredDist& in = in_row_start[x];
-			//float sdfValue = (in.isInside ? 0.5f + (in.f / 2.0f) : 0.5f - (in.f / 2.0f));
-			row[x] = static_cast<uint8_t>(in.f * 255.0f);
+			const glm::fvec2 pos(static_cast<float>(x) + 0.5f, posY);
+			while(crossingIndex < crossings.size() && crossings[crossingIndex].x <= pos.x) {
+				windingToTheRight -= crossings[crossingIndex].dy;
+				++crossingIndex;
+			}
+			// Closest edge per channel (RGB) and overall (A); later edges win ties, like in the shader,
+			// regardless of the order in which the candidates are visited
+			glm::fvec4 minDist(std::numeric_limits<float>::max());
+			int closestEdges[4] = { -1, -1, -1, -1 };
+			float closestParams[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			glm::fvec2 closestPoints[4];
+			auto considerEdge = [&](uint32_t i) {
+				float param;
+				const glm::fvec2 closest = edges[i].closestPoint(pos, param);
+				const float dist = distanceMetric(pos - closest);
+				for(int c = 0; c < 4; ++c) {
+					if((c == 3 || edgeHasChannel(edges[i], c)) &&
+							(dist < minDist[c] || (dist == minDist[c] && static_cast<int>(i) > closestEdges[c]))) {
+						minDist[c] = dist;
+						closestEdges[c] = static_cast<int>(i);
+						closestParams[c] = param;
+						closestPoints[c] = closest;
+					}
+				}
+			};
+			const EdgeBounds cell = index.getCellBounds(pos);
+			for(const uint32_t i : index.getCellEdges(pos)) {
+				const EdgeBounds& box = index.getBounds(i);
+				if(box.gap(cell, args.distType) > std::max({ minDist.x, minDist.y, minDist.z })) break;
+				// The edge can only matter to the channels it carries (and to A, whose best is never worse)
+				float reach = minDist.w;
+				for(int c = 0; c < 3; ++c) {
+					if(edgeHasChannel(edges[i], c)) reach = std::max(reach, minDist[c]);
+				}
+				if(box.gap(pos, args.distType) > reach) continue;
+				considerEdge(i);
+			}
+			const bool isInside = windingToTheRight != 0;
+			const float insideSign = isInside ? 1.0f : -1.0f;
+			glm::fvec4 out;
+			for(int c = 0; c < 3; ++c) {
+				// Only edges near the pixel's cell were visited: a channel with none of its edges within
+				// the cap saturates, on the side the winding says
+				if(closestEdges[c] < 0 || minDist[c] > maxDistance) {
+					out[c] = maxDistance * insideSign;
+					continue;
+				}
+				const glm::fvec2 tangent = edges[closestEdges[c]].direction(closestParams[c]);
+				const glm::fvec2 offset = pos - closestPoints[c];
+				const float side = tangent.x * offset.y - tangent.y * offset.x;
+				out[c] = std::clamp(side >= 0.0f ? minDist[c] : -minDist[c], -maxDistance, maxDistance);
+			}
+			out.w = std::min(minDist.w, maxDistance) * insideSign;
+			// Channels carried by the overall closest edge must agree with the winding, or holes appear
+			if(closestEdges[3] >= 0) {
+				for(int c = 0; c < 3; ++c) {
+					if(edgeHasChannel(edges[closestEdges[3]], c)) out[c] = std::abs(out[c]) * insideSign;
+				}
+			}
+			outRow[x] = out;
 		}
 	}
-	return sdf;
-}
-
-QImage SdfGenerationContextSoft::produceOutlineSdf(const FontOutlineDecompositionContext& source, const SDFGenerationArguments& args)
-{
 
+	QImage sdf(width, height, QImage::Format_RGBA8888);
+	SdfQuantizer::quantize(sdf, rawDistances.data(), args);
+	return sdf;
 }
@@ -16,6 +16,9 @@
  * 
  * Implements SDF generation using CPU algorithms. Uses distance field
  * calculations with configurable distance metrics (Manhattan or Euclidean).
+ * Outline distances are evaluated analytically against the edge segments,
+ * one scanline per OpenMP task, mirroring the OpenGL compute shaders. Each
+ * pixel only visits the candidate edges of its EdgeSpatialIndex cell.
  */
 class SdfGenerationContextSoft : public SdfGenerationContext
 {
@@ -25,6 +28,12 @@ public:
 	 */
 	SdfGenerationContextSoft();
 	
+	/**
+	 * @brief The CPU engine keeps no per-glyph state, so glyphs may be processed concurrently.
+	 * @return Always true.
+	 */
+	bool supportsConcurrentGlyphs() const override;
+	
 	/**
 	 * @brief Generate SDF from a bitmap image using CPU algorithms.
 	 * @param source Source bitmap image.
@@ -37,9 +46,11 @@ public:
 	 * @brief Generate SDF from font outline decomposition using CPU algorithms.
 	 * @param source Font outline decomposition context.
 	 * @param args Generation arguments.
+	 * @param width Width of the canvas the outline was translated to, in pixels.
+	 * @param height Height of the canvas the outline was translated to, in pixels.
 	 * @return Generated SDF image.
 	 */
-	QImage produceOutlineSdf(const FontOutlineDecompositionContext& source, const SDFGenerationArguments& args) override;
+	QImage produceOutlineSdf(const FontOutlineDecompositionContext& source, const SDFGenerationArguments& args, uint32_t width, uint32_t height) override;
 };
 
 #endif // SDFGENERATIONCONTEXTSOFT_HPP
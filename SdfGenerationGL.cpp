@@ -5,7 +5,25 @@
 #include <QTextStream>
 #include <cassert>
 #include <glm/glm.hpp>
-#include "RGBA8888.hpp"
+#include "EdgeSpatialIndex.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+/// Most outlines rendered by one dispatch; past this, the dispatch overhead is already negligible.
+#define OUTLINE_BATCH_GLYPHS 256
+/// Texels of the strip textures of a batch (64 MiB of RGBA32F distances), so large canvases get smaller batches.
+#define OUTLINE_BATCH_TEXELS (1 << 22)
+/// Outline batches with their own GPU resources: one computes while the previous one is read back.
+#define OUTLINE_SLOTS 2
+/// Longest single wait on a fence; the wait is repeated until the fence is signalled.
+#define FENCE_WAIT_NANOSECONDS 100000000
+/// Binding of the cell range buffer shared by sdf_reduce.glsl and sdf_pack.glsl.
+#define CELL_RANGES_BINDING 7
+/// Side of the square work groups of the distance and packing shaders.
+#define COMPUTE_GROUP_SIZE 8
 
 struct Rgb32f {
 	float r, g, b, a;
@@ -35,150 +53,76 @@ GlTextureFormat SdfGenerationGL::getTemporaryTextureFormat(const SDFGenerationAr
 	}
 }
 
-float gammaAdjust(float x) {
-	float d = x - 0.5f;
-	return 0.5f + 2.0f * d * d * d + 0.5f * d;
+/// Insert code right after the #version directive, which must stay the first statement of the shader.
+static void injectAfterVersion(QByteArray& shdrArr, const QByteArray& code) {
+	const qsizetype versionAt = shdrArr.indexOf("#version");
+	shdrArr.insert(shdrArr.indexOf('\n', versionAt)+1, code);
 }
 
-void SdfGenerationGL::fetchSdfFromGPU(QImage& newimg, const SDFGenerationArguments& args)
+/// Texture format of the jump flood seeds: two pixel positions per texel.
+static const GlTextureFormat JUMP_FLOOD_FORMAT = { GL_RGBA16I, GL_RGBA_INTEGER, GL_SHORT };
+
+/// Compile a compute shader, with defines inserted after its #version directive.
+static std::unique_ptr<QOpenGLShaderProgram> makeComputeShader(const char* path, const QByteArray& defines)
 {
-	std::vector<uint8_t> areTheyInside = newTex2.getTextureAs<uint8_t>();
-	std::vector<float> rawDistances = newTex.getTextureAs<float>();
-	float maxDistIn = std::numeric_limits<float>::epsilon();
-	float maxDistOut = std::numeric_limits<float>::epsilon();
-	for(size_t i = 0; i < rawDistances.size(); ++i) {
-		if(areTheyInside[i]) {
-			maxDistIn = std::max(maxDistIn, std::abs(rawDistances[i]) );
-		} else {
-			maxDistOut = std::max(maxDistOut, std::abs(rawDistances[i]) );
-		}
-	}
-	for(size_t i = 0; i < rawDistances.size(); ++i) {
-		float& it = rawDistances[i];
-		if(areTheyInside[i]) {
-			it /= maxDistIn;
-			it = 0.5f + (it * 0.5f);
-		} else {
-			it /= maxDistOut;
-			it = 0.5f - (it * 0.5f);
-		}
-		if(args.invert) it = 1.0f - it;
-	}
-	if(args.midpointAdjustment.has_value()) {
-		float toDivideWith = args.midpointAdjustment.value_or(1.0f);
-		for(size_t i = 0; i < rawDistances.size(); ++i) {
-			float& it = rawDistances[i];
-			it = std::clamp(it/toDivideWith,0.0f,1.0f);
-		}
-	}
-	if(args.gammaCorrect) {
-		for(size_t i = 0; i < rawDistances.size(); ++i) {
-			float& it = rawDistances[i];
-			it = gammaAdjust(it);
-		}
+	QTextStream errStrm(stderr);
+	auto shader = std::make_unique<QOpenGLShaderProgram>();
+	QFile res(path);
+	if(!res.open(QFile::ReadOnly)) throw std::runtime_error("Failed to open shader!");
+	QByteArray shdrArr = res.readAll();
+	injectAfterVersion(shdrArr, defines);
+	if(!shader->addCacheableShaderFromSourceCode(QOpenGLShader::Compute,shdrArr)) {
+		errStrm << shader->log() << '\n';
+		errStrm.flush();
+		throw std::runtime_error("Failed to add shader!");
 	}
-
-	for(int y = 0; y < newimg.height(); ++y) {
-		uchar* scanline = newimg.scanLine(y);
-		const float* rawScanline = &rawDistances[newimg.width()*y];
-		for(int x = 0; x < newimg.width(); ++x) {
-			scanline[x] = static_cast<uint8_t>(rawScanline[x] * 255.f);
-		}
+	if(!shader->link()) {
+		errStrm << shader->log() << '\n';
+		errStrm.flush();
+		throw std::runtime_error("Failed to compile OpenGL shader!");
 	}
+	return shader;
 }
 
-/*
-	bool gammaCorrect;
-	bool maximizeInsteadOfAverage;
-	std::optional<float> midpointAdjustment;
-*/
-
-void SdfGenerationGL::fetchMSDFFromGPU(QImage& newimg, const SDFGenerationArguments& args)
+/// Work groups along a side of a square canvas, one per tile of COMPUTE_GROUP_SIZE pixels.
+static GLuint groupsFor(GLsizei size)
 {
-	/*glHelpers.glFuncs->glUseProgram(msdfFixerShader->programId());
-	newTex.bindAsImage(glHelpers.extraFuncs, 0, GL_READ_ONLY);
-	glHelpers.glFuncs->glUniform1i(fixer_tex_uniform1,0);
-	newTex3.bindAsImage(glHelpers.extraFuncs, 1, GL_WRITE_ONLY);
-	glHelpers.glFuncs->glUniform1i(fixer_tex_uniform2,1);
-	glHelpers.extraFuncs->glDispatchCompute(args.internalProcessSize,args.internalProcessSize,1);
-	glHelpers.extraFuncs->glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);*/
-	std::vector<RGBA8888> areTheyInside = newTex2.getTextureAs<RGBA8888>();
-	// We need HugePreallocator!
-	//std::vector<glm::fvec4> rawDistances = newTex3.getTextureAs<glm::fvec4>();
-	std::vector<glm::fvec4> rawDistances = newTex.getTextureAs<glm::fvec4>();
-	//std::vector<Rgba8,HugePreallocator<Rgba8>> rawDistances = newTex.getTextureAs<Rgba8,HugePreallocator<Rgba8>>();
-	//std::vector<Rgba8> rawDistances = newTex.getTextureAs<Rgba8>();
-	glm::fvec3 maxDistIn(std::numeric_limits<float>::lowest());
-	glm::fvec3 maxDistOut(std::numeric_limits<float>::lowest());
+	return (static_cast<GLuint>(size) + COMPUTE_GROUP_SIZE - 1) / COMPUTE_GROUP_SIZE;
+}
 
-	glm::fvec4 minDist(std::numeric_limits<float>::max());
-	glm::fvec4 maxDist(std::numeric_limits<float>::lowest());
+void SdfGenerationGL::quantizeOnGPU(const GlTexture& distances, const GlTexture& inside, const GlTexture& packed, GlStorageBuffer& ranges, GLsizei count, const SDFGenerationArguments& args)
+{
+	const GLsizei size = distances.getWidth();
+	const GLsizeiptr rangeBytes = static_cast<GLsizeiptr>(count) * sizeof(CellRangeForCompute);
+	if(ranges.getSize() < static_cast<size_t>(rangeBytes)) ranges.initialize(rangeBytes);
+	// The distances were written as images, and are read as images
+	glHelpers.extraFuncs->glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	glHelpers.glFuncs->glUseProgram(reduceShader->programId());
+	distances.bindAsImage(glHelpers.extraFuncs, 0, GL_READ_ONLY);
+	if(args.type == SDFType::SDF) inside.bindAsImage(glHelpers.extraFuncs, 1, GL_READ_ONLY);
+	ranges.bindBase(CELL_RANGES_BINDING);
+	// One work group per cell
+	glHelpers.extraFuncs->glDispatchCompute(1,1,count);
+	glHelpers.extraFuncs->glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 
-	/*const float distCap = std::sqrt(static_cast<float>(args.samples_to_check_x) * static_cast<float>(args.samples_to_check_y));
+	glHelpers.glFuncs->glUseProgram(packShader->programId());
+	glHelpers.glFuncs->glUniform1i(invertUniform_pack, args.invert);
+	glHelpers.glFuncs->glUniform1i(gammaCorrectUniform_pack, args.gammaCorrect);
+	glHelpers.glFuncs->glUniform1f(midpointScaleUniform_pack, args.midpointAdjustment.has_value() ? 1.0f / args.midpointAdjustment.value() : 1.0f);
+	packed.bindAsImage(glHelpers.extraFuncs, 2, GL_WRITE_ONLY);
+	glHelpers.extraFuncs->glDispatchCompute(groupsFor(size),groupsFor(size),count);
+	// Image stores must land before the packed texture is read back
+	glHelpers.extraFuncs->glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT);
+}
 
-	for(size_t i = 0; i < rawDistances.size(); ++i) {
-		glm::fvec4& it = rawDistances[i];
-		for(int z = 0; z < 4; ++z) {
-			float& t = it[z];
-			t = std::clamp(t, -distCap, distCap );
-		}
-	}*/
-	for(size_t i = 0; i < rawDistances.size(); ++i) {
-		for(int z = 0; z < 4; ++z) {
-			maxDist[z] = std::max(maxDist[z], rawDistances[i][z]);
-			minDist[z] = std::min(minDist[z], rawDistances[i][z]);
-		}
-	}
-	for(size_t i = 0; i < rawDistances.size(); ++i) {
-		glm::fvec4& it = rawDistances[i];
-		for(int z = 0; z < 4; ++z) {
-			float& t = it[z];
-			const float& max = maxDist[z];
-			const float& min = minDist[z];
-			// Normalize from [min, max] to [-1, 1] while keeping 0 as 0
-			if(t >= 0.0f) {
-				t /= max;
-			} else {
-				t /= min;
-				t *= -1.0f;
-			}
-			// Normalize from from [-1, 1] to [0, 1] while [0] becomes [0.5]
-			t *= 0.5f;
-			t += 0.5f;
-			if(args.invert) t = 1.0f - t;
-		}
-	}
-	if(args.midpointAdjustment.has_value()) {
-		float toDivideWith = args.midpointAdjustment.value_or(1.0f);
-		for(size_t i = 0; i < rawDistances.size(); ++i) {
-			glm::fvec4& it = rawDistances[i];
-			it.x = std::clamp(it.x/toDivideWith,0.0f,1.0f);
-			it.y = std::clamp(it.y/toDivideWith,0.0f,1.0f);
-			it.z = std::clamp(it.z/toDivideWith,0.0f,1.0f);
-			it.w = std::clamp(it.w/toDivideWith,0.0f,1.0f);
-		}
-	}
-	if(args.gammaCorrect) {
-		for(size_t i = 0; i < rawDistances.size(); ++i) {
-			glm::fvec4& it = rawDistances[i];
-			it.x = gammaAdjust(it.x);
-			it.y = gammaAdjust(it.y);
-			it.z = gammaAdjust(it.z);
-			it.w = gammaAdjust(it.w);
-		}
-	}
-	if( args.type != SDFType::MSDFA ) {
-		for(size_t i = 0; i < rawDistances.size(); ++i) {
-			rawDistances[i].a = 1.0f;
-		}
-	}
-	for(int y = 0; y < newimg.height(); ++y) {
-		RGBA8888* scanline = reinterpret_cast<RGBA8888*>(newimg.scanLine(y));
-		const glm::fvec4* rawScanline = &rawDistances[newimg.width()*y];
-		for(int x = 0; x < newimg.width(); ++x) {
-			const glm::fvec4& rawPixel = rawScanline[x];
-			RGBA8888& outputPixel = scanline[x];
-			outputPixel.fromFvec4(rawPixel);
+void SdfGenerationGL::unpackCells(std::span<QImage> images, const uint8_t* texels)
+{
+	for(QImage& image : images) {
+		// Read back without row padding, unlike the scanlines of the image
+		const size_t rowBytes = static_cast<size_t>(image.width()) * (image.depth() / 8);
+		for(int y = 0; y < image.height(); ++y) {
+			std::memcpy(image.scanLine(y), texels, rowBytes);
+			texels += rowBytes;
 		}
 	}
 }
@@ -188,8 +132,10 @@ SdfGenerationGL::SdfGenerationGL(const SDFGenerationArguments& args) :
 	oldTex(args.internalProcessSize,args.internalProcessSize, QImage::Format_Grayscale8),
 	newTex(args.internalProcessSize, args.internalProcessSize, temporaryTextureFormat),
 	newTex2(args.internalProcessSize, args.internalProcessSize, args.type == SDFType::SDF ? QImage::Format_Grayscale8 : QImage::Format_RGBA8888 ),
-	newTex3(args.internalProcessSize, args.internalProcessSize, temporaryTextureFormat),
-	uniformBuffer(glHelpers.glFuncs, glHelpers.extraFuncs), ssboForEdges(glHelpers.glFuncs, glHelpers.extraFuncs, true)
+	newTex3(args.internalProcessSize, args.internalProcessSize, JUMP_FLOOD_FORMAT),
+	seedTex(args.internalProcessSize, args.internalProcessSize, JUMP_FLOOD_FORMAT),
+	packedTex(args.internalProcessSize, args.internalProcessSize, finalImageFormat),
+	uniformBuffer(glHelpers.glFuncs, glHelpers.extraFuncs), ssboForRanges(glHelpers.glFuncs, glHelpers.extraFuncs, true)
 {
 	QTextStream errStrm(stderr);
 	glShader = std::make_unique<QOpenGLShaderProgram>();
@@ -199,7 +145,7 @@ SdfGenerationGL::SdfGenerationGL(const SDFGenerationArguments& args) :
 		if(res.open(QFile::ReadOnly)) {
 			QByteArray shdrArr = res.readAll();
 			if(args.distType == DistanceType::Manhattan) {
-				shdrArr.insert(shdrArr.indexOf('\n')+1,QByteArrayLiteral("#define USE_MANHATTAN_DISTANCE\n"));
+				injectAfterVersion(shdrArr, QByteArrayLiteral("#define USE_MANHATTAN_DISTANCE\n"));
 			}
 			if(!glShader->addCacheableShaderFromSourceCode(QOpenGLShader::Compute,shdrArr)) {
 				errStrm << glShader->log() << '\n';
@@ -216,10 +162,15 @@ SdfGenerationGL::SdfGenerationGL(const SDFGenerationArguments& args) :
 	glShader2 = std::make_unique<QOpenGLShaderProgram>();
 	{
 		QFile res(args.type == SDFType::SDF ? ":/shader3.glsl" : ":/shader3_msdf.glsl");
-		if(res.open(QFile::ReadOnly)) {
+		QFile solvers(":/bezier_solvers.glsl");
+		QFile common(":/outline_common.glsl");
+		if(res.open(QFile::ReadOnly) && solvers.open(QFile::ReadOnly) && common.open(QFile::ReadOnly)) {
 			QByteArray shdrArr = res.readAll();
+			// Each injection lands first, so the solvers end up ahead of the common code that calls them
+			injectAfterVersion(shdrArr, common.readAll());
+			injectAfterVersion(shdrArr, solvers.readAll());
 			if(args.distType == DistanceType::Manhattan) {
-				shdrArr.insert(shdrArr.indexOf('\n')+1,QByteArrayLiteral("#define USE_MANHATTAN_DISTANCE\n"));
+				injectAfterVersion(shdrArr, QByteArrayLiteral("#define USE_MANHATTAN_DISTANCE\n"));
 			}
 			if(!glShader2->addCacheableShaderFromSourceCode(QOpenGLShader::Compute,shdrArr)) {
 				errStrm << glShader2->log() << '\n';
@@ -250,6 +201,16 @@ SdfGenerationGL::SdfGenerationGL(const SDFGenerationArguments& args) :
 			}
 		}
 	}
+	// The quantization shaders read MSDF and MSDFA distances as four channels
+	QByteArray quantizationDefines;
+	if(args.type != SDFType::SDF) quantizationDefines += QByteArrayLiteral("#define MULTI_CHANNEL\n");
+	if(args.type == SDFType::MSDFA) quantizationDefines += QByteArrayLiteral("#define KEEP_ALPHA\n");
+	reduceShader = makeComputeShader(":/sdf_reduce.glsl", quantizationDefines);
+	packShader = makeComputeShader(":/sdf_pack.glsl", quantizationDefines);
+	if(args.type == SDFType::SDF) {
+		seedShader = makeComputeShader(":/jump_flood_seed.glsl", QByteArray());
+		floodShader = makeComputeShader(":/jump_flood.glsl", args.distType == DistanceType::Manhattan ? QByteArrayLiteral("#define USE_MANHATTAN_DISTANCE\n") : QByteArray());
+	}
 	uniform.width = args.samples_to_check_x ? args.samples_to_check_x / 2 : args.padding;
 	uniform.height = args.samples_to_check_y ? args.samples_to_check_y / 2 : args.padding;
 	uniformBuffer.initializeFrom(uniform);
@@ -262,12 +223,44 @@ SdfGenerationGL::SdfGenerationGL(const SDFGenerationArguments& args) :
 	sdfUniform1_vec = glShader2->uniformLocation("rawSdfTexture");
 	sdfUniform2_vec = glShader2->uniformLocation("isInsideTex");
 	ssboUniform_vec = glHelpers.extraFuncs->glGetProgramResourceIndex(glShader2->programId(), GL_SHADER_STORAGE_BLOCK, "EdgeBuffer");
+	edgeIndexUniform_vec = glHelpers.extraFuncs->glGetProgramResourceIndex(glShader2->programId(), GL_SHADER_STORAGE_BLOCK, "EdgeIndex");
+	glyphTableUniform_vec = glHelpers.extraFuncs->glGetProgramResourceIndex(glShader2->programId(), GL_SHADER_STORAGE_BLOCK, "GlyphTable");
 	dimensionsUniform_vec = glShader2->uniformLocation("Dimensions");
 	if(args.type != SDFType::SDF) {
 		glHelpers.glFuncs->glUseProgram(msdfFixerShader->programId());
 		fixer_tex_uniform1 = msdfFixerShader->uniformLocation("sdf_input");
 		fixer_tex_uniform2 = msdfFixerShader->uniformLocation("sdf_output");
 	}
+	invertUniform_pack = packShader->uniformLocation("invert");
+	gammaCorrectUniform_pack = packShader->uniformLocation("gammaCorrect");
+	midpointScaleUniform_pack = packShader->uniformLocation("midpointScale");
+	if(args.type == SDFType::SDF) jumpStepUniform_flood = floodShader->uniformLocation("jumpStep");
+	// A batch is one strip texture of square cells, so it is bounded by the texture height as well
+	GLint maxTextureSize = 0;
+	glHelpers.glFuncs->glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+	const size_t cellSide = std::max<size_t>(1, args.internalProcessSize);
+	maxBatchGlyphs = std::min<size_t>({ OUTLINE_BATCH_GLYPHS, static_cast<size_t>(maxTextureSize) / cellSide, OUTLINE_BATCH_TEXELS / (cellSide * cellSide) });
+	maxBatchGlyphs = std::max<size_t>(1, maxBatchGlyphs);
+	for(int i = 0; i < OUTLINE_SLOTS; ++i) outlineSlots.push_back(std::make_unique<OutlineSlot>(glHelpers));
+}
+
+SdfGenerationGL::OutlineSlot::OutlineSlot(GlHelpers& glHelpers) :
+	ssboForEdges(glHelpers.glFuncs, glHelpers.extraFuncs, true), ssboForEdgeIndex(glHelpers.glFuncs, glHelpers.extraFuncs, true),
+	ssboForGlyphs(glHelpers.glFuncs, glHelpers.extraFuncs, true), ssboForRanges(glHelpers.glFuncs, glHelpers.extraFuncs, true),
+	packedPixels(glHelpers.glFuncs, glHelpers.extraFuncs), extraFuncs(glHelpers.extraFuncs)
+{
+}
+
+SdfGenerationGL::OutlineSlot::~OutlineSlot()
+{
+	release();
+}
+
+void SdfGenerationGL::OutlineSlot::release()
+{
+	if(fence) extraFuncs->glDeleteSync(fence);
+	fence = nullptr;
+	glyphCount = 0;
 }
 
 /*
@@ -276,12 +269,38 @@ SdfGenerationGL::SdfGenerationGL(const SDFGenerationArguments& args) :
 		int ssboUniform_vec;
 */
 
+const GlTexture& SdfGenerationGL::floodNearestSeeds(const SDFGenerationArguments& args)
+{
+	const GLsizei size = args.internalProcessSize;
+	glHelpers.glFuncs->glUseProgram(seedShader->programId());
+	oldTex.bindAsImage(glHelpers.extraFuncs, 0, GL_READ_ONLY);
+	newTex3.bindAsImage(glHelpers.extraFuncs, 5, GL_WRITE_ONLY);
+	glHelpers.extraFuncs->glDispatchCompute(groupsFor(size),groupsFor(size),1);
+	glHelpers.extraFuncs->glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	const GlTexture* seeds = &newTex3;
+	const GlTexture* flooded = &seedTex;
+	glHelpers.glFuncs->glUseProgram(floodShader->programId());
+	// Steps halve from the largest power of two below the size, so every pixel is in reach of every seed
+	for(GLsizei step = static_cast<GLsizei>(std::bit_ceil(static_cast<unsigned>(size)) / 2); step >= 1; step /= 2) {
+		glHelpers.glFuncs->glUniform1i(jumpStepUniform_flood, step);
+		seeds->bindAsImage(glHelpers.extraFuncs, 4, GL_READ_ONLY);
+		flooded->bindAsImage(glHelpers.extraFuncs, 5, GL_WRITE_ONLY);
+		glHelpers.extraFuncs->glDispatchCompute(groupsFor(size),groupsFor(size),1);
+		glHelpers.extraFuncs->glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+		std::swap(seeds, flooded);
+	}
+	return *seeds;
+}
+
 QImage SdfGenerationGL::produceBitmapSdf(const QImage& source, const SDFGenerationArguments& args)
 {
+	Profiler::Scope profileScope("distance evaluation");
+	Profiler::count(Profiler::PIXELS_EVALUATED, static_cast<uint64_t>(args.internalProcessSize) * args.internalProcessSize);
 	glPixelStorei( GL_PACK_ALIGNMENT, 1);
 	glPixelStorei(  GL_UNPACK_ALIGNMENT, 1);
-	glHelpers.glFuncs->glUseProgram(glShader->programId());
 	oldTex.modify(source);
+	// Single-channel distances are looked up in the jump flood rather than searched for
+	const GlTexture* nearestSeeds = args.type == SDFType::SDF ? &floodNearestSeeds(args) : nullptr;
 	glHelpers.glFuncs->glUseProgram(glShader->programId());
 	oldTex.bindAsImage(glHelpers.extraFuncs, 0, GL_READ_ONLY);
 	glHelpers.glFuncs->glUniform1i(fontUniform,0);
@@ -291,58 +310,155 @@ QImage SdfGenerationGL::produceBitmapSdf(const QImage& source, const SDFGenerati
 	glHelpers.glFuncs->glUniform1i(sdfUniform2,2);
 	uniformBuffer.bindBase(3);
 	glHelpers.extraFuncs->glUniformBlockBinding(glShader->programId(), dimensionsUniform, 3);
-	glHelpers.extraFuncs->glDispatchCompute(args.internalProcessSize,args.internalProcessSize,1);
-	glHelpers.extraFuncs->glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	if(nearestSeeds) nearestSeeds->bindAsImage(glHelpers.extraFuncs, 4, GL_READ_ONLY);
+	glHelpers.extraFuncs->glDispatchCompute(groupsFor(args.internalProcessSize),groupsFor(args.internalProcessSize),1);
+	quantizeOnGPU(newTex, newTex2, packedTex, ssboForRanges, 1, args);
 
 	QImage newimg(args.internalProcessSize, args.internalProcessSize, finalImageFormat);
-	switch (args.type) {
-		case SDF: {
-			fetchSdfFromGPU(newimg,args);
-			break;
-		}
-		case MSDF: {
-			fetchMSDFFromGPU(newimg,args);
-			break;
-		}
-		case MSDFA:
-			fetchMSDFFromGPU(newimg,args);
-			break;
-		default: break;
-	}
+	packedTexels.resize(static_cast<size_t>(args.internalProcessSize) * args.internalProcessSize * packedTex.getBytesPerPixel());
+	packedTex.getTexture(packedTexels.data());
+	unpackCells(std::span<QImage>(&newimg, 1), packedTexels.data());
 	return newimg;
 }
 
-QImage SdfGenerationGL::produceOutlineSdf(const FontOutlineDecompositionContext& source, const SDFGenerationArguments& args)
+QImage SdfGenerationGL::produceOutlineSdf(const FontOutlineDecompositionContext& source, const SDFGenerationArguments& args, uint32_t width, uint32_t height)
+{
+	if(width != args.internalProcessSize || height != args.internalProcessSize) throw std::runtime_error("The OpenGL backend only renders square internalProcessSize cells!");
+	const FontOutlineDecompositionContext* const sources[] = { &source };
+	return std::move(produceOutlineSdfs(sources, args).front());
+}
+
+std::vector<QImage> SdfGenerationGL::produceOutlineSdfs(std::span<const FontOutlineDecompositionContext* const> sources, const SDFGenerationArguments& args)
+{
+	if(!slotsInFlight.empty() || !readBatches.empty()) throw std::runtime_error("Submitted outline batches must be collected first!");
+	size_t batches = 0;
+	for(size_t first = 0; first < sources.size(); first += maxBatchGlyphs, ++batches) {
+		submitOutlineSdfs(sources.subspan(first, std::min(maxBatchGlyphs, sources.size() - first)), args);
+	}
+	std::vector<QImage> images;
+	images.reserve(sources.size());
+	for(size_t i = 0; i < batches; ++i) {
+		std::vector<QImage> batch = collectOutlineSdfs(args);
+		std::move(batch.begin(), batch.end(), std::back_inserter(images));
+	}
+	return images;
+}
+
+size_t SdfGenerationGL::outlineBatchSize(const SDFGenerationArguments& args) const
+{
+	(void)args;
+	return maxBatchGlyphs;
+}
+
+size_t SdfGenerationGL::outlineBatchesInFlight() const
+{
+	return outlineSlots.size() - 1;
+}
+
+void SdfGenerationGL::submitOutlineSdfs(std::span<const FontOutlineDecompositionContext* const> sources, const SDFGenerationArguments& args)
 {
+	if(sources.empty()) {
+		while(!slotsInFlight.empty()) readBatches.push_back(finishOldestSlot(args));
+		readBatches.emplace_back();
+		return;
+	}
+	if(sources.size() > maxBatchGlyphs) throw std::runtime_error("Too many outlines for one batch!");
+	// Results stay in submission order: batches read back early go ahead of those still in flight
+	if(slotsInFlight.size() == outlineSlots.size()) readBatches.push_back(finishOldestSlot(args));
+	OutlineSlot& slot = *outlineSlots[nextSlot];
+	nextSlot = (nextSlot + 1) % outlineSlots.size();
+
+	Profiler::Scope profileScope("distance evaluation");
+	const GLsizei size = args.internalProcessSize;
+	const GLsizei count = static_cast<GLsizei>(sources.size());
+	Profiler::count(Profiler::PIXELS_EVALUATED, static_cast<uint64_t>(size) * size * count);
 	glPixelStorei( GL_PACK_ALIGNMENT, 1);
 	glPixelStorei(  GL_UNPACK_ALIGNMENT, 1);
-	QImage newimg(args.internalProcessSize, args.internalProcessSize, finalImageFormat);
+	const float maxDistance = (args.distType == DistanceType::Euclidean)
+								  ? std::sqrt(float(uniform.width * uniform.width + uniform.height * uniform.height))
+								  : float(uniform.width + uniform.height);
+	// Every glyph's edges and index go after the previous glyph's; the glyph table says where each one starts
+	batchEdges.clear();
+	batchGrid.clear();
+	batchGlyphs.clear();
+	for(const FontOutlineDecompositionContext* source : sources) {
+		const EdgeSpatialIndex edgeIndex(source->edges, size, size, maxDistance, args.distType);
+		const uint32_t firstEdge = static_cast<uint32_t>(batchEdges.size());
+		batchGlyphs.push_back({ edgeIndex.getCellSize(), edgeIndex.getColumns(), edgeIndex.getRows(),
+								edgeIndex.appendStd430(batchGrid, firstEdge), firstEdge, static_cast<uint32_t>(source->edges.size()) });
+		batchEdges.insert(batchEdges.end(), source->edges.begin(), source->edges.end());
+	}
+	if(slot.distances.getWidth() != size || slot.distances.getHeight() != size * count) {
+		slot.distances.initialize(size, size * count, temporaryTextureFormat);
+		slot.inside.initialize(size, size * count, args.type == SDFType::SDF ? QImage::Format_Grayscale8 : QImage::Format_RGBA8888);
+		slot.packed.initialize(size, size * count, finalImageFormat);
+	}
 	glHelpers.glFuncs->glUseProgram(glShader2->programId());
-	ssboForEdges.bind();
-	ssboForEdges.initializeFromSpan( std::span<const EdgeSegment>( source.edges.data(), source.edges.size() ) );
-	newTex.bindAsImage(glHelpers.extraFuncs, 1, GL_WRITE_ONLY);
+	slot.ssboForEdges.uploadFromSpan( std::span<const EdgeSegment>( batchEdges.data(), batchEdges.size() ) );
+	slot.ssboForEdgeIndex.uploadFromSpan( std::span<const uint32_t>( batchGrid.data(), batchGrid.size() ) );
+	slot.ssboForGlyphs.uploadFromSpan( std::span<const GlyphRangeForCompute>( batchGlyphs.data(), batchGlyphs.size() ) );
+	slot.distances.bindAsImage(glHelpers.extraFuncs, 1, GL_WRITE_ONLY);
 	glHelpers.glFuncs->glUniform1i(sdfUniform1_vec,1);
-	newTex2.bindAsImage(glHelpers.extraFuncs, 2, GL_WRITE_ONLY);
+	slot.inside.bindAsImage(glHelpers.extraFuncs, 2, GL_WRITE_ONLY);
 	glHelpers.glFuncs->glUniform1i(sdfUniform2_vec,2);
-	ssboForEdges.bindBase(3);
+	slot.ssboForEdges.bindBase(3);
 	uniformBuffer.bindBase(4);
+	slot.ssboForEdgeIndex.bindBase(5);
+	slot.ssboForGlyphs.bindBase(6);
 	glHelpers.gl43Funcs->glShaderStorageBlockBinding(glShader2->programId(), ssboUniform_vec, 3);
-	glHelpers.extraFuncs->glUniformBlockBinding(glShader->programId(), dimensionsUniform_vec, 4);
-	glHelpers.extraFuncs->glDispatchCompute(args.internalProcessSize,args.internalProcessSize,1);
-	glHelpers.extraFuncs->glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-	switch (args.type) {
-		case SDF: {
-			fetchSdfFromGPU(newimg,args);
-			break;
-		}
-		case MSDF: {
-			fetchMSDFFromGPU(newimg,args);
-			break;
+	glHelpers.gl43Funcs->glShaderStorageBlockBinding(glShader2->programId(), edgeIndexUniform_vec, 5);
+	glHelpers.gl43Funcs->glShaderStorageBlockBinding(glShader2->programId(), glyphTableUniform_vec, 6);
+	glHelpers.extraFuncs->glUniformBlockBinding(glShader2->programId(), dimensionsUniform_vec, 4);
+	glHelpers.extraFuncs->glDispatchCompute(groupsFor(size),groupsFor(size),count);
+	quantizeOnGPU(slot.distances, slot.inside, slot.packed, slot.ssboForRanges, count, args);
+	slot.packedPixels.readFrom(slot.packed);
+	slot.fence = glHelpers.extraFuncs->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	// Without a flush, the driver may hold the commands back until the CPU waits on the fence
+	glHelpers.glFuncs->glFlush();
+	slot.glyphCount = sources.size();
+	slotsInFlight.push_back(&slot);
+}
+
+std::vector<QImage> SdfGenerationGL::finishOldestSlot(const SDFGenerationArguments& args)
+{
+	OutlineSlot& slot = *slotsInFlight.front();
+	slotsInFlight.pop_front();
+	{
+		Profiler::Scope profileScope("GPU wait");
+		for(;;) {
+			const GLenum status = glHelpers.extraFuncs->glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_WAIT_NANOSECONDS);
+			if(status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) break;
+			if(status == GL_WAIT_FAILED) {
+				slot.release();
+				throw std::runtime_error("Failed to wait for the GPU!");
+			}
 		}
-		case MSDFA:
-			fetchMSDFFromGPU(newimg,args);
-			break;
-		default: break;
 	}
-	return newimg;
+	const GLsizei size = args.internalProcessSize;
+	std::vector<QImage> images;
+	images.reserve(slot.glyphCount);
+	for(size_t i = 0; i < slot.glyphCount; ++i) images.emplace_back(size, size, finalImageFormat);
+	const size_t pixels = static_cast<size_t>(size) * static_cast<size_t>(size) * slot.glyphCount;
+	unpackCells(images, static_cast<const uint8_t*>(slot.packedPixels.map(pixels * slot.packed.getBytesPerPixel())));
+	slot.packedPixels.unmap();
+	slot.release();
+	return images;
+}
+
+std::vector<QImage> SdfGenerationGL::collectOutlineSdfs(const SDFGenerationArguments& args)
+{
+	if(!readBatches.empty()) {
+		std::vector<QImage> images = std::move(readBatches.front());
+		readBatches.pop_front();
+		return images;
+	}
+	if(slotsInFlight.empty()) throw std::runtime_error("No outline batch was submitted!");
+	return finishOldestSlot(args);
+}
+
+void SdfGenerationGL::discardOutlineSdfs()
+{
+	for(OutlineSlot* slot : slotsInFlight) slot->release();
+	slotsInFlight.clear();
+	readBatches.clear();
 }
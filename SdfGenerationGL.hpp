@@ -9,7 +9,11 @@
 #ifndef SDFGENERATIONGL_HPP
 #define SDFGENERATIONGL_HPP
 #include "SdfGenerationContext.hpp"
+#include <deque>
 #include <memory>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
 #include "GlHelpers.hpp"
 
 #if defined (_MSC_VER)
@@ -29,6 +33,28 @@ struct STD140 UniformForCompute {
 	int32_t padding[2];     ///< Padding for std140 alignment
 };
 
+/**
+ * @brief Glyph table entry of a batched outline dispatch (std430 layout, GlyphRange in the shaders).
+ * @struct GlyphRangeForCompute
+ */
+struct GlyphRangeForCompute {
+	float cellSize;       ///< Side length of a cell of the glyph's EdgeSpatialIndex
+	uint32_t columns;     ///< Number of cells horizontally
+	uint32_t rows;        ///< Number of cells vertically
+	uint32_t gridOffset;  ///< Start of the glyph's cell offsets in the edge index buffer
+	uint32_t firstEdge;   ///< Start of the glyph's edges in the edge buffer
+	uint32_t edgeCount;   ///< Number of edges of the glyph
+};
+
+/**
+ * @brief Distance range of one cell of a strip texture (std430 layout, CellRange in the shaders).
+ * @struct CellRangeForCompute
+ */
+struct CellRangeForCompute {
+	glm::fvec4 maxInside;   ///< Largest inside distance per channel
+	glm::fvec4 maxOutside;  ///< Largest outside distance per channel
+};
+
 /**
  * @brief OpenGL compute shader-based SDF generation context.
  * 
@@ -59,13 +85,56 @@ private:
 	std::unique_ptr<QOpenGLShaderProgram> glShader;         ///< Primary compute shader program
 	std::unique_ptr<QOpenGLShaderProgram> glShader2;        ///< Secondary compute shader program
 	std::unique_ptr<QOpenGLShaderProgram> msdfFixerShader;  ///< MSDF edge fixing shader program
+	std::unique_ptr<QOpenGLShaderProgram> reduceShader;     ///< Per-cell distance range shader program
+	std::unique_ptr<QOpenGLShaderProgram> packShader;       ///< Normalizing and 8-bit packing shader program
+	std::unique_ptr<QOpenGLShaderProgram> seedShader;       ///< Jump flood seeding shader program (SDF only)
+	std::unique_ptr<QOpenGLShaderProgram> floodShader;      ///< Jump flood pass shader program (SDF only)
 	UniformForCompute uniform;                              ///< Uniform buffer data
 	GlTexture oldTex;                                       ///< Previous iteration texture
 	GlTexture newTex;                                      ///< Current iteration texture
 	GlTexture newTex2;                                     ///< Secondary texture buffer
-	GlTexture newTex3;                                     ///< Tertiary texture buffer
+	GlTexture newTex3;                                     ///< Jump flood seeds, ping-ponged with seedTex
+	GlTexture seedTex;                                     ///< Jump flood seeds, ping-ponged with newTex3
+	GlTexture packedTex;                                   ///< Final texels of a bitmap glyph
 	GlStorageBuffer uniformBuffer;                          ///< Uniform buffer object
-	GlStorageBuffer ssboForEdges;                          ///< Shader storage buffer for edge data
+	GlStorageBuffer ssboForRanges;                          ///< Distance range of a bitmap glyph
+
+	/**
+	 * @brief GPU resources of one outline batch, from upload to read-back.
+	 *
+	 * Every slot has its own buffers and textures, so a batch can be uploaded and dispatched
+	 * while the previous one is still being computed or copied into its pixel buffer.
+	 *
+	 * @struct OutlineSlot
+	 */
+	struct OutlineSlot {
+		GlStorageBuffer ssboForEdges;      ///< Shader storage buffer for the edges of every glyph
+		GlStorageBuffer ssboForEdgeIndex;  ///< Shader storage buffer for the flattened EdgeSpatialIndex of every glyph
+		GlStorageBuffer ssboForGlyphs;     ///< Shader storage buffer for the glyph table
+		GlTexture distances;               ///< One square cell per glyph, stacked vertically
+		GlTexture inside;                  ///< Inside mask, laid out like distances
+		GlTexture packed;                  ///< Final texels, laid out like distances
+		GlStorageBuffer ssboForRanges;     ///< Distance range of every cell
+		GlPixelBuffer packedPixels;        ///< Asynchronous read-back of packed
+		QOpenGLExtraFunctions* extraFuncs; ///< For the fence
+		GLsync fence = nullptr;            ///< Signalled once the read-back is done, null while the slot is free
+		size_t glyphCount = 0;             ///< Glyphs of the batch in the slot
+
+		OutlineSlot(GlHelpers& glHelpers);
+		~OutlineSlot();
+		/// Drop the fence, freeing the slot.
+		void release();
+	};
+
+	std::vector<std::unique_ptr<OutlineSlot>> outlineSlots; ///< Ring of slots; batches use them in turn
+	std::deque<OutlineSlot*> slotsInFlight;                 ///< Slots of submitted batches, oldest first
+	size_t nextSlot = 0;                                    ///< Slot the next batch goes into
+	std::deque<std::vector<QImage>> readBatches;            ///< Batches read back early to free their slot, oldest first
+	size_t maxBatchGlyphs;                                  ///< Most outlines rendered by one dispatch
+	std::vector<EdgeSegment> batchEdges;                   ///< Edges of every glyph of a batch, reused between batches
+	std::vector<uint32_t> batchGrid;                       ///< Flattened edge indices of every glyph of a batch, reused between batches
+	std::vector<GlyphRangeForCompute> batchGlyphs;         ///< Glyph table of a batch, reused between batches
+	std::vector<uint8_t> packedTexels;                     ///< Read-back texels of a bitmap glyph, reused between glyphs
 
 	int fontUniform;          ///< Font texture uniform location
 	int sdfUniform1;          ///< First SDF texture uniform location
@@ -73,26 +142,60 @@ private:
 	int dimensionsUniform;    ///< Dimensions uniform location
 	
 	/**
-	 * @brief Fetch SDF result from GPU and convert to QImage.
-	 * @param newimg Output image to populate.
+	 * @brief Find the nearest inside and outside edge pixel of every pixel of oldTex by jump flooding.
+	 *
+	 * Seeds the edge pixels, then runs log2(internalProcessSize) passes with halving steps,
+	 * ping-ponging between newTex3 and seedTex.
+	 *
 	 * @param args Generation arguments.
+	 * @return The texture holding the flooded seeds.
 	 */
-	void fetchSdfFromGPU(QImage& newimg, const SDFGenerationArguments& args);
-	
+	const GlTexture& floodNearestSeeds(const SDFGenerationArguments& args);
+
+	/**
+	 * @brief Quantize raw distances into 8-bit texels on the GPU.
+	 *
+	 * One pass finds the distance range of every cell with a parallel reduction, a second
+	 * one normalizes, inverts, gamma corrects and packs the cells into the packed texture.
+	 * Waits for nothing: the caller reads the packed texture back after the returned barrier.
+	 *
+	 * @param distances Raw distances, one square cell per glyph from the top down.
+	 * @param inside Inside mask, laid out like distances; used by SDF only.
+	 * @param packed Output texture, laid out like distances (R8 for SDF, RGBA8 otherwise).
+	 * @param ranges Scratch buffer for the ranges, grown when too small.
+	 * @param count Number of cells.
+	 * @param args Generation arguments.
+	 */
+	void quantizeOnGPU(const GlTexture& distances, const GlTexture& inside, const GlTexture& packed, GlStorageBuffer& ranges, GLsizei count, const SDFGenerationArguments& args);
+
+	/**
+	 * @brief Copy tightly packed texels read back from a strip texture into the images.
+	 * @param images Output images, one per cell from the top down; all the same size.
+	 * @param texels Read-back texels of every cell.
+	 */
+	static void unpackCells(std::span<QImage> images, const uint8_t* texels);
+
 	/**
-	 * @brief Fetch MSDF result from GPU and convert to QImage.
-	 * @param newimg Output image to populate.
+	 * @brief Wait for the read-back of the oldest batch in flight and copy it into images.
 	 * @param args Generation arguments.
+	 * @return One SDF image per glyph of the batch.
 	 */
-	void fetchMSDFFromGPU(QImage& newimg, const SDFGenerationArguments& args);
+	std::vector<QImage> finishOldestSlot(const SDFGenerationArguments& args);
 
 	int sdfUniform1_vec;       ///< First SDF texture uniform location (vector version)
 	int sdfUniform2_vec;      ///< Second SDF texture uniform location (vector version)
 	int ssboUniform_vec;       ///< SSBO uniform location (vector version)
+	int edgeIndexUniform_vec;  ///< Edge index SSBO block index (vector version)
+	int glyphTableUniform_vec; ///< Glyph table SSBO block index (vector version)
 	int dimensionsUniform_vec; ///< Dimensions uniform location (vector version)
 
 	int fixer_tex_uniform1;   ///< First texture uniform for MSDF fixer shader
 	int fixer_tex_uniform2;   ///< Second texture uniform for MSDF fixer shader
+
+	int invertUniform_pack;        ///< Invert uniform location of the packing shader
+	int gammaCorrectUniform_pack;  ///< Gamma correction uniform location of the packing shader
+	int midpointScaleUniform_pack; ///< Midpoint scale uniform location of the packing shader
+	int jumpStepUniform_flood;     ///< Step uniform location of the jump flood shader
 	
 public:
 	/**
@@ -113,9 +216,59 @@ public:
 	 * @brief Generate SDF from font outline decomposition using GPU compute shaders.
 	 * @param source Font outline decomposition context.
 	 * @param args Generation arguments.
+	 * @param width Width of the canvas; must be internalProcessSize.
+	 * @param height Height of the canvas; must be internalProcessSize.
 	 * @return Generated SDF image.
 	 */
-	QImage produceOutlineSdf(const FontOutlineDecompositionContext& source, const SDFGenerationArguments& args) override;
+	QImage produceOutlineSdf(const FontOutlineDecompositionContext& source, const SDFGenerationArguments& args, uint32_t width, uint32_t height) override;
+
+	/**
+	 * @brief Generate the SDFs of several outlines, maxBatchGlyphs per dispatch.
+	 *
+	 * Submits every batch, then collects them, so the read-back of one batch overlaps with
+	 * the computation of the next.
+	 *
+	 * @param sources Outlines to render, translated to the square internalProcessSize canvas.
+	 * @param args Generation arguments.
+	 * @return One SDF image per outline, in the order of sources.
+	 * @throws std::runtime_error If submitted batches are still waiting to be collected.
+	 */
+	std::vector<QImage> produceOutlineSdfs(std::span<const FontOutlineDecompositionContext* const> sources, const SDFGenerationArguments& args) override;
+
+	/**
+	 * @brief Upload and dispatch a batch, and queue its read-back; returns without waiting for the GPU.
+	 *
+	 * The edges and edge indices of the whole batch go into one pair of storage buffers,
+	 * with a glyph table giving each glyph its part. One dispatch renders every glyph into
+	 * its own cell of a strip texture, which is quantized on the GPU and copied into a pixel
+	 * buffer asynchronously, followed by a fence. When every slot is busy, the oldest batch is read back first.
+	 *
+	 * @param sources At most maxBatchGlyphs outlines, translated to the square internalProcessSize canvas.
+	 * @param args Generation arguments.
+	 */
+	void submitOutlineSdfs(std::span<const FontOutlineDecompositionContext* const> sources, const SDFGenerationArguments& args) override;
+
+	/**
+	 * @brief Wait for the fence of the oldest batch, then copy its cells out of the mapped pixel buffer.
+	 * @param args Generation arguments.
+	 * @return One SDF image per outline of the batch.
+	 */
+	std::vector<QImage> collectOutlineSdfs(const SDFGenerationArguments& args) override;
+
+	void discardOutlineSdfs() override;
+
+	/**
+	 * @brief One batch computes while the next one is prepared.
+	 * @return Number of slots minus one.
+	 */
+	size_t outlineBatchesInFlight() const override;
+
+	/**
+	 * @brief Number of outlines a single dispatch renders.
+	 * @param args Generation arguments.
+	 * @return The batch size, limited by the texture size and a memory budget for the strip textures.
+	 */
+	size_t outlineBatchSize(const SDFGenerationArguments& args) const override;
 };
 
 #endif // SDFGENERATIONGL_HPP
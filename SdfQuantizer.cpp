@@ -0,0 +1,144 @@
+#include "SdfQuantizer.hpp"
+#include "Profiler.hpp"
+#include "RGBA8888.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+/// Scales of one channel, with --invert folded in as a sign.
+struct ChannelScale {
+	float inside;    ///< 0.5 / largest inside distance
+	float outside;   ///< 0.5 / largest outside distance
+};
+
+static ChannelScale makeScale(float maxInside, float maxOutside, bool invert)
+{
+	const float sign = invert ? -0.5f : 0.5f;
+	return { sign / maxInside, sign / maxOutside };
+}
+
+static inline float gammaCurve(float x) {
+	const float d = x - 0.5f;
+	return 0.5f + 2.0f * d * d * d + 0.5f * d;
+}
+
+/// Map a distance already multiplied by its side's scale to a texel.
+template <bool GammaCorrect> static inline uint8_t toTexel(float scaled, float midpointScale) {
+	float t = std::clamp((0.5f + scaled) * midpointScale, 0.0f, 1.0f);
+	if constexpr (GammaCorrect) t = gammaCurve(t);
+	return static_cast<uint8_t>(t * 255.0f);
+}
+
+static float midpointScaleOf(const SDFGenerationArguments& args)
+{
+	return args.midpointAdjustment.has_value() ? 1.0f / args.midpointAdjustment.value() : 1.0f;
+}
+
+template <bool GammaCorrect> static void quantizeSigned(QImage& output, const float* distances, ChannelScale scale, float midpointScale)
+{
+	const int width = output.width();
+	const int height = output.height();
+	uchar* bits = output.bits();
+	const qsizetype stride = output.bytesPerLine();
+#pragma omp parallel for
+	for(int y = 0; y < height; ++y) {
+		uchar* row = bits + y * stride;
+		const float* inRow = distances + static_cast<size_t>(y) * width;
+		for(int x = 0; x < width; ++x) {
+			const float d = inRow[x];
+			row[x] = toTexel<GammaCorrect>(d * (d >= 0.0f ? scale.inside : scale.outside), midpointScale);
+		}
+	}
+}
+
+template <bool GammaCorrect> static void quantizeMasked(QImage& output, const float* distances, const uint8_t* inside, ChannelScale scale, float midpointScale)
+{
+	const int width = output.width();
+	const int height = output.height();
+	uchar* bits = output.bits();
+	const qsizetype stride = output.bytesPerLine();
+#pragma omp parallel for
+	for(int y = 0; y < height; ++y) {
+		uchar* row = bits + y * stride;
+		const size_t rowStart = static_cast<size_t>(y) * width;
+		for(int x = 0; x < width; ++x) {
+			const float d = distances[rowStart + x];
+			row[x] = toTexel<GammaCorrect>(inside[rowStart + x] ? d * scale.inside : -d * scale.outside, midpointScale);
+		}
+	}
+}
+
+template <bool GammaCorrect> static void quantizeChannels(QImage& output, const glm::fvec4* distances, const ChannelScale scale[4], float midpointScale, bool keepAlpha)
+{
+	const int width = output.width();
+	const int height = output.height();
+	uchar* bits = output.bits();
+	const qsizetype stride = output.bytesPerLine();
+#pragma omp parallel for
+	for(int y = 0; y < height; ++y) {
+		RGBA8888* row = reinterpret_cast<RGBA8888*>(bits + y * stride);
+		const glm::fvec4* inRow = distances + static_cast<size_t>(y) * width;
+		for(int x = 0; x < width; ++x) {
+			const glm::fvec4& d = inRow[x];
+			row[x].r = toTexel<GammaCorrect>(d.x * (d.x >= 0.0f ? scale[0].inside : scale[0].outside), midpointScale);
+			row[x].g = toTexel<GammaCorrect>(d.y * (d.y >= 0.0f ? scale[1].inside : scale[1].outside), midpointScale);
+			row[x].b = toTexel<GammaCorrect>(d.z * (d.z >= 0.0f ? scale[2].inside : scale[2].outside), midpointScale);
+			row[x].a = keepAlpha ? toTexel<GammaCorrect>(d.w * (d.w >= 0.0f ? scale[3].inside : scale[3].outside), midpointScale) : 0xFF;
+		}
+	}
+}
+
+void SdfQuantizer::quantize(QImage& output, const float* distances, const SDFGenerationArguments& args)
+{
+	Profiler::Scope profileScope("quantization");
+	const ptrdiff_t count = static_cast<ptrdiff_t>(output.width()) * output.height();
+	float maxInside = std::numeric_limits<float>::epsilon();
+	float maxOutside = std::numeric_limits<float>::epsilon();
+#pragma omp parallel for reduction(max:maxInside,maxOutside)
+	for(ptrdiff_t i = 0; i < count; ++i) {
+		maxInside = std::max(maxInside, distances[i]);
+		maxOutside = std::max(maxOutside, -distances[i]);
+	}
+	const ChannelScale scale = makeScale(maxInside, maxOutside, args.invert);
+	if(args.gammaCorrect) quantizeSigned<true>(output, distances, scale, midpointScaleOf(args));
+	else quantizeSigned<false>(output, distances, scale, midpointScaleOf(args));
+}
+
+void SdfQuantizer::quantize(QImage& output, const float* distances, const uint8_t* inside, const SDFGenerationArguments& args)
+{
+	Profiler::Scope profileScope("quantization");
+	const ptrdiff_t count = static_cast<ptrdiff_t>(output.width()) * output.height();
+	float maxInside = std::numeric_limits<float>::epsilon();
+	float maxOutside = std::numeric_limits<float>::epsilon();
+#pragma omp parallel for reduction(max:maxInside,maxOutside)
+	for(ptrdiff_t i = 0; i < count; ++i) {
+		const float d = std::abs(distances[i]);
+		if(inside[i]) maxInside = std::max(maxInside, d);
+		else maxOutside = std::max(maxOutside, d);
+	}
+	const ChannelScale scale = makeScale(maxInside, maxOutside, args.invert);
+	if(args.gammaCorrect) quantizeMasked<true>(output, distances, inside, scale, midpointScaleOf(args));
+	else quantizeMasked<false>(output, distances, inside, scale, midpointScaleOf(args));
+}
+
+void SdfQuantizer::quantize(QImage& output, const glm::fvec4* distances, const SDFGenerationArguments& args)
+{
+	Profiler::Scope profileScope("quantization");
+	const ptrdiff_t count = static_cast<ptrdiff_t>(output.width()) * output.height();
+	float maxInside[4], maxOutside[4];
+	std::fill_n(maxInside, 4, std::numeric_limits<float>::epsilon());
+	std::fill_n(maxOutside, 4, std::numeric_limits<float>::epsilon());
+#pragma omp parallel for reduction(max:maxInside[:4],maxOutside[:4])
+	for(ptrdiff_t i = 0; i < count; ++i) {
+		for(int c = 0; c < 4; ++c) {
+			maxInside[c] = std::max(maxInside[c], distances[i][c]);
+			maxOutside[c] = std::max(maxOutside[c], -distances[i][c]);
+		}
+	}
+	ChannelScale scale[4];
+	for(int c = 0; c < 4; ++c) scale[c] = makeScale(maxInside[c], maxOutside[c], args.invert);
+	const bool keepAlpha = args.type == SDFType::MSDFA;
+	if(args.gammaCorrect) quantizeChannels<true>(output, distances, scale, midpointScaleOf(args), keepAlpha);
+	else quantizeChannels<false>(output, distances, scale, midpointScaleOf(args), keepAlpha);
+}
@@ -0,0 +1,58 @@
+/**
+ * @file SdfQuantizer.hpp
+ * @brief Normalization and 8-bit quantization of raw distance fields.
+ *
+ * Every generator ends with the same steps: find the largest inside and outside distance,
+ * map the field to [0, 1] with the edge at 0.5, apply --invert, --midpointadjustment and
+ * --gammacorrect, then store 8-bit texels. Doing them as separate passes over a float
+ * buffer moves the whole field through memory five times; here they take two, a parallel
+ * reduction and a single fused pass that writes straight into the image scanlines.
+ */
+
+#ifndef SDFQUANTIZER_HPP
+#define SDFQUANTIZER_HPP
+#include <QImage>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "SDFGenerationArguments.hpp"
+
+/**
+ * @brief Turns raw distances into an 8-bit SDF image.
+ *
+ * Distances are tightly packed, row by row, with as many elements as the output image has
+ * pixels. Positive and negative distances are scaled separately, each by the largest
+ * magnitude on its side, so the full 8-bit range is used on both sides of the edge.
+ *
+ * @struct SdfQuantizer
+ */
+struct SdfQuantizer {
+	/**
+	 * @brief Quantize a signed single-channel field.
+	 * @param output Format_Grayscale8 image of the field's size.
+	 * @param distances Signed distances, positive inside the shape.
+	 * @param args Generation arguments (invert, midpointAdjustment, gammaCorrect).
+	 */
+	static void quantize(QImage& output, const float* distances, const SDFGenerationArguments& args);
+
+	/**
+	 * @brief Quantize a single-channel field whose sign is stored separately.
+	 * @param output Format_Grayscale8 image of the field's size.
+	 * @param distances Distances to the edge.
+	 * @param inside Non-zero for pixels inside the shape.
+	 * @param args Generation arguments (invert, midpointAdjustment, gammaCorrect).
+	 */
+	static void quantize(QImage& output, const float* distances, const uint8_t* inside, const SDFGenerationArguments& args);
+
+	/**
+	 * @brief Quantize a multi-channel field.
+	 *
+	 * Each channel is normalized on its own. Alpha is kept for MSDFA and set to opaque otherwise.
+	 *
+	 * @param output Format_RGBA8888 image of the field's size.
+	 * @param distances Signed distances, positive inside the shape.
+	 * @param args Generation arguments (type, invert, midpointAdjustment, gammaCorrect).
+	 */
+	static void quantize(QImage& output, const glm::fvec4* distances, const SDFGenerationArguments& args);
+};
+
+#endif // SDFQUANTIZER_HPP
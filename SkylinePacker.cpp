@@ -0,0 +1,74 @@
+#include "SkylinePacker.hpp"
+#include <algorithm>
+#include <limits>
+
+SkylinePacker::SkylinePacker(uint32_t pageSize, uint32_t spacing, uint32_t alignment)
+	: pageSize(pageSize), spacing(spacing), alignment(std::max<uint32_t>(1, alignment))
+{
+	clear();
+}
+
+uint32_t SkylinePacker::footprintOf(uint32_t extent) const
+{
+	return (extent + spacing + alignment - 1) / alignment * alignment;
+}
+
+void SkylinePacker::clear()
+{
+	skyline.assign(1, Segment{ 0, 0, pageSize });
+}
+
+std::optional<uint32_t> SkylinePacker::fitAt(size_t segment, uint32_t width, uint32_t height) const
+{
+	const uint32_t x = skyline[segment].x;
+	if(width > pageSize - x) return std::nullopt;
+	// The gap may hang off the right edge of the page, the rectangle itself may not
+	uint32_t widthLeft = std::min(footprintOf(width), pageSize - x);
+	uint32_t y = 0;
+	for(size_t i = segment; widthLeft; ++i) {
+		y = std::max(y, skyline[i].y);
+		widthLeft -= std::min(widthLeft, skyline[i].width);
+	}
+	if(y > pageSize || height > pageSize - y) return std::nullopt;
+	return y;
+}
+
+std::optional<std::pair<uint32_t,uint32_t>> SkylinePacker::insert(uint32_t width, uint32_t height)
+{
+	size_t bestSegment = 0;
+	uint32_t bestY = std::numeric_limits<uint32_t>::max();
+	for(size_t i = 0; i < skyline.size(); ++i) {
+		const std::optional<uint32_t> y = fitAt(i, width, height);
+		if(y && *y < bestY) {
+			bestY = *y;
+			bestSegment = i;
+		}
+	}
+	if(bestY == std::numeric_limits<uint32_t>::max()) return std::nullopt;
+
+	const uint32_t x = skyline[bestSegment].x;
+	// Footprints are multiples of the alignment, so every segment starts on one
+	const uint32_t footprint = std::min(footprintOf(width), pageSize - x);
+	const Segment placed{ x, bestY + footprintOf(height), footprint };
+	// Cut the segments now hidden under the rectangle
+	size_t i = bestSegment;
+	while(i < skyline.size() && skyline[i].x < x + footprint) {
+		const uint32_t end = skyline[i].x + skyline[i].width;
+		if(end <= x + footprint) {
+			skyline.erase(skyline.begin() + i);
+		} else {
+			skyline[i].width = end - (x + footprint);
+			skyline[i].x = x + footprint;
+			break;
+		}
+	}
+	skyline.insert(skyline.begin() + bestSegment, placed);
+	// Merge neighbours at the same height
+	for(size_t j = 1; j < skyline.size();) {
+		if(skyline[j - 1].y == skyline[j].y) {
+			skyline[j - 1].width += skyline[j].width;
+			skyline.erase(skyline.begin() + j);
+		} else ++j;
+	}
+	return std::make_pair(x, bestY);
+}
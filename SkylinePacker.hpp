@@ -0,0 +1,66 @@
+/**
+ * @file SkylinePacker.hpp
+ * @brief Skyline bottom-left rectangle packer for atlas pages.
+ */
+
+#ifndef SKYLINEPACKER_HPP
+#define SKYLINEPACKER_HPP
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Packs rectangles into a single square page.
+ *
+ * The packer tracks the top edge of the occupied area as a list of horizontal segments
+ * (the skyline) and places each rectangle at the lowest position it fits, preferring the
+ * leftmost one on ties. Every rectangle is followed by a gap of spacing texels to its
+ * right and below, so neighbouring glyphs do not bleed into each other when sampled.
+ * With an alignment, every rectangle starts on a multiple of it and its footprint is
+ * rounded up to one, so block-compressed pages never share a block between two glyphs.
+ *
+ * @class SkylinePacker
+ */
+class SkylinePacker {
+private:
+	/// Horizontal segment of the skyline.
+	struct Segment {
+		uint32_t x;
+		uint32_t y;
+		uint32_t width;
+	};
+
+	uint32_t pageSize;              ///< Edge length of the page in texels
+	uint32_t spacing;               ///< Gap kept after every rectangle
+	uint32_t alignment;             ///< Rectangles start on multiples of this
+	std::vector<Segment> skyline;   ///< Segments, left to right, covering the whole page width
+
+	std::optional<uint32_t> fitAt(size_t segment, uint32_t width, uint32_t height) const;
+	/// Round a rectangle's extent plus the spacing up to the alignment.
+	uint32_t footprintOf(uint32_t extent) const;
+
+public:
+	/**
+	 * @brief Create a packer for an empty page.
+	 * @param pageSize Edge length of the page in texels.
+	 * @param spacing Gap kept to the right of and below every rectangle.
+	 * @param alignment Rectangles start on multiples of this, e.g. the block size of a compressed page.
+	 */
+	SkylinePacker(uint32_t pageSize, uint32_t spacing, uint32_t alignment = 1);
+
+	/**
+	 * @brief Empty the page.
+	 */
+	void clear();
+
+	/**
+	 * @brief Place a rectangle.
+	 * @param width Width in texels.
+	 * @param height Height in texels.
+	 * @return Top-left corner of the rectangle, or std::nullopt if the page is full.
+	 */
+	std::optional<std::pair<uint32_t,uint32_t>> insert(uint32_t width, uint32_t height);
+};
+
+#endif // SKYLINEPACKER_HPP
@@ -13,12 +13,12 @@
 typedef struct FT_GlyphSlotRec_*  FT_GlyphSlot;
 
 /**
- * @brief Structure storing data for a single glyph character.
+ * @brief Per-glyph metrics, without the SDF bitmap.
  * 
- * Contains both bitmap dimensions and FreeType-style metrics, along with
- * the actual signed distance field (SDF) bitmap data.
+ * Split out of StoredCharacter so GlyphTable can keep the metrics of every glyph in one
+ * contiguous array while the SDF bytes live in a separate arena.
  */
-struct StoredCharacter {
+struct GlyphMetrics {
 	// Bitmap data
 	bool valid;                    ///< Whether this glyph contains valid data
 	uint32_t width;                ///< Intended width (actual SDF size is set globally in font)
@@ -37,7 +37,15 @@ struct StoredCharacter {
 	float vertBearingX;            ///< Vertical bearing X in font units
 	float vertBearingY;            ///< Vertical bearing Y in font units
 	float vertAdvance;             ///< Vertical advance in font units
-	
+};
+
+/**
+ * @brief Structure storing data for a single glyph character.
+ * 
+ * Contains both bitmap dimensions and FreeType-style metrics, along with
+ * the actual signed distance field (SDF) bitmap data.
+ */
+struct StoredCharacter : GlyphMetrics {
 	// The actual data
 	QByteArray sdf;                ///< Signed distance field bitmap data (format depends on font type)
 	
@@ -176,3 +176,14 @@ QByteArray StoredVectorImage::imageFormatBytes() const
 	const auto terminator = std::find(imageFormat.begin(), imageFormat.end(), '\0');
 	return QByteArray(imageFormat.data(), std::distance(imageFormat.begin(), terminator));
 }
+
+TexelCodec::Format StoredVectorImage::texelFormat() const
+{
+	return TexelCodec::fromName(imageFormatBytes());
+}
+
+QImage StoredVectorImage::mipmapImage(qsizetype level) const
+{
+	const uint32_t size = std::max<uint32_t>(1, actualSize >> level);
+	return TexelCodec::toImage(mipmaps[level], imageFormatBytes(), type, size, size);
+}
@@ -7,6 +7,7 @@
 #include <QCborMap>
 #include <QDataStream>
 #include "SDFGenerationArguments.hpp"
+#include "TexelCodec.hpp"
 
 struct StoredVectorImage
 {
@@ -90,15 +91,28 @@ struct StoredVectorImage
 
 	/**
 	 * @brief Set the null-terminated encoded vector image format.
-	 * @param format Image format name accepted by QImageWriter (e.g. PNG, JPG, WEBP).
+	 * @param format Image format name accepted by QImageWriter (e.g. PNG, JPG, WEBP) or a TexelCodec format (RAW, BC1, BC3, BC4).
 	 */
 	void setImageFormat(const QByteArray& format);
 
 	/**
 	 * @brief Get the encoded vector image format as a null-terminated byte array.
-	 * @return Image format name accepted by QImageWriter.
+	 * @return Image format name accepted by QImageWriter, or a TexelCodec format name.
 	 */
 	QByteArray imageFormatBytes() const;
+
+	/**
+	 * @brief Get the payload format of the mipmaps.
+	 * @return TexelCodec::ENCODED_IMAGE for image files, otherwise the texel format.
+	 */
+	TexelCodec::Format texelFormat() const;
+
+	/**
+	 * @brief Decode a mipmap, whatever its payload format.
+	 * @param level Mipmap level (0 is actualSize texels wide).
+	 * @return The image; null if it cannot be decoded.
+	 */
+	QImage mipmapImage(qsizetype level) const;
 };
 
 #endif // STOREDVECTORIMAGE_HPP
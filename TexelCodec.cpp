@@ -0,0 +1,311 @@
+#include "TexelCodec.hpp"
+#include <QBuffer>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+#define BLOCK_SIZE 4
+#define BLOCK_TEXELS 16
+
+typedef std::array<std::array<uint8_t,4>,BLOCK_TEXELS> TexelBlock;
+
+static size_t channelCount(SDFType type)
+{
+	switch(type) {
+		case SDFType::SDF: return 1;
+		case SDFType::MSDF: return 3;
+		default: return 4;
+	}
+}
+
+/// Fetch a 4x4 block of RGBA texels, repeating the last row and column past the edges.
+static TexelBlock fetchBlock(const QImage& img, int blockX, int blockY)
+{
+	TexelBlock block;
+	const bool grayscale = img.format() == QImage::Format_Grayscale8;
+	for(int y = 0; y < BLOCK_SIZE; ++y) {
+		const uint8_t* row = img.constScanLine(std::min(blockY * BLOCK_SIZE + y, img.height() - 1));
+		for(int x = 0; x < BLOCK_SIZE; ++x) {
+			const int column = std::min(blockX * BLOCK_SIZE + x, img.width() - 1);
+			std::array<uint8_t,4>& texel = block[y * BLOCK_SIZE + x];
+			if(grayscale) texel = { row[column], row[column], row[column], 255 };
+			else std::memcpy(texel.data(), row + column * 4, 4);
+		}
+	}
+	return block;
+}
+
+static void writeU16(QByteArray& out, uint16_t value)
+{
+	out.append(static_cast<char>(value & 0xFF));
+	out.append(static_cast<char>(value >> 8));
+}
+
+/// BC4 block (also the alpha half of BC3): two endpoints and 16 3-bit indices, 8-value mode.
+static void encodeBc4Block(QByteArray& out, const TexelBlock& block, size_t channel)
+{
+	uint8_t lo = 255, hi = 0;
+	for(const auto& texel : block) {
+		lo = std::min(lo, texel[channel]);
+		hi = std::max(hi, texel[channel]);
+	}
+	out.append(static_cast<char>(hi));
+	out.append(static_cast<char>(lo));
+	uint64_t indices = 0;
+	if(hi != lo) {
+		for(size_t i = 0; i < BLOCK_TEXELS; ++i) {
+			// Position along hi..lo in sevenths, then the palette order 0 = hi, 1 = lo, 2..7 = in between
+			const int step = ((hi - block[i][channel]) * 7 + (hi - lo) / 2) / (hi - lo);
+			const uint64_t index = step == 0 ? 0 : step == 7 ? 1 : step + 1;
+			indices |= index << (3 * i);
+		}
+	}
+	for(int i = 0; i < 6; ++i) out.append(static_cast<char>((indices >> (8 * i)) & 0xFF));
+}
+
+static uint16_t packRgb565(int r, int g, int b)
+{
+	return static_cast<uint16_t>((((r * 31 + 127) / 255) << 11) | (((g * 63 + 127) / 255) << 5) | ((b * 31 + 127) / 255));
+}
+
+static std::array<int,3> unpackRgb565(uint16_t colour)
+{
+	const int r = (colour >> 11) & 0x1F;
+	const int g = (colour >> 5) & 0x3F;
+	const int b = colour & 0x1F;
+	return { (r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2) };
+}
+
+/// BC1 block (also the colour half of BC3): two RGB565 endpoints and 16 2-bit indices, 4-colour mode.
+static void encodeBc1Block(QByteArray& out, const TexelBlock& block)
+{
+	std::array<int,3> lo{ 255, 255, 255 }, hi{ 0, 0, 0 }, mean{ 0, 0, 0 };
+	for(const auto& texel : block) {
+		for(int c = 0; c < 3; ++c) {
+			lo[c] = std::min<int>(lo[c], texel[c]);
+			hi[c] = std::max<int>(hi[c], texel[c]);
+			mean[c] += texel[c];
+		}
+	}
+	// The box diagonal has to follow the correlation of the channels, which in an MSDF are often opposed
+	int reference = 0;
+	for(int c = 1; c < 3; ++c) if(hi[c] - lo[c] > hi[reference] - lo[reference]) reference = c;
+	std::array<int,3> end0 = hi, end1 = lo;
+	for(int c = 0; c < 3; ++c) {
+		if(c == reference) continue;
+		int covariance = 0;
+		for(const auto& texel : block) covariance += (texel[reference] * BLOCK_TEXELS - mean[reference]) * (texel[c] * BLOCK_TEXELS - mean[c]) / BLOCK_TEXELS;
+		if(covariance < 0) std::swap(end0[c], end1[c]);
+	}
+	uint16_t colour0 = packRgb565(end0[0], end0[1], end0[2]);
+	uint16_t colour1 = packRgb565(end1[0], end1[1], end1[2]);
+	if(colour0 < colour1) std::swap(colour0, colour1);
+	writeU16(out, colour0);
+	writeU16(out, colour1);
+	uint32_t indices = 0;
+	if(colour0 != colour1) {
+		const std::array<int,3> c0 = unpackRgb565(colour0);
+		const std::array<int,3> c1 = unpackRgb565(colour1);
+		std::array<std::array<int,3>,4> palette{ c0, c1, {}, {} };
+		for(int c = 0; c < 3; ++c) {
+			palette[2][c] = (2 * c0[c] + c1[c]) / 3;
+			palette[3][c] = (c0[c] + 2 * c1[c]) / 3;
+		}
+		for(size_t i = 0; i < BLOCK_TEXELS; ++i) {
+			int best = 0, bestError = INT32_MAX;
+			for(int p = 0; p < 4; ++p) {
+				int error = 0;
+				for(int c = 0; c < 3; ++c) error += (block[i][c] - palette[p][c]) * (block[i][c] - palette[p][c]);
+				if(error < bestError) {
+					bestError = error;
+					best = p;
+				}
+			}
+			indices |= uint32_t(best) << (2 * i);
+		}
+	}
+	writeU16(out, indices & 0xFFFF);
+	writeU16(out, indices >> 16);
+}
+
+static std::array<uint8_t,8> decodeBc4Palette(uint8_t a0, uint8_t a1)
+{
+	std::array<uint8_t,8> palette{ a0, a1 };
+	if(a0 > a1) {
+		for(int i = 1; i < 7; ++i) palette[i + 1] = static_cast<uint8_t>(((7 - i) * a0 + i * a1) / 7);
+	} else {
+		for(int i = 1; i < 5; ++i) palette[i + 1] = static_cast<uint8_t>(((5 - i) * a0 + i * a1) / 5);
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+	return palette;
+}
+
+static void decodeBc4Block(const uint8_t* data, TexelBlock& block, size_t channel)
+{
+	const std::array<uint8_t,8> palette = decodeBc4Palette(data[0], data[1]);
+	uint64_t indices = 0;
+	for(int i = 0; i < 6; ++i) indices |= uint64_t(data[2 + i]) << (8 * i);
+	for(size_t i = 0; i < BLOCK_TEXELS; ++i) block[i][channel] = palette[(indices >> (3 * i)) & 7];
+}
+
+static void decodeBc1Block(const uint8_t* data, TexelBlock& block, bool alwaysFourColours)
+{
+	const uint16_t colour0 = data[0] | (data[1] << 8);
+	const uint16_t colour1 = data[2] | (data[3] << 8);
+	const std::array<int,3> c0 = unpackRgb565(colour0);
+	const std::array<int,3> c1 = unpackRgb565(colour1);
+	std::array<std::array<int,3>,4> palette{ c0, c1, {}, {} };
+	for(int c = 0; c < 3; ++c) {
+		if(alwaysFourColours || colour0 > colour1) {
+			palette[2][c] = (2 * c0[c] + c1[c]) / 3;
+			palette[3][c] = (c0[c] + 2 * c1[c]) / 3;
+		} else {
+			palette[2][c] = (c0[c] + c1[c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+	const uint32_t indices = data[4] | (data[5] << 8) | (data[6] << 16) | (uint32_t(data[7]) << 24);
+	for(size_t i = 0; i < BLOCK_TEXELS; ++i) {
+		const auto& colour = palette[(indices >> (2 * i)) & 3];
+		for(int c = 0; c < 3; ++c) block[i][c] = static_cast<uint8_t>(colour[c]);
+	}
+}
+
+TexelCodec::Format TexelCodec::fromName(const QByteArray& imageFormat)
+{
+	const QByteArray name = imageFormat.trimmed().toUpper();
+	if(name == "RAW") return RAW;
+	if(name == "BC1") return BC1;
+	if(name == "BC3") return BC3;
+	if(name == "BC4") return BC4;
+	return ENCODED_IMAGE;
+}
+
+bool TexelCodec::supports(Format format, SDFType type)
+{
+	switch(format) {
+		case BC1: return type == SDFType::MSDF;
+		case BC3: return type == SDFType::MSDFA;
+		case BC4: return type == SDFType::SDF;
+		default: return true;
+	}
+}
+
+uint32_t TexelCodec::blockSize(Format format)
+{
+	switch(format) {
+		case BC1:
+		case BC3:
+		case BC4: return BLOCK_SIZE;
+		default: return 1;
+	}
+}
+
+QByteArray TexelCodec::encode(const QImage& img, Format format, SDFType type)
+{
+	if(format == ENCODED_IMAGE || !supports(format, type)) throw std::runtime_error("The texel format cannot store this SDF type!");
+	const QImage texels = img.convertToFormat(type == SDFType::SDF ? QImage::Format_Grayscale8 : QImage::Format_RGBA8888);
+	QByteArray out;
+	if(format == RAW) {
+		const size_t channels = channelCount(type);
+		out.reserve(texels.width() * texels.height() * channels);
+		for(int y = 0; y < texels.height(); ++y) {
+			const uint8_t* row = texels.constScanLine(y);
+			if(channels == 1 || channels == 4) {
+				out.append(reinterpret_cast<const char*>(row), texels.width() * channels);
+			} else {
+				for(int x = 0; x < texels.width(); ++x) out.append(reinterpret_cast<const char*>(row + x * 4), channels);
+			}
+		}
+		return out;
+	}
+	const int blocksX = (texels.width() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	const int blocksY = (texels.height() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	out.reserve(blocksX * blocksY * (format == BC3 ? 16 : 8));
+	for(int by = 0; by < blocksY; ++by) {
+		for(int bx = 0; bx < blocksX; ++bx) {
+			const TexelBlock block = fetchBlock(texels, bx, by);
+			switch(format) {
+				case BC1: encodeBc1Block(out, block); break;
+				case BC3: encodeBc4Block(out, block, 3); encodeBc1Block(out, block); break;
+				case BC4: encodeBc4Block(out, block, 0); break;
+				default: break;
+			}
+		}
+	}
+	return out;
+}
+
+QImage TexelCodec::decode(const QByteArray& data, Format format, SDFType type, uint32_t width, uint32_t height)
+{
+	if(!width || !height || format == ENCODED_IMAGE) return QImage();
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data.constData());
+	const int columns = static_cast<int>(width);
+	const int rows = static_cast<int>(height);
+	QImage img(columns, rows, type == SDFType::SDF ? QImage::Format_Grayscale8 : QImage::Format_RGBA8888);
+	if(format == RAW) {
+		const size_t channels = channelCount(type);
+		if(size_t(data.size()) < size_t(columns) * rows * channels) return QImage();
+		for(int y = 0; y < rows; ++y) {
+			uint8_t* row = img.scanLine(y);
+			const uint8_t* source = bytes + size_t(y) * columns * channels;
+			if(channels == 1 || channels == 4) {
+				std::memcpy(row, source, columns * channels);
+			} else {
+				for(int x = 0; x < columns; ++x) {
+					std::memcpy(row + x * 4, source + x * channels, channels);
+					row[x * 4 + 3] = 255;
+				}
+			}
+		}
+		return img;
+	}
+	const int blocksX = (columns + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	const int blocksY = (rows + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	const size_t blockBytes = format == BC3 ? 16 : 8;
+	if(size_t(data.size()) < size_t(blocksX) * blocksY * blockBytes) return QImage();
+	for(int by = 0; by < blocksY; ++by) {
+		for(int bx = 0; bx < blocksX; ++bx) {
+			const uint8_t* source = bytes + (size_t(by) * blocksX + bx) * blockBytes;
+			TexelBlock block;
+			for(auto& texel : block) texel = { 0, 0, 0, 255 };
+			switch(format) {
+				case BC1: decodeBc1Block(source, block, false); break;
+				case BC3: decodeBc4Block(source, block, 3); decodeBc1Block(source + 8, block, true); break;
+				case BC4: decodeBc4Block(source, block, 0); break;
+				default: break;
+			}
+			for(int y = 0; y < BLOCK_SIZE && by * BLOCK_SIZE + y < rows; ++y) {
+				uint8_t* row = img.scanLine(by * BLOCK_SIZE + y);
+				for(int x = 0; x < BLOCK_SIZE && bx * BLOCK_SIZE + x < columns; ++x) {
+					const std::array<uint8_t,4>& texel = block[y * BLOCK_SIZE + x];
+					if(type == SDFType::SDF) row[bx * BLOCK_SIZE + x] = texel[0];
+					else std::memcpy(row + (bx * BLOCK_SIZE + x) * 4, texel.data(), 4);
+				}
+			}
+		}
+	}
+	return img;
+}
+
+QByteArray TexelCodec::fromImage(QImage img, const QByteArray& imageFormat, SDFType type)
+{
+	const Format format = fromName(imageFormat);
+	if(format != ENCODED_IMAGE) return encode(img, format, type);
+	if(type == SDFType::MSDF) img = img.convertToFormat(QImage::Format_RGB888);
+	QByteArray bytes;
+	QBuffer buff(&bytes);
+	buff.open(QIODevice::WriteOnly);
+	if(!img.save(&buff, imageFormat.constData(), -1)) throw std::runtime_error("Failed to save image!");
+	buff.close();
+	return bytes;
+}
+
+QImage TexelCodec::toImage(const QByteArray& data, const QByteArray& imageFormat, SDFType type, uint32_t width, uint32_t height)
+{
+	const Format format = fromName(imageFormat);
+	if(format == ENCODED_IMAGE) return QImage::fromData(data);
+	return decode(data, format, type, width, height);
+}
@@ -0,0 +1,106 @@
+/**
+ * @file TexelCodec.hpp
+ * @brief GPU-ready texel payloads for glyphs and vector images.
+ *
+ * Glyphs are normally stored as PNG/JPG/WEBP files, which every consumer has to decode
+ * and re-upload. The formats handled here store texels the way a GPU samples them, so
+ * the bytes can go straight to glTexImage2D or glCompressedTexImage2D.
+ */
+
+#ifndef TEXELCODEC_HPP
+#define TEXELCODEC_HPP
+#include <QByteArray>
+#include <QImage>
+#include <cstdint>
+#include "SDFGenerationArguments.hpp"
+
+/**
+ * @brief Encoder and decoder of raw and block-compressed texel payloads.
+ *
+ * Payloads carry no header, so the reader has to know the image size. Glyphs are square
+ * with an edge of the face's bitmap_size (or bitmap_logical_size if bitmap_size is 0),
+ * unless the face uses tight glyph bounds, in which case each glyph's width and height
+ * give its size; mipmap level i of a vector image is max(1, actualSize >> i) texels wide.
+ * Blocks and rows run top to bottom.
+ *
+ * @struct TexelCodec
+ */
+struct TexelCodec {
+	/**
+	 * @brief Payload format, selected by the imageFormat name.
+	 * @enum Format
+	 */
+	enum Format {
+		ENCODED_IMAGE,  ///< Any other name: an image file written by QImage::save
+		RAW,            ///< "RAW": uncompressed 8-bit texels (R for SDF, RGB for MSDF, RGBA for MSDFA)
+		BC1,            ///< "BC1": 4x4 blocks of 8 bytes, RGB (MSDF)
+		BC3,            ///< "BC3": 4x4 blocks of 16 bytes, RGB plus interpolated alpha (MSDFA)
+		BC4             ///< "BC4": 4x4 blocks of 8 bytes, single channel (SDF)
+	};
+
+	/**
+	 * @brief Map an imageFormat name to a payload format.
+	 * @param imageFormat Format name (case-insensitive).
+	 * @return The texel format, or ENCODED_IMAGE for image file formats.
+	 */
+	static Format fromName(const QByteArray& imageFormat);
+
+	/**
+	 * @brief Check whether a payload format can hold every channel of an SDF type.
+	 * @param format Payload format.
+	 * @param type SDF type.
+	 * @return True if the combination is valid.
+	 */
+	static bool supports(Format format, SDFType type);
+
+	/**
+	 * @brief Edge length of the blocks a payload format compresses together.
+	 * @param format Payload format.
+	 * @return 4 for the block-compressed formats, 1 otherwise.
+	 */
+	static uint32_t blockSize(Format format);
+
+	/**
+	 * @brief Encode an image into a texel payload.
+	 * @param img SDF image (any QImage format).
+	 * @param format Payload format other than ENCODED_IMAGE.
+	 * @param type SDF type, which selects the channels that are kept.
+	 * @return Encoded texels.
+	 * @throws std::runtime_error If the format cannot hold the SDF type.
+	 */
+	static QByteArray encode(const QImage& img, Format format, SDFType type);
+
+	/**
+	 * @brief Decode a texel payload back into an image (e.g. for previews).
+	 * @param data Encoded texels.
+	 * @param format Payload format other than ENCODED_IMAGE.
+	 * @param type SDF type the payload was encoded for.
+	 * @param width Width of the image in texels.
+	 * @param height Height of the image in texels.
+	 * @return Grayscale8 image for SDF, RGBA8888 otherwise; null if data is too short.
+	 */
+	static QImage decode(const QByteArray& data, Format format, SDFType type, uint32_t width, uint32_t height);
+
+	/**
+	 * @brief Encode a glyph, mipmap or atlas page in whatever format is requested.
+	 * @param img SDF image (any QImage format).
+	 * @param imageFormat imageFormat name: a texel format or a QImageWriter format.
+	 * @param type SDF type, which selects the channels that are kept.
+	 * @return Encoded bytes.
+	 * @throws std::runtime_error If the image cannot be encoded.
+	 */
+	static QByteArray fromImage(QImage img, const QByteArray& imageFormat, SDFType type);
+
+	/**
+	 * @brief Decode a glyph or mipmap payload in whatever format it was stored.
+	 * @param data Stored bytes.
+	 * @param imageFormat Stored imageFormat name.
+	 * @param type SDF type the payload was encoded for.
+	 * @param width Width of the image in texels (ignored for image files).
+	 * @param height Height of the image in texels (ignored for image files).
+	 * @return The image; null if it cannot be decoded.
+	 */
+	static QImage toImage(const QByteArray& data, const QByteArray& imageFormat, SDFType type, uint32_t width, uint32_t height);
+};
+
+#endif // TEXELCODEC_HPP
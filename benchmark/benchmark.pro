@@ -0,0 +1,7 @@
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    curve_distance \
+    direct_generation \
+    downsampling \
+    sdf_generation
@@ -0,0 +1,83 @@
+/**
+ * @file SyntheticGlyphs.hpp
+ * @brief Outlines built in code, shared by the benchmarks so they need no font files.
+ *
+ * Every glyph is drawn in a 1000-unit em and covers the cases the distance engines care
+ * about: cubic curves and holes ("O"), sharp corners and thin strokes ("W"), several
+ * contours ("i") and quadratic curves ("D").
+ */
+
+#ifndef SYNTHETICGLYPHS_HPP
+#define SYNTHETICGLYPHS_HPP
+#include "FontOutlineDecompositionContext.hpp"
+#include "SDFGenerationArguments.hpp"
+#include <vector>
+
+#define CIRCLE_KAPPA 0.5523f
+/// Number of glyphs makeSyntheticGlyph() can build.
+#define SYNTHETIC_GLYPH_COUNT 4
+
+/// Closed circle of four cubics, counter-clockwise unless reversed.
+inline void addCircle(FontOutlineDecompositionContext& outline, glm::fvec2 centre, float radius, bool reversed)
+{
+	const float k = radius * CIRCLE_KAPPA;
+	const float s = reversed ? -1.0f : 1.0f;
+	outline.moveTo(centre + glm::fvec2(radius, 0.0f));
+	outline.cubicTo(centre + glm::fvec2(radius, s * k), centre + glm::fvec2(k, s * radius), centre + glm::fvec2(0.0f, s * radius));
+	outline.cubicTo(centre + glm::fvec2(-k, s * radius), centre + glm::fvec2(-radius, s * k), centre + glm::fvec2(-radius, 0.0f));
+	outline.cubicTo(centre + glm::fvec2(-radius, -s * k), centre + glm::fvec2(-k, -s * radius), centre + glm::fvec2(0.0f, -s * radius));
+	outline.cubicTo(centre + glm::fvec2(k, -s * radius), centre + glm::fvec2(radius, -s * k), centre + glm::fvec2(radius, 0.0f));
+	outline.closeShape();
+}
+
+/// Closed polygon through the given points.
+inline void addPolygon(FontOutlineDecompositionContext& outline, const std::vector<glm::fvec2>& points)
+{
+	outline.moveTo(points.front());
+	for(size_t i = 1; i < points.size(); ++i) outline.lineTo(points[i]);
+	outline.lineTo(points.front());
+	outline.closeShape();
+}
+
+/// Build a synthetic glyph and fit it to the square processing canvas of the arguments.
+inline FontOutlineDecompositionContext makeSyntheticGlyph(int which, const SDFGenerationArguments& args)
+{
+	FontOutlineDecompositionContext outline;
+	switch(which) {
+		case 0: // "O": a ring
+			addCircle(outline, glm::fvec2(500.0f, 500.0f), 450.0f, false);
+			addCircle(outline, glm::fvec2(500.0f, 500.0f), 300.0f, true);
+			break;
+		case 1: // "W": sharp corners and thin strokes
+			addPolygon(outline, { {0, 1000}, {120, 1000}, {250, 250}, {440, 1000}, {560, 1000}, {750, 250}, {880, 1000},
+								  {1000, 1000}, {820, 0}, {690, 0}, {500, 700}, {310, 0}, {180, 0} });
+			break;
+		case 2: // "i": a stem and a dot
+			addPolygon(outline, { {400, 0}, {600, 0}, {600, 650}, {400, 650} });
+			addCircle(outline, glm::fvec2(500.0f, 850.0f), 110.0f, false);
+			break;
+		default: // "D": a bowl of quadratics around a counter
+			outline.moveTo(glm::fvec2(150.0f, 0.0f));
+			outline.lineTo(glm::fvec2(450.0f, 0.0f));
+			outline.conicTo(glm::fvec2(900.0f, 0.0f), glm::fvec2(900.0f, 500.0f));
+			outline.conicTo(glm::fvec2(900.0f, 1000.0f), glm::fvec2(450.0f, 1000.0f));
+			outline.lineTo(glm::fvec2(150.0f, 1000.0f));
+			outline.lineTo(glm::fvec2(150.0f, 0.0f));
+			outline.closeShape();
+			outline.moveTo(glm::fvec2(300.0f, 150.0f));
+			outline.lineTo(glm::fvec2(300.0f, 850.0f));
+			outline.lineTo(glm::fvec2(440.0f, 850.0f));
+			outline.conicTo(glm::fvec2(750.0f, 850.0f), glm::fvec2(750.0f, 500.0f));
+			outline.conicTo(glm::fvec2(750.0f, 150.0f), glm::fvec2(440.0f, 150.0f));
+			outline.lineTo(glm::fvec2(300.0f, 150.0f));
+			outline.closeShape();
+			break;
+	}
+	outline.makeShapeIdsSigend();
+	outline.orientContours();
+	outline.translateToNewSize(args.internalProcessSize, args.internalProcessSize, args.padding, args.padding);
+	if(args.type != SDFType::SDF) outline.assignColours();
+	return outline;
+}
+
+#endif // SYNTHETICGLYPHS_HPP
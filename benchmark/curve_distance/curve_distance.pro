@@ -0,0 +1,12 @@
+TEMPLATE = app
+CONFIG += c++2a console
+CONFIG -= qt app_bundle
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+        ../../FontOutlineDecompositionContext.cpp \
+        main.cpp
+
+HEADERS += \
+    ../../FontOutlineDecompositionContext.hpp
@@ -0,0 +1,82 @@
+/**
+ * @file main.cpp
+ * @brief Benchmark of curve distance queries: resolution-dependent sampling versus the analytic solver.
+ *
+ * The outline shaders used to sample every Bezier curve at internalProcessSize / 4 points
+ * per pixel. EdgeSegment::closestPoint() (and its GLSL port in bezier_solvers.glsl) solves
+ * for the closest point directly, at a cost that does not depend on the resolution. For
+ * each canvas size, the same random glyph-sized curves are queried from random pixels with
+ * both methods, and the time per query and the largest disagreement are reported.
+ */
+
+#include "FontOutlineDecompositionContext.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <vector>
+
+/// Minimum distance over evenly spaced samples of the curve, as the shaders used to compute it.
+static float sampledDistance(const EdgeSegment& edge, const glm::fvec2& origin, int steps)
+{
+	float minDist = std::numeric_limits<float>::max();
+	for (int i = 0; i <= steps; ++i) {
+		minDist = std::min(minDist, glm::length(origin - edge.point(static_cast<float>(i) / steps)));
+	}
+	return minDist;
+}
+
+static float analyticDistance(const EdgeSegment& edge, const glm::fvec2& origin)
+{
+	float param;
+	return glm::length(origin - edge.closestPoint(origin, param));
+}
+
+template <typename Func> static double millisecondsOf(const Func& func)
+{
+	const auto start = std::chrono::steady_clock::now();
+	func();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+	constexpr int CURVE_COUNT = 64;
+	constexpr int QUERY_COUNT = 4096;
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	std::printf("%6s %14s %14s %9s %12s\n", "size", "sampled ns/q", "analytic ns/q", "speedup", "max |diff|");
+	for (const int size : { 512, 1024, 2048, 4096 }) {
+		std::vector<EdgeSegment> edges(CURVE_COUNT);
+		for (size_t i = 0; i < edges.size(); ++i) {
+			edges[i] = {};
+			edges[i].type = (i % 2) ? EdgeType::CUBIC : EdgeType::QUADRATIC;
+			for (auto& point : edges[i].points) point = glm::fvec2(unit(rng), unit(rng)) * static_cast<float>(size);
+		}
+		std::vector<glm::fvec2> queries(QUERY_COUNT);
+		for (auto& query : queries) query = glm::fvec2(unit(rng), unit(rng)) * static_cast<float>(size);
+
+		const int steps = size / 4;
+		std::vector<float> sampled(queries.size() * edges.size());
+		std::vector<float> analytic(queries.size() * edges.size());
+		const double sampledMs = millisecondsOf([&]() {
+			for (size_t q = 0; q < queries.size(); ++q)
+				for (size_t e = 0; e < edges.size(); ++e)
+					sampled[q * edges.size() + e] = sampledDistance(edges[e], queries[q], steps);
+		});
+		const double analyticMs = millisecondsOf([&]() {
+			for (size_t q = 0; q < queries.size(); ++q)
+				for (size_t e = 0; e < edges.size(); ++e)
+					analytic[q * edges.size() + e] = analyticDistance(edges[e], queries[q]);
+		});
+		float maxDiff = 0.0f;
+		for (size_t i = 0; i < sampled.size(); ++i) maxDiff = std::max(maxDiff, std::abs(sampled[i] - analytic[i]));
+
+		const double queryCount = static_cast<double>(sampled.size());
+		std::printf("%6d %14.1f %14.1f %8.1fx %12.4f\n", size, sampledMs * 1e6 / queryCount,
+					analyticMs * 1e6 / queryCount, sampledMs / analyticMs, maxDiff);
+	}
+	return 0;
+}
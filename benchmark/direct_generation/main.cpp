@@ -0,0 +1,84 @@
+/**
+ * @file main.cpp
+ * @brief Benchmark of outline SDF generation: large canvas plus downsampling versus direct generation.
+ *
+ * The default pipeline renders every glyph at internalProcessSize and halves the result down
+ * to intendedSize, so almost every distance it computes is averaged away. With --supersample,
+ * SdfGenerationContext::produceDirectOutlineSdf() evaluates the field on the final texel grid
+ * with N x N samples per texel instead. For a few synthetic glyphs, both pipelines are timed
+ * and the direct results are compared to the classic ones, in 8-bit levels.
+ */
+
+#include "SdfGenerationContextSoft.hpp"
+#include "../common/SyntheticGlyphs.hpp"
+#include <QVariantMap>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+template <typename Func> static double millisecondsOf(const Func& func)
+{
+	const auto start = std::chrono::steady_clock::now();
+	func();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/// Largest and mean absolute difference over every channel of two images of the same size and format.
+static void compareImages(const QImage& a, const QImage& b, int& maxDiff, double& meanDiff)
+{
+	maxDiff = 0;
+	double sum = 0.0;
+	const int bytesPerRow = a.width() * (a.depth() / 8);
+	for(int y = 0; y < a.height(); ++y) {
+		const uchar* rowA = a.constScanLine(y);
+		const uchar* rowB = b.constScanLine(y);
+		for(int x = 0; x < bytesPerRow; ++x) {
+			const int diff = std::abs(int(rowA[x]) - int(rowB[x]));
+			maxDiff = std::max(maxDiff, diff);
+			sum += diff;
+		}
+	}
+	meanDiff = sum / (double(bytesPerRow) * a.height());
+}
+
+int main()
+{
+	SdfGenerationContextSoft ctx;
+	std::printf("%5s %4s %2s %12s %12s %9s %8s %9s\n", "type", "size", "N", "classic ms", "direct ms", "speedup", "max diff", "mean diff");
+	for(const SDFType type : { SDFType::SDF, SDFType::MSDF }) {
+		for(const unsigned intendedSize : { 32u, 64u }) {
+			SDFGenerationArguments args;
+			args.fromArgs(QVariantMap{ { QStringLiteral("internalprocesssize"), 1024 }, { QStringLiteral("intendedsize"), intendedSize }, { QStringLiteral("padding"), 100 } });
+			args.type = type;
+			for(const uint32_t samples : { 1u, 2u, 4u }) {
+				double classicMs = 0.0, directMs = 0.0, meanDiff = 0.0;
+				int maxDiff = 0;
+				for(int glyph = 0; glyph < 3; ++glyph) {
+					FontOutlineDecompositionContext outline = makeSyntheticGlyph(glyph, args);
+					QImage classic;
+					classicMs += millisecondsOf([&]() {
+						classic = ctx.produceOutlineSdf(outline, args, args.internalProcessSize, args.internalProcessSize);
+						while(classic.width() > static_cast<int>(intendedSize)) classic = SdfGenerationContext::downsampleImageByAveraging(classic);
+					});
+					SDFGenerationArguments directArgs = args;
+					directArgs.supersample = samples;
+					QImage direct;
+					directMs += millisecondsOf([&]() {
+						direct = ctx.produceDirectOutlineSdf(outline, directArgs, args.internalProcessSize, args.internalProcessSize, intendedSize, intendedSize);
+					});
+					int glyphMax;
+					double glyphMean;
+					compareImages(classic, direct, glyphMax, glyphMean);
+					maxDiff = std::max(maxDiff, glyphMax);
+					meanDiff += glyphMean / 3.0;
+				}
+				std::printf("%5s %4u %2u %12.2f %12.2f %8.1fx %8d %9.2f\n", type == SDFType::SDF ? "SDF" : "MSDF", intendedSize, samples,
+							classicMs / 3.0, directMs / 3.0, classicMs / directMs, maxDiff, meanDiff);
+			}
+		}
+	}
+	return 0;
+}
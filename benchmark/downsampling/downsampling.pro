@@ -0,0 +1,16 @@
+TEMPLATE = app
+QT += core gui
+CONFIG += c++2a console
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../..
+QMAKE_CXXFLAGS += -fopenmp
+QMAKE_LFLAGS += -fopenmp
+
+SOURCES += \
+        ../../MipPyramid.cpp \
+        main.cpp
+
+HEADERS += \
+    ../../MipPyramid.hpp \
+    ../../RGBA8888.hpp
@@ -0,0 +1,260 @@
+/**
+ * @file main.cpp
+ * @brief Benchmark of SDF generation across backends, glyph paths, SDF types, metrics and sizes.
+ *
+ * The corpus is fixed, so results from different commits can be compared: the synthetic
+ * outlines of SyntheticGlyphs.hpp (one at a time, and in one batch of several copies), the
+ * same glyphs rasterized for the bitmap path, and a few inline SVG images run through the
+ * whole vector image pipeline. Every combination of backend (software, and OpenGL when a
+ * context can be created, e.g. on Mesa llvmpipe), path, SDFType, DistanceType and
+ * internalProcessSize is timed. Glyphs per second, nanoseconds per evaluated pixel and the
+ * peak resident set size go to a JSON document meant to be kept and diffed between runs.
+ *
+ * Usage: sdf_generation [--out <file.json>] [--sizes 256,512,1024] [--repeat <n>] [--nogl]
+ */
+
+#include "SdfGenerationContextSoft.hpp"
+#include "SdfGenerationGL.hpp"
+#include "StoredVectorImage.hpp"
+#include "../common/SyntheticGlyphs.hpp"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QFile>
+#include <QGuiApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QVariantMap>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <omp.h>
+#include <stdexcept>
+#include <string>
+#include <sys/resource.h>
+#include <vector>
+
+/// Padding as a fraction of internalProcessSize, so the bitmap search window grows with the canvas like it does in practice.
+#define PADDING_DIVISOR 32
+#define INTENDED_SIZE 64
+/// Copies of the outline corpus handed to produceOutlineSdfs() at once by the batch path.
+#define BATCH_COPIES 16
+
+enum class GlyphPath { Outline, OutlineBatch, Bitmap, Svg };
+
+static const char* const SVG_CORPUS[] = {
+	"<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"100\" height=\"100\" viewBox=\"0 0 100 100\">"
+	"<path d=\"M50 5 L61 38 L95 38 L67 58 L78 92 L50 71 L22 92 L33 58 L5 38 L39 38 Z\" fill=\"black\"/></svg>",
+	"<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"100\" height=\"100\" viewBox=\"0 0 100 100\">"
+	"<path d=\"M50 90 C20 70 5 50 5 30 C5 15 17 5 30 5 C40 5 47 12 50 20 C53 12 60 5 70 5 C83 5 95 15 95 30 C95 50 80 70 50 90 Z\" fill=\"black\"/></svg>",
+	"<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"100\" height=\"100\" viewBox=\"0 0 100 100\">"
+	"<path d=\"M10 10 L90 10 L90 90 L10 90 Z M30 30 L30 70 L70 70 L70 30 Z\" fill=\"black\" fill-rule=\"evenodd\"/>"
+	"<path d=\"M45 45 Q50 35 55 45 Q65 50 55 55 Q50 65 45 55 Q35 50 45 45 Z\" fill=\"black\"/></svg>"
+};
+
+/// Forget the peak so far, so the next reading only covers what follows (Linux; elsewhere the peak keeps growing).
+static void resetPeakRss()
+{
+	std::ofstream clearRefs("/proc/self/clear_refs");
+	if(clearRefs) clearRefs << "5";
+}
+
+static long peakRssKiB()
+{
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while(std::getline(status, line)) {
+		if(line.rfind("VmHWM:", 0) == 0) return std::stol(line.substr(6));
+	}
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+static const char* typeName(SDFType type)
+{
+	switch(type) {
+		case SDFType::SDF: return "SDF";
+		case SDFType::MSDF: return "MSDF";
+		default: return "MSDFA";
+	}
+}
+
+static const char* pathName(GlyphPath path)
+{
+	switch(path) {
+		case GlyphPath::Outline: return "outline";
+		case GlyphPath::OutlineBatch: return "batch";
+		case GlyphPath::Bitmap: return "bitmap";
+		default: return "svg";
+	}
+}
+
+static SDFGenerationArguments makeArgs(unsigned size, SDFType type, DistanceType distType)
+{
+	SDFGenerationArguments args;
+	args.fromArgs(QVariantMap{ { QStringLiteral("internalprocesssize"), size }, { QStringLiteral("intendedsize"), INTENDED_SIZE },
+							   { QStringLiteral("padding"), size / PADDING_DIVISOR } });
+	args.type = type;
+	args.distType = distType;
+	return args;
+}
+
+/// The synthetic glyphs as the anti-aliasing-free coverage masks FTBitmap2QImage() would hand to the bitmap path.
+static std::vector<QImage> rasterizeCorpus(SdfGenerationContextSoft& soft, unsigned size)
+{
+	const SDFGenerationArguments args = makeArgs(size, SDFType::SDF, DistanceType::Euclidean);
+	std::vector<QImage> masks;
+	for(int glyph = 0; glyph < SYNTHETIC_GLYPH_COUNT; ++glyph) {
+		QImage mask = soft.produceOutlineSdf(makeSyntheticGlyph(glyph, args), args, size, size);
+		for(int y = 0; y < mask.height(); ++y) {
+			uchar* row = mask.scanLine(y);
+			for(int x = 0; x < mask.width(); ++x) row[x] = row[x] >= 128 ? 255 : 0;
+		}
+		masks.push_back(mask);
+	}
+	return masks;
+}
+
+/// Run the corpus of one path through a context once and return the number of items processed.
+static int runCorpus(SdfGenerationContext& ctx, GlyphPath path, const SDFGenerationArguments& args,
+					 const std::vector<FontOutlineDecompositionContext>& outlines, const std::vector<QImage>& masks)
+{
+	switch(path) {
+		case GlyphPath::Outline:
+			for(const auto& outline : outlines) ctx.produceOutlineSdf(outline, args, args.internalProcessSize, args.internalProcessSize);
+			return static_cast<int>(outlines.size());
+		case GlyphPath::OutlineBatch: {
+			std::vector<const FontOutlineDecompositionContext*> batch;
+			for(int copy = 0; copy < BATCH_COPIES; ++copy) {
+				for(const auto& outline : outlines) batch.push_back(&outline);
+			}
+			ctx.produceOutlineSdfs(batch, args);
+			return static_cast<int>(batch.size());
+		}
+		case GlyphPath::Bitmap:
+			for(const QImage& mask : masks) ctx.produceBitmapSdf(mask, args);
+			return static_cast<int>(masks.size());
+		default:
+			for(const char* svg : SVG_CORPUS) {
+				StoredVectorImage image;
+				ctx.processSvg(image, QByteArray(svg), args);
+			}
+			return static_cast<int>(std::size(SVG_CORPUS));
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	QString outPath;
+	QList<unsigned> sizes = { 256, 512, 1024 };
+	int repeat = 1;
+	bool useGl = true;
+	for(int i = 1; i < argc; ++i) {
+		const QString arg = QString::fromLocal8Bit(argv[i]);
+		if(arg == QStringLiteral("--nogl")) useGl = false;
+		else if(arg == QStringLiteral("--out") && i + 1 < argc) outPath = QString::fromLocal8Bit(argv[++i]);
+		else if(arg == QStringLiteral("--repeat") && i + 1 < argc) repeat = std::max(1, QString::fromLocal8Bit(argv[++i]).toInt());
+		else if(arg == QStringLiteral("--sizes") && i + 1 < argc) {
+			sizes.clear();
+			for(const QString& size : QString::fromLocal8Bit(argv[++i]).split(QLatin1Char(','), Qt::SkipEmptyParts)) sizes.push_back(size.toUInt());
+		} else {
+			std::fprintf(stderr, "Usage: %s [--out <file.json>] [--sizes 256,512,1024] [--repeat <n>] [--nogl]\n", argv[0]);
+			return 1;
+		}
+	}
+	// An OpenGL context needs a GUI application; without one, the benchmark also runs where there is no display
+	std::unique_ptr<QCoreApplication> app;
+	if(useGl) app = std::make_unique<QGuiApplication>(argc, argv);
+	else app = std::make_unique<QCoreApplication>(argc, argv);
+
+	QJsonObject report;
+	report[QStringLiteral("benchmark")] = QStringLiteral("sdf_generation");
+	report[QStringLiteral("timestamp")] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+	report[QStringLiteral("threads")] = omp_get_max_threads();
+	report[QStringLiteral("intendedSize")] = INTENDED_SIZE;
+	report[QStringLiteral("repeat")] = repeat;
+	QJsonArray results;
+	QJsonArray skipped;
+
+	SdfGenerationContextSoft soft;
+	std::fprintf(stderr, "%-9s %-7s %-5s %-9s %5s %12s %10s %10s\n", "backend", "path", "type", "distance", "size", "glyphs/s", "ns/pixel", "peak MiB");
+	for(const unsigned size : sizes) {
+		const std::vector<QImage> masks = rasterizeCorpus(soft, size);
+		for(const SDFType type : { SDFType::SDF, SDFType::MSDF, SDFType::MSDFA }) {
+			for(const DistanceType distType : { DistanceType::Manhattan, DistanceType::Euclidean }) {
+				const SDFGenerationArguments args = makeArgs(size, type, distType);
+				std::vector<FontOutlineDecompositionContext> outlines;
+				for(int glyph = 0; glyph < SYNTHETIC_GLYPH_COUNT; ++glyph) outlines.push_back(makeSyntheticGlyph(glyph, args));
+
+				for(const bool gl : { false, true }) {
+					if(gl && !useGl) continue;
+					// Shaders are compiled for one type, metric and size, so each combination gets its own context
+					std::unique_ptr<SdfGenerationGL> glContext;
+					if(gl) {
+						try {
+							glContext = std::make_unique<SdfGenerationGL>(args);
+						} catch(const std::exception& e) {
+							QJsonObject skip;
+							skip[QStringLiteral("backend")] = QStringLiteral("opengl");
+							skip[QStringLiteral("reason")] = QString::fromUtf8(e.what());
+							skipped.append(skip);
+							useGl = false;
+							continue;
+						}
+						if(!report.contains(QStringLiteral("glRenderer"))) {
+							const GLubyte* renderer = QOpenGLContext::currentContext()->functions()->glGetString(GL_RENDERER);
+							report[QStringLiteral("glRenderer")] = QString::fromUtf8(reinterpret_cast<const char*>(renderer));
+						}
+					}
+					SdfGenerationContext& ctx = gl ? static_cast<SdfGenerationContext&>(*glContext) : soft;
+					for(const GlyphPath path : { GlyphPath::Outline, GlyphPath::OutlineBatch, GlyphPath::Bitmap, GlyphPath::Svg }) {
+						// One untimed pass warms up caches, allocations and the GL driver
+						runCorpus(ctx, path, args, outlines, masks);
+						resetPeakRss();
+						int glyphs = 0;
+						const auto start = std::chrono::steady_clock::now();
+						for(int r = 0; r < repeat; ++r) glyphs += runCorpus(ctx, path, args, outlines, masks);
+						const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+						const double pixels = double(glyphs) * size * size;
+						const long peakKiB = peakRssKiB();
+
+						QJsonObject result;
+						result[QStringLiteral("backend")] = gl ? QStringLiteral("opengl") : QStringLiteral("software");
+						result[QStringLiteral("path")] = QString::fromLatin1(pathName(path));
+						result[QStringLiteral("type")] = QString::fromLatin1(typeName(type));
+						result[QStringLiteral("distance")] = distType == DistanceType::Euclidean ? QStringLiteral("Euclidean") : QStringLiteral("Manhattan");
+						result[QStringLiteral("internalProcessSize")] = static_cast<int>(size);
+						result[QStringLiteral("glyphs")] = glyphs;
+						result[QStringLiteral("seconds")] = seconds;
+						result[QStringLiteral("glyphsPerSecond")] = glyphs / seconds;
+						result[QStringLiteral("nsPerPixel")] = seconds * 1e9 / pixels;
+						result[QStringLiteral("peakRssKiB")] = static_cast<qint64>(peakKiB);
+						results.append(result);
+						std::fprintf(stderr, "%-9s %-7s %-5s %-9s %5u %12.1f %10.2f %10.1f\n", gl ? "opengl" : "software", pathName(path), typeName(type),
+									 distType == DistanceType::Euclidean ? "Euclidean" : "Manhattan", size, glyphs / seconds, seconds * 1e9 / pixels, peakKiB / 1024.0);
+					}
+				}
+			}
+		}
+	}
+	report[QStringLiteral("results")] = results;
+	report[QStringLiteral("skipped")] = skipped;
+
+	const QByteArray json = QJsonDocument(report).toJson(QJsonDocument::Indented);
+	if(outPath.isEmpty()) {
+		std::fwrite(json.constData(), 1, json.size(), stdout);
+		return 0;
+	}
+	QFile out(outPath);
+	if(!out.open(QFile::WriteOnly | QFile::Truncate) || out.write(json) != json.size()) {
+		std::fprintf(stderr, "Failed to write %s\n", qPrintable(outPath));
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,42 @@
+TEMPLATE = app
+QT += core gui opengl core5compat
+CONFIG += c++2a console
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../.. /usr/include/freetype2 /usr/include/harfbuzz
+QMAKE_CXXFLAGS += -fopenmp
+QMAKE_LFLAGS += -fopenmp
+LIBS += -lfreetype -lharfbuzz -lsvgtiny -fopenmp
+
+SOURCES += \
+        ../../ConstStrings.cpp \
+        ../../EdgeSpatialIndex.cpp \
+        ../../FontAtlas.cpp \
+        ../../FontKerningReader.cpp \
+        ../../FontOutlineDecompositionContext.cpp \
+        ../../FontPackWriter.cpp \
+        ../../GlHelpers.cpp \
+        ../../GlyphCache.cpp \
+        ../../GlyphTable.cpp \
+        ../../HugePreallocator.cpp \
+        ../../KerningTable.cpp \
+        ../../MipPyramid.cpp \
+        ../../PreprocessedFontFace.cpp \
+        ../../Profiler.cpp \
+        ../../SDFGenerationArguments.cpp \
+        ../../SdfEncodeStage.cpp \
+        ../../SdfGenerationContext.cpp \
+        ../../SdfGenerationContextSoft.cpp \
+        ../../SdfGenerationGL.cpp \
+        ../../SdfQuantizer.cpp \
+        ../../SkylinePacker.cpp \
+        ../../StoredCharacter.cpp \
+        ../../StoredVectorImage.cpp \
+        ../../TexelCodec.cpp \
+        main.cpp
+
+HEADERS += \
+    ../common/SyntheticGlyphs.hpp
+
+RESOURCES += \
+    ../../resources.qrc
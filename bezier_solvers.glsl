@@ -0,0 +1,298 @@
+/**
+ * @file bezier_solvers.glsl
+ * @brief Closed-form and few-iteration Bezier solvers shared by the outline compute shaders.
+ *
+ * GLSL port of solveQuadratic(), solveCubic(), EdgeSegment::closestPoint() and
+ * EdgeSegment::scanlineIntersections() from FontOutlineDecompositionContext.cpp, so the
+ * CPU and GPU engines find the same closest points and crossings. The cost per curve is
+ * constant, independent of the texture size.
+ *
+ * SdfGenerationGL injects this file right after the #version line of shader3.glsl and
+ * shader3_msdf.glsl, so it must not depend on anything declared there.
+ */
+
+const float BEZIER_PI = 3.14159265358979;
+const int CUBIC_SEARCH_STARTS = 6;  ///< Newton starting guesses for cubic closest points
+const int CUBIC_SEARCH_STEPS = 8;   ///< Newton iterations per starting guess
+const float CUBIC_SEARCH_TOLERANCE = 1e-6;  ///< Parameter step below which Newton's method has converged
+
+/**
+ * @brief Solve a*x^2 + b*x + c = 0.
+ * @return Number of real solutions written to x, or -1 if every x is a solution.
+ */
+int solveQuadratic(out float x[2], float a, float b, float c) {
+    // a == 0 -> linear equation
+    if (a == 0.0 || abs(b) > 1e12 * abs(a)) {
+	if (b == 0.0) {
+	    return c == 0.0 ? -1 : 0;
+	}
+	x[0] = -c / b;
+	return 1;
+    }
+    float dscr = b * b - 4.0 * a * c;
+    if (dscr > 0.0) {
+	dscr = sqrt(dscr);
+	x[0] = (-b + dscr) / (2.0 * a);
+	x[1] = (-b - dscr) / (2.0 * a);
+	return 2;
+    } else if (dscr == 0.0) {
+	x[0] = -b / (2.0 * a);
+	return 1;
+    }
+    return 0;
+}
+
+int solveCubicNormed(out float x[3], float a, float b, float c) {
+    float a2 = a * a;
+    float q = (a2 - 3.0 * b) / 9.0;
+    float r = (a * (2.0 * a2 - 9.0 * b) + 27.0 * c) / 54.0;
+    float r2 = r * r;
+    float q3 = q * q * q;
+    a /= 3.0;
+    if (r2 < q3) {
+	float t = acos(clamp(r / sqrt(q3), -1.0, 1.0));
+	q = -2.0 * sqrt(q);
+	x[0] = q * cos(t / 3.0) - a;
+	x[1] = q * cos((t + 2.0 * BEZIER_PI) / 3.0) - a;
+	x[2] = q * cos((t - 2.0 * BEZIER_PI) / 3.0) - a;
+	return 3;
+    }
+    float u = (r < 0.0 ? 1.0 : -1.0) * pow(abs(r) + sqrt(r2 - q3), 1.0 / 3.0);
+    float v = u == 0.0 ? 0.0 : q / u;
+    x[0] = (u + v) - a;
+    if (u == v || abs(u - v) < 1e-6 * abs(u + v)) {
+	x[1] = -0.5 * (u + v) - a;
+	return 2;
+    }
+    return 1;
+}
+
+/**
+ * @brief Solve a*x^3 + b*x^2 + c*x + d = 0.
+ * @return Number of real solutions written to x, or -1 if every x is a solution.
+ */
+int solveCubic(out float x[3], float a, float b, float c, float d) {
+    if (a != 0.0) {
+	float bn = b / a;
+	// Above this ratio, the numerical error gets larger than if we treated a as zero
+	if (abs(bn) < 1e6) return solveCubicNormed(x, bn, c / a, d / a);
+    }
+    float x2[2];
+    int solutions = solveQuadratic(x2, b, c, d);
+    x[0] = x2[0];
+    x[1] = x2[1];
+    return solutions;
+}
+
+/**
+ * @brief Closest point of a quadratic Bezier curve to origin.
+ *
+ * The derivative of the squared distance is a cubic polynomial in t, solved in closed form.
+ * Each root gets one Newton step to recover the precision lost to single-precision floats.
+ */
+vec2 closestPointQuadratic(vec2 origin, vec2 p0, vec2 p1, vec2 p2, out float param) {
+    vec2 qa = p0 - origin;
+    vec2 ab = p1 - p0;
+    vec2 br = p2 - p1 - ab;
+    vec2 qb = p2 - origin;
+    float minDist2 = dot(qa, qa);
+    param = 0.0;
+    if (dot(qb, qb) < minDist2) {
+	minDist2 = dot(qb, qb);
+	param = 1.0;
+    }
+    float t[3];
+    int solutions = solveCubic(t, dot(br, br), 3.0 * dot(ab, br), 2.0 * dot(ab, ab) + dot(qa, br), dot(qa, ab));
+    for (int i = 0; i < solutions; ++i) {
+	float ti = t[i];
+	vec2 qe = qa + 2.0 * ti * ab + ti * ti * br;
+	vec2 d1 = ab + ti * br;
+	float denominator = 2.0 * dot(d1, d1) + dot(qe, br);
+	if (denominator != 0.0) ti -= dot(qe, d1) / denominator;
+	if (ti > 0.0 && ti < 1.0) {
+	    qe = qa + 2.0 * ti * ab + ti * ti * br;
+	    float dist2 = dot(qe, qe);
+	    if (dist2 < minDist2) {
+		minDist2 = dist2;
+		param = ti;
+	    }
+	}
+    }
+    return p0 + 2.0 * param * ab + param * param * br;
+}
+
+/**
+ * @brief Closest point of a cubic Bezier curve to origin.
+ *
+ * The derivative of the squared distance is quintic, so a handful of starting guesses
+ * are refined with Newton's method.
+ */
+vec2 closestPointCubic(vec2 origin, vec2 p0, vec2 p1, vec2 p2, vec2 p3, out float param) {
+    vec2 qa = p0 - origin;
+    vec2 ab = p1 - p0;
+    vec2 br = p2 - p1 - ab;
+    vec2 as = (p3 - p2) - (p2 - p1) - br;
+    vec2 qb = p3 - origin;
+    float minDist2 = dot(qa, qa);
+    param = 0.0;
+    if (dot(qb, qb) < minDist2) {
+	minDist2 = dot(qb, qb);
+	param = 1.0;
+    }
+    for (int i = 0; i <= CUBIC_SEARCH_STARTS; ++i) {
+	float t = float(i) / float(CUBIC_SEARCH_STARTS);
+	vec2 qe = qa + 3.0 * t * ab + 3.0 * t * t * br + t * t * t * as;
+	for (int step = 0; step < CUBIC_SEARCH_STEPS; ++step) {
+	    vec2 d1 = 3.0 * ab + 6.0 * t * br + 3.0 * t * t * as;
+	    vec2 d2 = 6.0 * br + 6.0 * t * as;
+	    float denominator = dot(d1, d1) + dot(qe, d2);
+	    if (denominator == 0.0) break;
+	    float delta = dot(qe, d1) / denominator;
+	    t -= delta;
+	    if (t <= 0.0 || t >= 1.0) break;
+	    qe = qa + 3.0 * t * ab + 3.0 * t * t * br + t * t * t * as;
+	    float dist2 = dot(qe, qe);
+	    if (dist2 < minDist2) {
+		minDist2 = dist2;
+		param = t;
+	    }
+	    if (abs(delta) < CUBIC_SEARCH_TOLERANCE) break;
+	}
+    }
+    return p0 + 3.0 * param * ab + 3.0 * param * param * br + param * param * param * as;
+}
+
+/**
+ * @brief Crossings of a line segment with the horizontal line at height y.
+ * @return Number of crossings; x receives their positions and dy their vertical directions.
+ */
+int scanlineIntersectionsLinear(vec2 p0, vec2 p1, float y, out float x[3], out int dy[3]) {
+    if ((y >= p0.y && y < p1.y) || (y >= p1.y && y < p0.y)) {
+	x[0] = mix(p0.x, p1.x, (y - p0.y) / (p1.y - p0.y));
+	dy[0] = int(sign(p1.y - p0.y));
+	return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Crossings of a quadratic Bezier curve with the horizontal line at height y.
+ * @return Number of crossings; x receives their positions and dy their vertical directions.
+ */
+int scanlineIntersectionsQuadratic(vec2 p0, vec2 p1, vec2 p2, float y, out float x[3], out int dy[3]) {
+    int total = 0;
+    int nextDY = y > p0.y ? 1 : -1;
+    x[total] = p0.x;
+    if (p0.y == y) {
+	if (p0.y < p1.y || (p0.y == p1.y && p0.y < p2.y)) dy[total++] = 1;
+	else nextDY = 1;
+    }
+    {
+	vec2 ab = p1 - p0;
+	vec2 br = p2 - p1 - ab;
+	float t[2];
+	int solutions = solveQuadratic(t, br.y, 2.0 * ab.y, p0.y - y);
+	if (solutions >= 2 && t[0] > t[1]) {
+	    float tmp = t[0]; t[0] = t[1]; t[1] = tmp;
+	}
+	for (int i = 0; i < solutions && total < 2; ++i) {
+	    if (t[i] >= 0.0 && t[i] <= 1.0) {
+		x[total] = p0.x + 2.0 * t[i] * ab.x + t[i] * t[i] * br.x;
+		if (float(nextDY) * (ab.y + t[i] * br.y) >= 0.0) {
+		    dy[total++] = nextDY;
+		    nextDY = -nextDY;
+		}
+	    }
+	}
+    }
+    if (p2.y == y) {
+	if (nextDY > 0 && total > 0) {
+	    --total;
+	    nextDY = -1;
+	}
+	if ((p2.y < p1.y || (p2.y == p1.y && p2.y < p0.y)) && total < 2) {
+	    x[total] = p2.x;
+	    if (nextDY < 0) {
+		dy[total++] = -1;
+		nextDY = 1;
+	    }
+	}
+    }
+    if (nextDY != (y >= p2.y ? 1 : -1)) {
+	if (total > 0) {
+	    --total;
+	} else {
+	    if (abs(p2.y - y) < abs(p0.y - y)) x[total] = p2.x;
+	    dy[total++] = nextDY;
+	}
+    }
+    return total;
+}
+
+/**
+ * @brief Crossings of a cubic Bezier curve with the horizontal line at height y.
+ * @return Number of crossings; x receives their positions and dy their vertical directions.
+ */
+int scanlineIntersectionsCubic(vec2 p0, vec2 p1, vec2 p2, vec2 p3, float y, out float x[3], out int dy[3]) {
+    int total = 0;
+    int nextDY = y > p0.y ? 1 : -1;
+    x[total] = p0.x;
+    if (p0.y == y) {
+	if (p0.y < p1.y || (p0.y == p1.y && (p0.y < p2.y || (p0.y == p2.y && p0.y < p3.y)))) dy[total++] = 1;
+	else nextDY = 1;
+    }
+    {
+	vec2 ab = p1 - p0;
+	vec2 br = p2 - p1 - ab;
+	vec2 as = (p3 - p2) - (p2 - p1) - br;
+	float t[3];
+	int solutions = solveCubic(t, as.y, 3.0 * br.y, 3.0 * ab.y, p0.y - y);
+	if (solutions >= 2) {
+	    float tmp;
+	    if (t[0] > t[1]) {
+		tmp = t[0]; t[0] = t[1]; t[1] = tmp;
+	    }
+	    if (solutions >= 3 && t[1] > t[2]) {
+		tmp = t[1]; t[1] = t[2]; t[2] = tmp;
+		if (t[0] > t[1]) {
+		    tmp = t[0]; t[0] = t[1]; t[1] = tmp;
+		}
+	    }
+	}
+	for (int i = 0; i < solutions && total < 3; ++i) {
+	    if (t[i] >= 0.0 && t[i] <= 1.0) {
+		// Single-precision Cardano can be off near double roots; one Newton step fixes the position
+		float ti = t[i];
+		float slope = 3.0 * (ab.y + 2.0 * ti * br.y + ti * ti * as.y);
+		if (slope != 0.0) ti = clamp(ti - (p0.y + 3.0 * ti * ab.y + 3.0 * ti * ti * br.y + ti * ti * ti * as.y - y) / slope, 0.0, 1.0);
+		x[total] = p0.x + 3.0 * ti * ab.x + 3.0 * ti * ti * br.x + ti * ti * ti * as.x;
+		if (float(nextDY) * (ab.y + 2.0 * t[i] * br.y + t[i] * t[i] * as.y) >= 0.0) {
+		    dy[total++] = nextDY;
+		    nextDY = -nextDY;
+		}
+	    }
+	}
+    }
+    if (p3.y == y) {
+	if (nextDY > 0 && total > 0) {
+	    --total;
+	    nextDY = -1;
+	}
+	if ((p3.y < p2.y || (p3.y == p2.y && (p3.y < p1.y || (p3.y == p1.y && p3.y < p0.y)))) && total < 3) {
+	    x[total] = p3.x;
+	    if (nextDY < 0) {
+		dy[total++] = -1;
+		nextDY = 1;
+	    }
+	}
+    }
+    if (nextDY != (y >= p3.y ? 1 : -1)) {
+	if (total > 0) {
+	    --total;
+	} else {
+	    if (abs(p3.y - y) < abs(p0.y - y)) x[total] = p3.x;
+	    dy[total++] = nextDY;
+	}
+    }
+    return total;
+}
@@ -0,0 +1,75 @@
+/**
+ * @file jump_flood.glsl
+ * @brief OpenGL compute shader running one pass of the jump flood of the bitmap SDF.
+ *
+ * Each pixel looks at itself and its eight neighbours jumpStep pixels away, and keeps the
+ * nearest inside and nearest outside seed among theirs. Passes run with jumpStep halving
+ * from half the texture size down to 1, ping-ponging between two textures, so after
+ * log2(size) passes every pixel knows its nearest edge pixel of both sides, whatever the
+ * search window.
+ *
+ * @version 430 core
+ * @requires OpenGL 4.3+ with compute shader support
+ */
+
+#version 430 core
+
+layout (local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+/**
+ * @brief Seeds found by the previous pass (see jump_flood_seed.glsl).
+ * @binding 4
+ */
+layout (binding = 4, rgba16i) readonly uniform iimage2D seedsIn;
+
+/**
+ * @brief Seeds found by this pass.
+ * @binding 5
+ */
+layout (binding = 5, rgba16i) writeonly uniform iimage2D seedsOut;
+
+uniform int jumpStep;  ///< Distance to the neighbours looked at by this pass
+
+#define NO_SEED -1
+#define FLT_MAX 3.402823466e+38
+
+#ifdef USE_MANHATTAN_DISTANCE
+    #define DISTANCE_FUNC(p1, p2) (abs((p1).x - (p2).x) + abs((p1).y - (p2).y))
+#else
+    #define DISTANCE_FUNC(p1, p2) length((p1) - (p2))
+#endif
+
+void main() {
+    ivec2 threadId = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 imageDimensions = imageSize(seedsIn);
+    if (threadId.x >= imageDimensions.x || threadId.y >= imageDimensions.y) {
+        return;
+    }
+
+    vec2 pos = vec2(threadId);
+    ivec4 nearest = ivec4(NO_SEED);
+    float insideDistance = FLT_MAX;
+    float outsideDistance = FLT_MAX;
+    for (int offsetY = -1; offsetY <= 1; ++offsetY) {
+        for (int offsetX = -1; offsetX <= 1; ++offsetX) {
+            ivec2 samplePos = threadId + ivec2(offsetX, offsetY) * jumpStep;
+            if (any(lessThan(samplePos, ivec2(0))) || any(greaterThanEqual(samplePos, imageDimensions))) continue;
+            ivec4 seeds = imageLoad(seedsIn, samplePos);
+            if (seeds.x != NO_SEED) {
+                float dist = DISTANCE_FUNC(pos, vec2(seeds.xy));
+                if (dist < insideDistance) {
+                    insideDistance = dist;
+                    nearest.xy = seeds.xy;
+                }
+            }
+            if (seeds.z != NO_SEED) {
+                float dist = DISTANCE_FUNC(pos, vec2(seeds.zw));
+                if (dist < outsideDistance) {
+                    outsideDistance = dist;
+                    nearest.zw = seeds.zw;
+                }
+            }
+        }
+    }
+    imageStore(seedsOut, threadId, nearest);
+}
@@ -0,0 +1,57 @@
+/**
+ * @file jump_flood_seed.glsl
+ * @brief OpenGL compute shader seeding the jump flood of the bitmap SDF.
+ *
+ * The nearest pixel of the other side of the outline is always an edge pixel: one with a
+ * neighbour on the other side. Edge pixels seed themselves, inside ones in the first pair
+ * of channels and outside ones in the second, so jump_flood.glsl can find the nearest
+ * pixel of either side for every pixel at once.
+ *
+ * @version 430 core
+ * @requires OpenGL 4.3+ with compute shader support
+ */
+
+#version 430 core
+
+layout (local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+/**
+ * @brief Input bitmap texture (8-bit grayscale).
+ * @binding 0
+ */
+layout (binding = 0, r8) readonly uniform image2D fontTexture;
+
+/**
+ * @brief Output seeds: nearest inside pixel in xy, nearest outside pixel in zw, NO_SEED where unknown.
+ * @binding 5
+ */
+layout (binding = 5, rgba16i) writeonly uniform iimage2D seedsOut;
+
+#define NO_SEED -1
+
+/**
+ * @brief Whether a pixel is inside the shape; samples past the border repeat the border.
+ */
+bool insideAt(ivec2 pos, ivec2 texSize) {
+    return imageLoad(fontTexture, clamp(pos, ivec2(0), texSize - ivec2(1))).r > 0.5;
+}
+
+void main() {
+    ivec2 threadId = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 imageDimensions = imageSize(fontTexture);
+    if (threadId.x >= imageDimensions.x || threadId.y >= imageDimensions.y) {
+        return;
+    }
+
+    bool isInside = insideAt(threadId, imageDimensions);
+    bool isEdge = insideAt(threadId + ivec2(1, 0), imageDimensions) != isInside
+               || insideAt(threadId - ivec2(1, 0), imageDimensions) != isInside
+               || insideAt(threadId + ivec2(0, 1), imageDimensions) != isInside
+               || insideAt(threadId - ivec2(0, 1), imageDimensions) != isInside;
+    ivec4 seeds = ivec4(NO_SEED);
+    if (isEdge) {
+        if (isInside) seeds.xy = threadId;
+        else seeds.zw = threadId;
+    }
+    imageStore(seedsOut, threadId, seeds);
+}
@@ -12,6 +12,8 @@
  *          --invectorbin <path>, or --invectorcbor <path>
  * - Output: --outbin <path>, --outcbor <path>, --outfont <pattern>,
  *           --outvectorbin <path>, or --outvectorcbor <path>
+ * - Atlas: --atlaspagesize <texels> [--atlasspacing <texels>] packs the glyphs onto shared pages
+ * - Profiling: --profile <path> writes a Chrome trace of the build and prints a per-stage summary
  * - See SDFGenerationArguments for all available options
  */
 
@@ -21,9 +23,14 @@
 #include <QFile>
 #include "ConstStrings.hpp"
 #include "SdfGenerationContext.hpp"
+#include "FontPackWriter.hpp"
 #include "SdfGenerationGL.hpp"
 #include "SdfGenerationContextSoft.hpp"
 #include "MainWindow.hpp"
+#include "Profiler.hpp"
+
+/// Empty texels between neighbouring glyphs on an atlas page, unless --atlasspacing is given.
+#define DEFAULT_ATLAS_SPACING 1
 
 /**
  * @brief Parse command-line arguments into a QVariantMap.
@@ -50,10 +57,12 @@ int main(int argc, char *argv[])
 			strm << it.key() << ' ' << it.value().toString() << '\n';
 		}
 		strm.flush();
+		if(args.contains(PROFILE_KEY)) Profiler::enable();
 		PreprocessedFontFace fontface;
 		StoredVectorImage vectorImage;
 		bool hasFontFace = false;
 		bool hasVectorImage = false;
+		bool streamedBinary = false;
 		if( args.contains( IN_FONT_KEY ) ) {
 			SDFGenerationArguments sdfArgs;
 			sdfArgs.fromArgs(args);
@@ -64,7 +73,22 @@ int main(int argc, char *argv[])
 				case OPENCL: throw std::runtime_error("Unsupported mode!");
 					break;
 			}
-			ctx->processFont(fontface,sdfArgs);
+			// A binary pack can be written while the glyphs are generated, unless another output or the atlas needs them all in memory
+			const bool streamBinary = args.contains(OUT_BIN_KEY) && !args.contains(OUT_CBOR_KEY) && !args.contains(OUT_FONT_KEY) && !args.contains(IN_SVG_KEY) && !args.contains(ATLAS_PAGE_SIZE_KEY);
+			QFile binFile(args.value(OUT_BIN_KEY).toString());
+			if(streamBinary && binFile.open(QFile::WriteOnly)) {
+				QDataStream binF(&binFile);
+				binF.setVersion(QDataStream::Qt_4_0);
+				binF.setByteOrder(QDataStream::BigEndian);
+				FontPackWriter writer(binF);
+				ctx->processFont(fontface,sdfArgs,&writer);
+				binFile.flush();
+				Profiler::count(Profiler::BYTES_WRITTEN, binFile.size());
+				binFile.close();
+				streamedBinary = true;
+			} else {
+				ctx->processFont(fontface,sdfArgs);
+			}
 			hasFontFace = true;
 		}
 		if( args.contains( IN_SVG_KEY ) ) {
@@ -132,19 +156,25 @@ int main(int argc, char *argv[])
 			}
 		}
 
+		if(args.contains( ATLAS_PAGE_SIZE_KEY )) {
+			if(!hasFontFace) throw std::runtime_error("No preprocessed font face was loaded or generated.");
+			fontface.packAtlas(args.value(ATLAS_PAGE_SIZE_KEY).toUInt(), args.value(ATLAS_SPACING_KEY, DEFAULT_ATLAS_SPACING).toUInt());
+		}
 		if(args.contains( OUT_FONT_KEY )) {
 			if(!hasFontFace) throw std::runtime_error("No preprocessed font face was loaded or generated.");
 			fontface.outToFolder( args.value(OUT_FONT_KEY).toString() );
 		}
-		if(args.contains( OUT_BIN_KEY )) {
+		if(args.contains( OUT_BIN_KEY ) && !streamedBinary) {
 			if(!hasFontFace) throw std::runtime_error("No preprocessed font face was loaded or generated.");
 			QFile fil(args.value(OUT_BIN_KEY).toString());
 			if(fil.open(QFile::WriteOnly)) {
+				Profiler::Scope profileScope("serialization");
 				QDataStream binF(&fil);
 				binF.setVersion(QDataStream::Qt_4_0);
 				binF.setByteOrder(QDataStream::BigEndian);
 				fontface.toData(binF);
 				fil.flush();
+				Profiler::count(Profiler::BYTES_WRITTEN, fil.size());
 				fil.close();
 			}
 		}
@@ -152,9 +182,11 @@ int main(int argc, char *argv[])
 			if(!hasFontFace) throw std::runtime_error("No preprocessed font face was loaded or generated.");
 			QFile fil(args.value(OUT_CBOR_KEY).toString());
 			if(fil.open(QFile::WriteOnly)) {
+				Profiler::Scope profileScope("serialization");
 				QCborValue cbor = fontface.toCbor();
 				fil.write(cbor.toCbor());
 				fil.flush();
+				Profiler::count(Profiler::BYTES_WRITTEN, fil.size());
 				fil.close();
 			}
 		}
@@ -162,11 +194,13 @@ int main(int argc, char *argv[])
 			if(!hasVectorImage) throw std::runtime_error("No stored vector image was loaded or generated.");
 			QFile fil(args.value(OUT_VECTOR_BIN_KEY).toString());
 			if(fil.open(QFile::WriteOnly)) {
+				Profiler::Scope profileScope("serialization");
 				QDataStream binF(&fil);
 				binF.setVersion(QDataStream::Qt_4_0);
 				binF.setByteOrder(QDataStream::BigEndian);
 				vectorImage.toData(binF);
 				fil.flush();
+				Profiler::count(Profiler::BYTES_WRITTEN, fil.size());
 				fil.close();
 			}
 		}
@@ -174,12 +208,19 @@ int main(int argc, char *argv[])
 			if(!hasVectorImage) throw std::runtime_error("No stored vector image was loaded or generated.");
 			QFile fil(args.value(OUT_VECTOR_CBOR_KEY).toString());
 			if(fil.open(QFile::WriteOnly)) {
+				Profiler::Scope profileScope("serialization");
 				QCborValue cbor = vectorImage.toCbor();
 				fil.write(cbor.toCbor());
 				fil.flush();
+				Profiler::count(Profiler::BYTES_WRITTEN, fil.size());
 				fil.close();
 			}
 		}
+		if(args.contains(PROFILE_KEY)) {
+			Profiler::writeTrace(args.value(PROFILE_KEY).toString());
+			strm << Profiler::summary();
+			strm.flush();
+		}
 		return 0;
 	} else {
 
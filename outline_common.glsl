@@ -0,0 +1,246 @@
+/**
+ * @file outline_common.glsl
+ * @brief Declarations and tile/grid helpers shared by the outline compute shaders.
+ *
+ * Holds the edge, grid and glyph table buffers, the per-glyph globals, the shared-memory
+ * tile edge list and the functions that walk them, so shader3.glsl and shader3_msdf.glsl
+ * only keep their outputs and distance logic.
+ *
+ * SdfGenerationGL injects this file right after the #version line of both shaders, behind
+ * bezier_solvers.glsl, whose scanline solvers calculateWindingFor() uses.
+ */
+
+#define TILE_SIDE 8                          // Pixels along a side of a work group's tile
+#define TILE_THREADS uint(TILE_SIDE * TILE_SIDE)
+#define TILE_EDGES 256                       // Most edges a tile keeps in shared memory; a power of two
+layout (local_size_x = TILE_SIDE, local_size_y = TILE_SIDE, local_size_z = 1) in;
+
+const int LINEAR = 0;     ///< Edge type: line segment
+const int QUADRATIC = 1;  ///< Edge type: quadratic Bezier curve
+const int CUBIC = 2;     ///< Edge type: cubic Bezier curve
+
+/**
+ * @brief Edge segment structure matching C++ EdgeSegment.
+ * @struct EdgeSegment
+ */
+struct EdgeSegment {
+    int type;        ///< Edge type (LINEAR, QUADRATIC, or CUBIC)
+    int shapeId;     ///< Shape/contour ID this edge belongs to
+    uint clr;        ///< Edge color (RRGGBBXX format, selects the MSDF channels of the edge)
+    vec2 points[4];  ///< Control points (up to 4 depending on type)
+};
+
+/**
+ * @brief Shader storage buffer containing all edge segments.
+ * @binding 3
+ */
+layout(std430, binding = 3) buffer EdgeBuffer {
+    EdgeSegment edges[];  ///< Array of edge segments
+};
+
+/**
+ * @brief Uniform buffer containing dimensions.
+ * @binding 4
+ * @struct Dimensions
+ */
+layout (binding = 4, std140) uniform Dimensions {
+    int intendedSampleWidth;   ///< Sample search width (used for max distance calculation)
+    int intendedSampleHeight; ///< Sample search height (used for max distance calculation)
+};
+
+/**
+ * @brief Uniform grids of candidate edges (flattened EdgeSpatialIndex of every glyph of the batch).
+ *
+ * Each glyph's part holds, back to back: the start of each cell's list (columns * rows + 1
+ * entries), the start of each band's list (rows + 1 entries), then the lists themselves.
+ * Offsets are absolute indices into gridData and list entries absolute indices into edges.
+ * Cell lists are sorted nearest first; band lists hold the edges whose vertical extent
+ * overlaps a row of cells.
+ * @binding 5
+ */
+layout(std430, binding = 5) readonly buffer EdgeIndex {
+    uint gridData[];  ///< Offsets and edge lists
+};
+
+/**
+ * @brief Glyph rendered by one slice of the dispatch.
+ * @struct GlyphRange
+ */
+struct GlyphRange {
+    float cellSize;   ///< Side length of a grid cell in pixels
+    uint columns;     ///< Number of grid cells horizontally
+    uint rows;        ///< Number of grid cells vertically
+    uint gridOffset;  ///< Start of the glyph's cell offsets in gridData
+    uint firstEdge;   ///< Start of the glyph's edges in edges
+    uint edgeCount;   ///< Number of edges of the glyph
+};
+
+/**
+ * @brief One entry per glyph of the batch, indexed by gl_GlobalInvocationID.z.
+ * @binding 6
+ */
+layout(std430, binding = 6) readonly buffer GlyphTable {
+    GlyphRange glyphs[];
+};
+
+// Grid and edges of the glyph this invocation renders, loaded from the glyph table by main()
+float gridCellSize;
+uint gridColumns;
+uint gridRows;
+uint gridOffset;
+uint firstEdge;
+uint edgeEnd;
+
+// Candidate edges of the work group's tile, built by gatherTileEdges()
+shared uint tileEdges[TILE_EDGES];  ///< Edge indices, nearest to the tile first
+shared float tileGaps[TILE_EDGES];  ///< Distance from the tile to each edge's bounding box
+shared uint tileEdgeCount;          ///< Edges within reach of the tile, which may exceed TILE_EDGES
+
+#ifdef USE_MANHATTAN_DISTANCE
+    #define DISTANCE_FUNC(p1, p2) (abs((p1).x - (p2).x) + abs((p1).y - (p2).y))
+#else
+    #define DISTANCE_FUNC(p1, p2) length((p1) - (p2))
+#endif
+#define FLT_MAX 3.402823466e+38
+
+/**
+ * @brief Load the grid and edge range of a glyph of the batch into the globals above.
+ */
+void selectGlyph(uint glyph) {
+    GlyphRange range = glyphs[glyph];
+    gridCellSize = range.cellSize;
+    gridColumns = range.columns;
+    gridRows = range.rows;
+    gridOffset = range.gridOffset;
+    firstEdge = range.firstEdge;
+    edgeEnd = range.firstEdge + range.edgeCount;
+}
+
+/**
+ * @brief Get the grid cell containing a position.
+ */
+ivec2 gridCellOf(vec2 pos) {
+    return clamp(ivec2(floor(pos / gridCellSize)), ivec2(0), ivec2(gridColumns, gridRows) - 1);
+}
+
+/**
+ * @brief Bounding box of an edge's control points.
+ */
+void edgeBounds(EdgeSegment edge, out vec2 lo, out vec2 hi) {
+    int count = edge.type == LINEAR ? 2 : (edge.type == QUADRATIC ? 3 : 4);
+    lo = edge.points[0];
+    hi = edge.points[0];
+    for (int j = 1; j < count; ++j) {
+	lo = min(lo, edge.points[j]);
+	hi = max(hi, edge.points[j]);
+    }
+}
+
+/**
+ * @brief Lower bound of the distance between two boxes (0 if they overlap).
+ */
+float boxGap(vec2 lo0, vec2 hi0, vec2 lo1, vec2 hi1) {
+    vec2 d = max(vec2(0.0), max(lo1 - hi0, lo0 - hi1));
+    #ifdef USE_MANHATTAN_DISTANCE
+    return d.x + d.y;
+    #else
+    return length(d);
+    #endif
+}
+
+/**
+ * @brief Gather the edges that can reach this work group's tile into shared memory, nearest first.
+ *
+ * Every invocation tests a share of the glyph's edges against the tile, then the list is
+ * sorted by distance with a bitonic sort, so a pixel can stop at the first edge farther
+ * than its best distance. Must be called by the whole work group.
+ * @param tileLo Centre of the tile's first pixel.
+ * @param tileHi Centre of the tile's last pixel inside the cell.
+ * @param reach Edges farther than this from the tile are left out.
+ * @return Whether the list fits in shared memory; if not, the caller falls back to the grid.
+ */
+bool gatherTileEdges(vec2 tileLo, vec2 tileHi, float reach) {
+    uint lane = gl_LocalInvocationIndex;
+    if (lane == 0u) tileEdgeCount = 0u;
+    memoryBarrierShared();
+    barrier();
+    for (uint i = firstEdge + lane; i < edgeEnd; i += TILE_THREADS) {
+	vec2 lo, hi;
+	edgeBounds(edges[i], lo, hi);
+	float gap = boxGap(lo, hi, tileLo, tileHi);
+	if (gap <= reach) {
+	    uint slot = atomicAdd(tileEdgeCount, 1u);
+	    if (slot < TILE_EDGES) {
+		tileEdges[slot] = i;
+		tileGaps[slot] = gap;
+	    }
+	}
+    }
+    memoryBarrierShared();
+    barrier();
+    uint count = tileEdgeCount;
+    if (count > TILE_EDGES) return false;
+    // Pad to a power of two with entries that sort last
+    uint sortSize = 1u;
+    while (sortSize < count) sortSize <<= 1;
+    for (uint k = count + lane; k < sortSize; k += TILE_THREADS) tileGaps[k] = FLT_MAX;
+    memoryBarrierShared();
+    barrier();
+    for (uint size = 2u; size <= sortSize; size <<= 1) {
+	for (uint stride = size >> 1; stride > 0u; stride >>= 1) {
+	    for (uint k = lane; k < sortSize / 2u; k += TILE_THREADS) {
+		uint a = 2u * k - (k & (stride - 1u));
+		uint b = a + stride;
+		bool ascending = (a & size) == 0u;
+		if ((tileGaps[a] > tileGaps[b]) == ascending) {
+		    float gap = tileGaps[a];
+		    tileGaps[a] = tileGaps[b];
+		    tileGaps[b] = gap;
+		    uint edge = tileEdges[a];
+		    tileEdges[a] = tileEdges[b];
+		    tileEdges[b] = edge;
+		}
+	    }
+	    memoryBarrierShared();
+	    barrier();
+	}
+    }
+    return true;
+}
+
+int calculateWindingFor(vec2 pos, uint i) {
+    EdgeSegment edge = edges[i];
+    float crossings[3];
+    int directions[3];
+    int count = 0;
+    if (edge.type == LINEAR) {
+	count = scanlineIntersectionsLinear(edge.points[0], edge.points[1], pos.y, crossings, directions);
+    }
+    else if (edge.type == QUADRATIC) {
+	count = scanlineIntersectionsQuadratic(edge.points[0], edge.points[1], edge.points[2], pos.y, crossings, directions);
+    }
+    else if (edge.type == CUBIC) {
+	count = scanlineIntersectionsCubic(edge.points[0], edge.points[1], edge.points[2], edge.points[3], pos.y, crossings, directions);
+    }
+    // Crossings to the right of the pixel are the ones the ray from it passes through
+    int winding = 0;
+    for (int j = 0; j < count; ++j) {
+	if (pos.x < crossings[j]) winding += directions[j];
+    }
+    return winding;
+}
+
+/**
+ * @brief Calculate winding number for a position across all edges.
+ * @param pos Position to test.
+ * @return Winding number (non-zero means inside).
+ */
+int calculateWinding(vec2 pos) {
+    int windingNumber = 0;
+    // Only edges overlapping this row of cells can cross the scanline
+    uint band = gridOffset + gridColumns * gridRows + 1u + uint(gridCellOf(pos).y);
+    for (uint k = gridData[band]; k < gridData[band + 1u]; ++k) {
+	windingNumber += calculateWindingFor(pos, gridData[k]);
+    }
+    return windingNumber;
+}
@@ -0,0 +1,113 @@
+/**
+ * @file sdf_pack.glsl
+ * @brief OpenGL compute shader turning raw distances into the final 8-bit texels.
+ *
+ * Second half of the GPU quantization, after sdf_reduce.glsl: every texel is scaled by the
+ * range of its cell so the edge lands on 0.5, then --invert, --midpointadjustment and
+ * --gammacorrect are applied the way SdfQuantizer does, and the result is stored truncated
+ * to 8 bits. Only the packed texture is read back, at a quarter or less of the raw size.
+ *
+ * Define MULTI_CHANNEL for MSDF and MSDFA distances, and KEEP_ALPHA for MSDFA; plain MSDF
+ * gets an opaque alpha channel.
+ *
+ * @version 430 core
+ * @requires OpenGL 4.3+ with compute shader support
+ */
+
+#version 430 core
+
+layout (local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+#ifdef MULTI_CHANNEL
+/**
+ * @brief Raw distances, one square cell per glyph stacked vertically (32-bit float, four channels).
+ * @binding 0
+ */
+layout (binding = 0, rgba32f) readonly uniform image2D rawSdfTexture;
+
+/**
+ * @brief Final texels, laid out like rawSdfTexture (8-bit, four channels).
+ * @binding 2
+ */
+layout (binding = 2, rgba8) writeonly uniform image2D packedTexture;
+#else
+/**
+ * @brief Raw distances, one square cell per glyph stacked vertically (32-bit float, single channel).
+ * @binding 0
+ */
+layout (binding = 0, r32f) readonly uniform image2D rawSdfTexture;
+
+/**
+ * @brief Inside/outside mask, laid out like rawSdfTexture (8-bit).
+ * @binding 1
+ */
+layout (binding = 1, r8) readonly uniform image2D isInsideTex;
+
+/**
+ * @brief Final texels, laid out like rawSdfTexture (8-bit, single channel).
+ * @binding 2
+ */
+layout (binding = 2, r8) writeonly uniform image2D packedTexture;
+#endif
+
+/**
+ * @brief Distance range of one cell, per channel, as written by sdf_reduce.glsl.
+ * @struct CellRange
+ */
+struct CellRange {
+    vec4 maxInside;   ///< Largest inside distance
+    vec4 maxOutside;  ///< Largest outside distance
+};
+
+/**
+ * @brief One range per cell, indexed by gl_GlobalInvocationID.z.
+ * @binding 7
+ */
+layout(std430, binding = 7) readonly buffer CellRanges {
+    CellRange ranges[];
+};
+
+uniform bool invert;          ///< Swap the inside and outside ends of the range
+uniform bool gammaCorrect;    ///< Apply the gamma curve after scaling
+uniform float midpointScale;  ///< 1 / midpoint adjustment, or 1 without one
+
+/**
+ * @brief Map a distance already multiplied by its side's scale to a texel.
+ * @param scaled Scaled distance, in [-0.5, 0.5] within the range of the cell.
+ * @return The texel, rounded down to a multiple of 1/255 like the CPU quantizer.
+ */
+float toTexel(float scaled) {
+    float t = clamp((0.5 + scaled) * midpointScale, 0.0, 1.0);
+    if (gammaCorrect) {
+        float d = t - 0.5;
+        t = 0.5 + 2.0 * d * d * d + 0.5 * d;
+    }
+    // The UNORM store rounds to nearest; flooring first keeps it an exact step
+    return floor(t * 255.0) / 255.0;
+}
+
+void main(void) {
+    ivec2 threadId = ivec2(gl_GlobalInvocationID.xy);
+    int cellSide = imageSize(packedTexture).x;
+    if (threadId.x >= cellSide || threadId.y >= cellSide) {
+        return;
+    }
+    ivec2 texel = threadId + ivec2(0, int(gl_GlobalInvocationID.z) * cellSide);
+    CellRange range = ranges[gl_GlobalInvocationID.z];
+    float halfRange = invert ? -0.5 : 0.5;
+    vec4 scaleInside = halfRange / range.maxInside;
+    vec4 scaleOutside = halfRange / range.maxOutside;
+#ifdef MULTI_CHANNEL
+    vec4 d = imageLoad(rawSdfTexture, texel);
+    vec4 scaled = d * mix(scaleOutside, scaleInside, greaterThanEqual(d, vec4(0.0)));
+    vec4 texels = vec4(toTexel(scaled.r), toTexel(scaled.g), toTexel(scaled.b), 1.0);
+#ifdef KEEP_ALPHA
+    texels.a = toTexel(scaled.a);
+#endif
+#else
+    float d = imageLoad(rawSdfTexture, texel).r;
+    bool inside = imageLoad(isInsideTex, texel).r > 0.5;
+    vec4 texels = vec4(toTexel(inside ? d * scaleInside.r : -d * scaleOutside.r));
+#endif
+    imageStore(packedTexture, texel, texels);
+}
@@ -0,0 +1,97 @@
+/**
+ * @file sdf_reduce.glsl
+ * @brief OpenGL compute shader finding the largest inside and outside distance of every cell.
+ *
+ * First half of the GPU quantization: one work group per cell of a strip texture. Every
+ * invocation strides over the cell keeping its own maxima, then the work group folds them
+ * in shared memory. The ranges are what SdfQuantizer computes on the CPU, and sdf_pack.glsl
+ * scales the cell by them.
+ *
+ * Define MULTI_CHANNEL for MSDF and MSDFA distances, which are signed per channel; without
+ * it, single-channel distances are split into inside and outside by isInsideTex.
+ *
+ * @version 430 core
+ * @requires OpenGL 4.3+ with compute shader support
+ */
+
+#version 430 core
+
+#define REDUCE_THREADS 256
+#define FLT_EPSILON 1.1920929e-07
+
+layout (local_size_x = REDUCE_THREADS, local_size_y = 1, local_size_z = 1) in;
+
+#ifdef MULTI_CHANNEL
+/**
+ * @brief Raw distances, one square cell per glyph stacked vertically (32-bit float, four channels).
+ * @binding 0
+ */
+layout (binding = 0, rgba32f) readonly uniform image2D rawSdfTexture;
+#else
+/**
+ * @brief Raw distances, one square cell per glyph stacked vertically (32-bit float, single channel).
+ * @binding 0
+ */
+layout (binding = 0, r32f) readonly uniform image2D rawSdfTexture;
+
+/**
+ * @brief Inside/outside mask, laid out like rawSdfTexture (8-bit).
+ * @binding 1
+ */
+layout (binding = 1, r8) readonly uniform image2D isInsideTex;
+#endif
+
+/**
+ * @brief Distance range of one cell, per channel.
+ * @struct CellRange
+ */
+struct CellRange {
+    vec4 maxInside;   ///< Largest inside distance, at least FLT_EPSILON
+    vec4 maxOutside;  ///< Largest outside distance, at least FLT_EPSILON
+};
+
+/**
+ * @brief One range per cell, indexed by the work group's z.
+ * @binding 7
+ */
+layout(std430, binding = 7) writeonly buffer CellRanges {
+    CellRange ranges[];
+};
+
+shared vec4 sharedInside[REDUCE_THREADS];
+shared vec4 sharedOutside[REDUCE_THREADS];
+
+void main(void) {
+    int cellSide = imageSize(rawSdfTexture).x;
+    int cellTop = int(gl_WorkGroupID.z) * cellSide;
+    uint lane = gl_LocalInvocationIndex;
+    vec4 maxInside = vec4(FLT_EPSILON);
+    vec4 maxOutside = vec4(FLT_EPSILON);
+    for (int i = int(lane); i < cellSide * cellSide; i += REDUCE_THREADS) {
+        ivec2 texel = ivec2(i % cellSide, cellTop + i / cellSide);
+#ifdef MULTI_CHANNEL
+        vec4 d = imageLoad(rawSdfTexture, texel);
+        maxInside = max(maxInside, d);
+        maxOutside = max(maxOutside, -d);
+#else
+        float d = abs(imageLoad(rawSdfTexture, texel).r);
+        if (imageLoad(isInsideTex, texel).r > 0.5) maxInside.r = max(maxInside.r, d);
+        else maxOutside.r = max(maxOutside.r, d);
+#endif
+    }
+    sharedInside[lane] = maxInside;
+    sharedOutside[lane] = maxOutside;
+    memoryBarrierShared();
+    barrier();
+    for (uint stride = uint(REDUCE_THREADS / 2); stride > 0u; stride >>= 1) {
+        if (lane < stride) {
+            sharedInside[lane] = max(sharedInside[lane], sharedInside[lane + stride]);
+            sharedOutside[lane] = max(sharedOutside[lane], sharedOutside[lane + stride]);
+        }
+        memoryBarrierShared();
+        barrier();
+    }
+    if (lane == 0u) {
+        ranges[gl_WorkGroupID.z] = CellRange(sharedInside[0], sharedOutside[0]);
+    }
+}
@@ -3,9 +3,10 @@
  * @brief OpenGL compute shader for generating single-channel SDF from bitmap images.
  * 
  * This shader computes signed distance fields from rasterized bitmap images.
- * It samples the input texture in a neighborhood around each pixel to find
- * the nearest edge and calculates the distance using either Manhattan or
- * Euclidean distance metrics.
+ * It resolves the jump flood of jump_flood_seed.glsl and jump_flood.glsl: the
+ * nearest pixel on the other side of the edge is looked up rather than searched
+ * for, and the distance to it is measured using either Manhattan or Euclidean
+ * distance metrics.
  * 
  * @version 430 core
  * @requires OpenGL 4.3+ with compute shader support
@@ -43,6 +44,14 @@ layout (binding = 3, std140) uniform Dimensions {
     int intendedSampleHeight; ///< Sample search height in pixels
 };
 
+/**
+ * @brief Flooded seeds: nearest inside pixel in xy, nearest outside pixel in zw, NO_SEED where there is none.
+ * @binding 4
+ */
+layout (binding = 4, rgba16i) readonly uniform iimage2D nearestSeeds;
+
+#define NO_SEED -1
+
 /**
  * @brief Distance function macro.
  * 
@@ -56,37 +65,18 @@ layout (binding = 3, std140) uniform Dimensions {
 #endif
 
 /**
- * @brief Calculate the distance to the nearest edge from a pixel position.
- * 
- * Searches in a neighborhood defined by intendedSampleWidth/Height to find
- * the nearest edge pixel and computes the distance.
+ * @brief Calculate the distance to the nearest pixel on the other side of the edge.
  * 
  * @param threadId Current pixel position (integer coordinates).
- * @param texSize Texture dimensions.
- * @param maxDistance Maximum search distance.
+ * @param maxDistance Maximum distance.
  * @param isInside Whether the current pixel is inside the shape.
  * @return Normalized distance (0.0 to 1.0).
  */
-float calculateDistance(ivec2 threadId, ivec2 texSize, float maxDistance, bool isInside) {
-    float minDistance = maxDistance;
-    for (int offsetY = -intendedSampleHeight; offsetY <= intendedSampleHeight; ++offsetY) {
-        for (int offsetX = -intendedSampleWidth; offsetX <= intendedSampleWidth; ++offsetX) {
-            ivec2 samplePos = clamp(threadId + ivec2(offsetX, offsetY), ivec2(0, 0), texSize - ivec2(1));
-            float pointSample = imageLoad(fontTexture, samplePos).r;
-            bool isEdge = (pointSample > 0.5) != isInside;
-            if (isEdge) {
-                #ifdef USE_MANHATTAN_DISTANCE
-                float dist = abs(float(offsetX)) + abs(float(offsetY));
-                #else
-                float dist = length(vec2(offsetX, offsetY));
-                #endif
-                if (dist < minDistance) {
-                    minDistance = dist;
-                }
-            }
-        }
-    }
-    return minDistance / maxDistance;
+float calculateDistance(ivec2 threadId, float maxDistance, bool isInside) {
+    ivec4 seeds = imageLoad(nearestSeeds, threadId);
+    ivec2 nearest = isInside ? seeds.zw : seeds.xy;
+    if (nearest.x == NO_SEED) return 1.0;
+    return min(DISTANCE_FUNC(vec2(threadId), vec2(nearest)), maxDistance) / maxDistance;
 }
 
 /**
@@ -94,11 +84,11 @@ float calculateDistance(ivec2 threadId, ivec2 texSize, float maxDistance, bool i
  * 
  * For each pixel in the output texture:
  * 1. Determines if the pixel is inside or outside the shape
- * 2. Calculates the distance to the nearest edge
+ * 2. Looks up the distance to the nearest edge
  * 3. Writes the SDF value and inside/outside flag to output textures
  * 
- * Note: SDF values are not normalized here; normalization is performed
- * in a separate CPU pass.
+ * Note: SDF values are not normalized here; sdf_reduce.glsl and sdf_pack.glsl
+ * do that in separate passes.
  */
 void main() {
     ivec2 threadId = ivec2(gl_GlobalInvocationID.xy);
@@ -114,9 +104,7 @@ void main() {
     float maxDistance = length(vec2(intendedSampleWidth, intendedSampleHeight));
     #endif
     bool isInside = pixel > 0.5;
-    float sdfValue = calculateDistance(threadId, imageDimensions, maxDistance, isInside);
-
-    // We do not normalize sdfValue to [-0.5, 0.5] or [0, 1] here - we do it in a separate pass on the CPU.
+    float sdfValue = calculateDistance(threadId, maxDistance, isInside);
 
     // Write the SDF value to the output texture
     imageStore(rawSdfTexture, threadId, vec4(sdfValue, sdfValue, sdfValue, 1.0));
@@ -11,17 +11,18 @@
  * - Per-channel distance calculation based on edge colors
  * - Winding number calculation for inside/outside determination
  * - Pseudo-distance calculation for better accuracy near curves
+ *
+ * The buffers and the tile and grid walks come from outline_common.glsl.
  * 
  * @version 430 core
  * @requires OpenGL 4.3+ with compute shader support
  */
 
 #version 430 core
-layout (local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
 
 /**
  * @brief Output MSDF texture (32-bit float RGBA).
- * RGB = MSDF channels, A = regular SDF.
+ * RGB = MSDF channels, A = regular SDF. A vertical strip of square cells, one per glyph of the batch.
  * @binding 1
  */
 layout (binding = 1, rgba32f) writeonly uniform image2D rawSdfTexture;
@@ -32,45 +33,6 @@ layout (binding = 1, rgba32f) writeonly uniform image2D rawSdfTexture;
  */
 layout (binding = 2, rgba8) writeonly uniform image2D isInsideTex;
 
-const int LINEAR = 0;     ///< Edge type: line segment
-const int QUADRATIC = 1;  ///< Edge type: quadratic Bezier curve
-const int CUBIC = 2;     ///< Edge type: cubic Bezier curve
-
-/**
- * @brief Edge segment structure matching C++ EdgeSegment.
- * @struct EdgeSegment
- */
-struct EdgeSegment {
-    int type;        ///< Edge type (LINEAR, QUADRATIC, or CUBIC)
-    int shapeId;     ///< Shape/contour ID this edge belongs to
-    uint clr;        ///< Edge color (RRGGBBXX format, determines which MSDF channel this edge contributes to)
-    vec2 points[4];  ///< Control points (up to 4 depending on type)
-};
-
-/**
- * @brief Shader storage buffer containing all edge segments.
- * @binding 3
- */
-layout(std430, binding = 3) buffer EdgeBuffer {
-    EdgeSegment edges[];  ///< Array of edge segments
-};
-
-/**
- * @brief Uniform buffer containing dimensions.
- * @binding 4
- * @struct Dimensions
- */
-layout (binding = 4, std140) uniform Dimensions {
-    int intendedSampleWidth;   ///< Sample search width (used for max distance calculation)
-    int intendedSampleHeight; ///< Sample search height (used for max distance calculation)
-};
-
-#ifdef USE_MANHATTAN_DISTANCE
-    #define DISTANCE_FUNC(p1, p2) (abs((p1).x - (p2).x) + abs((p1).y - (p2).y))
-#else
-    #define DISTANCE_FUNC(p1, p2) length((p1) - (p2))
-#endif
-
 vec3 unpackRGB(uint packedRgb) {
     const float inv255 = 1.0 / 255.0;
     return vec3(
@@ -79,7 +41,7 @@ vec3 unpackRGB(uint packedRgb) {
         float( packedRgb        & 0xFF) * inv255
     );
 }
-#define FLT_MAX 3.402823466e+38
+
 float distanceToLineSegment(float maxDistance, vec2 p, vec2 p1, vec2 p2) {
     vec2 v = p2 - p1;
     vec2 w = p - p1;
@@ -92,29 +54,13 @@ float distanceToLineSegment(float maxDistance, vec2 p, vec2 p1, vec2 p2) {
 }
 
 float distanceToQuadraticBezier(float maxDistance, vec2 p, vec2 p1, vec2 p2, vec2 p3) {
-    float minDist = FLT_MAX;
-    int STEPS = imageSize(rawSdfTexture).x / 4;
-    for (int i = 0; i <= STEPS; i++) {
-	float t = float(i) / float(STEPS);
-	float t1 = 1.0 - t;
-	vec2 pt = t1 * t1 * p1 + 2.0 * t1 * t * p2 + t * t * p3;
-        float dst = DISTANCE_FUNC(p, pt);
-        if(abs(dst) <= minDist) minDist = dst;
-    }
-    return minDist;
+    float t;
+    return DISTANCE_FUNC(p, closestPointQuadratic(p, p1, p2, p3, t));
 }
 
 float distanceToCubicBezier(float maxDistance, vec2 p, vec2 p1, vec2 p2, vec2 p3, vec2 p4) {
-    float minDist = FLT_MAX;
-    int STEPS = imageSize(rawSdfTexture).x / 4;
-    for (int i = 0; i <= STEPS; i++) {
-	float t = float(i) / float(STEPS);
-	float t1 = 1.0 - t;
-	vec2 pt = t1*t1*t1*p1 + 3.0*t1*t1*t*p2 + 3.0*t1*t*t*p3 + t*t*t*p4;
-        float dst = DISTANCE_FUNC(p, pt);
-        if(abs(dst) <= minDist) minDist = dst;
-    }
-    return minDist;
+    float t;
+    return DISTANCE_FUNC(p, closestPointCubic(p, p1, p2, p3, p4, t));
 }
 
 float calculateDistance(float maxDistance, vec2 pos, uint i)
@@ -133,25 +79,6 @@ float calculateDistance(float maxDistance, vec2 pos, uint i)
     return distance;
 }
 
-vec2 lerp(vec2 a, vec2 b, float t) {
-    return mix(a, b, t);
-}
-
-vec2 bezier2(vec2 p0, vec2 p1, vec2 p2, float t) {
-    vec2 a = lerp(p0, p1, t);
-    vec2 b = lerp(p1, p2, t);
-    return lerp(a, b, t);
-}
-
-vec2 bezier3(vec2 p0, vec2 p1, vec2 p2, vec2 p3, float t) {
-    vec2 a = lerp(p0, p1, t);
-    vec2 b = lerp(p1, p2, t);
-    vec2 c = lerp(p2, p3, t);
-    vec2 d = lerp(a, b, t);
-    vec2 e = lerp(b, c, t);
-    return lerp(d, e, t);
-}
-
 float distanceToLinePseudo(vec2 p, vec2 a, vec2 b) {
     vec2 pa = p - a;
     vec2 ba = b - a;
@@ -161,49 +88,13 @@ float distanceToLinePseudo(vec2 p, vec2 a, vec2 b) {
 }
 
 float distanceToQuadraticPseudo(vec2 p, vec2 p0, vec2 p1, vec2 p2, out vec2 closestPoint, out float closestT) {
-    int SUBDIVISIONS = imageSize(rawSdfTexture).x / 4;
-    float minDist = 1e20;
-    float subdRecipr = 1.0 / float(SUBDIVISIONS);
-
-    vec2 prev = p0;
-    closestT = 0.0;
-
-    for (int i = 1; i <= SUBDIVISIONS; ++i) {
-        float t = float(i) * subdRecipr;
-        vec2 curr = bezier2(p0, p1, p2, t);
-        float dist = distanceToLinePseudo(p, prev, curr);
-        if (abs(dist) <= minDist) {
-            minDist = dist;
-            closestPoint = 0.5 * (prev + curr);
-            closestT = t - 0.5 * subdRecipr;
-        }
-        prev = curr;
-    }
-
-    return minDist;
+    closestPoint = closestPointQuadratic(p, p0, p1, p2, closestT);
+    return DISTANCE_FUNC(p, closestPoint);
 }
 
 float distanceToCubicPseudo(vec2 p, vec2 p0, vec2 p1, vec2 p2, vec2 p3, out vec2 closestPoint, out float closestT) {
-    int SUBDIVISIONS = imageSize(rawSdfTexture).x / 4;
-    float minDist = 1e20;
-    float subdRecipr = 1.0 / float(SUBDIVISIONS);
-
-    vec2 prev = p0;
-    closestT = 0.0;
-
-    for (int i = 1; i <= SUBDIVISIONS; ++i) {
-        float t = float(i) * subdRecipr;
-        vec2 curr = bezier3(p0, p1, p2, p3, t);
-        float dist = distanceToLinePseudo(p, prev, curr);
-        if (abs(dist) <= minDist) {
-            minDist = dist;
-            closestPoint = 0.5 * (prev + curr);
-            closestT = t - 0.5 * subdRecipr;
-        }
-        prev = curr;
-    }
-
-    return minDist;
+    closestPoint = closestPointCubic(p, p0, p1, p2, p3, closestT);
+    return DISTANCE_FUNC(p, closestPoint);
 }
 
 float signedDistancePseudo(vec2 p, EdgeSegment edge) {
@@ -255,51 +146,9 @@ float signedDistancePseudo(vec2 p, EdgeSegment edge) {
     return 1e20;
 }
 
-int calculateWindingFor(vec2 pos, uint i) {
-    int winding = 0;
-    EdgeSegment edge = edges[i];
-
-    if (edge.type == LINEAR) {
-	vec2 p1 = edge.points[0];
-	vec2 p2 = edge.points[1];
-	if ((p1.y <= pos.y && p2.y > pos.y) || (p1.y > pos.y && p2.y <= pos.y)) {
-	    float intersectX = p1.x + (pos.y - p1.y) * (p2.x - p1.x) / (p2.y - p1.y);
-	    if (pos.x < intersectX) {
-		winding += (p1.y <= pos.y) ? 1 : -1;
-	    }
-	}
-    }
-    else if (edge.type == QUADRATIC || edge.type == CUBIC) {
-        const int CURVE_STEPS = imageSize(rawSdfTexture).x / 4;
-	vec2 prevPoint = edge.points[0];
-
-	for (int j = 1; j <= CURVE_STEPS; j++) {
-	    float t = float(j) / float(CURVE_STEPS);
-	    vec2 currPoint;
-
-	    if (edge.type == QUADRATIC) {
-		float t1 = 1.0 - t;
-		currPoint = t1*t1*edge.points[0] + 2.0*t1*t*edge.points[1] + t*t*edge.points[2];
-	    } else {
-		float t1 = 1.0 - t;
-		currPoint = t1*t1*t1*edge.points[0] + 3.0*t1*t1*t*edge.points[1] + 3.0*t1*t*t*edge.points[2] + t*t*t*edge.points[3];
-	    }
-
-	    if ((prevPoint.y <= pos.y && currPoint.y > pos.y) || (prevPoint.y > pos.y && currPoint.y <= pos.y)) {
-		float intersectX = prevPoint.x + (pos.y - prevPoint.y) * (currPoint.x - prevPoint.x) / (currPoint.y - prevPoint.y);
-		if (pos.x < intersectX) {
-		    winding += (prevPoint.y <= pos.y) ? 1 : -1;
-		}
-	    }
-	    prevPoint = currPoint;
-	}
-    }
-    return winding;
-}
-
 int calculateWindingForContour(vec2 pos, int shapeId) {
     int winding = 0;
-    for (int i = 0; i < edges.length(); ++i) {
+    for (int i = int(firstEdge); i < int(edgeEnd); ++i) {
 	if (edges[i].shapeId == shapeId) {
 	    winding += calculateWindingFor(pos, i);
 	}
@@ -309,7 +158,7 @@ int calculateWindingForContour(vec2 pos, int shapeId) {
 
 int calculateWindingForChannel(vec2 pos, int channel) {
     int winding = 0;
-    for (int i = 0; i < edges.length(); ++i) {
+    for (int i = int(firstEdge); i < int(edgeEnd); ++i) {
 	vec3 clr = unpackRGB(edges[i].clr);
 	bool contributes = (channel == 0 && clr.r >= 0.003921568627451) ||
 	                  (channel == 1 && clr.g >= 0.003921568627451) ||
@@ -321,19 +170,45 @@ int calculateWindingForChannel(vec2 pos, int channel) {
     return winding;
 }
 
-int calculateWinding(vec2 pos) {
-    int windingNumber = 0;
-    for (int i = 0; i < edges.length(); ++i) {
-	int tmpNum = calculateWindingFor(pos, i);
-	windingNumber += tmpNum;
+/**
+ * @brief Offer an edge as the closest one for each channel it carries and for A.
+ *
+ * Later edges win ties, whatever order the candidates are visited in.
+ */
+void considerEdge(vec2 pos, int i, inout vec4 minDistance, inout ivec4 closestEdgeIds, inout ivec4 closestContourIds) {
+    EdgeSegment edge = edges[i];
+    vec3 clr = unpackRGB(edge.clr);
+    float dist = calculateDistance(FLT_MAX, pos, uint(i));
+    bvec4 carries = bvec4(clr.r >= 0.003921568627451, clr.g >= 0.003921568627451, clr.b >= 0.003921568627451, true);
+    for (int c = 0; c < 4; ++c) {
+	if (carries[c] && (dist < minDistance[c] || (dist == minDistance[c] && i > closestEdgeIds[c]))) {
+	    minDistance[c] = dist;
+	    closestEdgeIds[c] = i;
+	    closestContourIds[c] = edge.shapeId;
+	}
     }
-    return windingNumber;
+}
+
+/**
+ * @brief Consider an edge unless its box is farther than every channel it could improve.
+ */
+void considerNearbyEdge(vec2 pos, int i, vec2 lo, vec2 hi, inout vec4 minDistance, inout ivec4 closestEdgeIds, inout ivec4 closestContourIds) {
+    vec3 clr = unpackRGB(edges[i].clr);
+    // The edge can only improve the channels it carries (and A, whose best is never worse)
+    float reach = minDistance.a;
+    if (clr.r >= 0.003921568627451) reach = max(reach, minDistance.r);
+    if (clr.g >= 0.003921568627451) reach = max(reach, minDistance.g);
+    if (clr.b >= 0.003921568627451) reach = max(reach, minDistance.b);
+    if (boxGap(lo, hi, pos, pos) > reach) return;
+    considerEdge(pos, i, minDistance, closestEdgeIds, closestContourIds);
 }
 
 void main(void) {
+    // Cells are square and stacked vertically, one per glyph of the batch
+    int cellSide = imageSize(rawSdfTexture).x;
     ivec2 threadId = ivec2(gl_GlobalInvocationID.xy);
-    ivec2 dims = imageSize(rawSdfTexture);
-    if (threadId.x >= dims.x || threadId.y >= dims.y) return;
+    selectGlyph(gl_WorkGroupID.z);
+    ivec2 texel = threadId + ivec2(0, int(gl_WorkGroupID.z) * cellSide);
 
     vec2 pos = vec2(threadId) + 0.5;
     float maxDistance = FLT_MAX;
@@ -343,35 +218,45 @@ void main(void) {
     float realMaxDistance = length(vec2(intendedSampleWidth, intendedSampleHeight));
     #endif
 
+    // Like the grid cells, the tile keeps the edges within the cap of any of its pixels
+    ivec2 tileOrigin = ivec2(gl_WorkGroupID.xy) * TILE_SIDE;
+    vec2 tileLo = vec2(tileOrigin) + vec2(0.5);
+    vec2 tileHi = vec2(min(tileOrigin + TILE_SIDE, ivec2(cellSide)) - 1) + vec2(0.5);
+    bool tileFits = gatherTileEdges(tileLo, tileHi, realMaxDistance);
+    // Invocations past the edge of the cell only help gather the edges
+    if (threadId.x >= cellSide || threadId.y >= cellSide) return;
+
     // Find closest edge per channel and track contour IDs
     vec4 minDistance = vec4(maxDistance);
     ivec4 closestEdgeIds = ivec4(-1);
     ivec4 closestContourIds = ivec4(-1);
-    for (int i = 0; i < edges.length(); ++i) {
-	EdgeSegment edge = edges[i];
-	vec3 clr = unpackRGB(edge.clr);
-	float dist = calculateDistance(maxDistance, pos, i);
-        if (dist <= minDistance.a) {
-            minDistance.a = dist;
-            closestEdgeIds.a = i;
-            closestContourIds.a = edge.shapeId;
-        }
-        if (clr.r >= 0.003921568627451 && dist <= minDistance.r) {
-	    minDistance.r = dist;
-	    closestEdgeIds.r = i;
-	    closestContourIds.r = edge.shapeId;
-	}
-        if (clr.g >= 0.003921568627451 && dist <= minDistance.g) {
-	    minDistance.g = dist;
-	    closestEdgeIds.g = i;
-	    closestContourIds.g = edge.shapeId;
+    if (tileFits) {
+	for (uint k = 0u; k < tileEdgeCount; ++k) {
+	    if (tileGaps[k] > max(minDistance.r, max(minDistance.g, minDistance.b))) break;
+	    int i = int(tileEdges[k]);
+	    vec2 lo, hi;
+	    edgeBounds(edges[i], lo, hi);
+	    considerNearbyEdge(pos, i, lo, hi, minDistance, closestEdgeIds, closestContourIds);
 	}
-        if (clr.b >= 0.003921568627451 && dist <= minDistance.b) {
-	    minDistance.b = dist;
-	    closestEdgeIds.b = i;
-	    closestContourIds.b = edge.shapeId;
+    } else {
+	ivec2 cell = gridCellOf(pos);
+	vec2 cellLo = vec2(cell) * gridCellSize;
+	vec2 cellHi = vec2(cell + 1) * gridCellSize;
+	uint cellIndex = gridOffset + uint(cell.y) * gridColumns + uint(cell.x);
+	for (uint k = gridData[cellIndex]; k < gridData[cellIndex + 1u]; ++k) {
+	    int i = int(gridData[k]);
+	    vec2 lo, hi;
+	    edgeBounds(edges[i], lo, hi);
+	    if (boxGap(lo, hi, cellLo, cellHi) > max(minDistance.r, max(minDistance.g, minDistance.b))) break;
+	    considerNearbyEdge(pos, i, lo, hi, minDistance, closestEdgeIds, closestContourIds);
 	}
     }
+    // The lists only hold edges within the cap: a channel still beyond it saturates, on the
+    // side the global winding says, instead of searching every edge
+    bvec4 beyondCap = greaterThan(minDistance, vec4(realMaxDistance));
+    for (int c = 0; c < 3; ++c) {
+	if (beyondCap[c]) closestEdgeIds[c] = -1;
+    }
 
     // Compute winding based on the contour of the closest edge per channel
     ivec4 winding = ivec4(0);
@@ -394,22 +279,26 @@ void main(void) {
     minDistance.a = abs(clamp(minDistance.a, -realMaxDistance, realMaxDistance));
 
     // Last ditch effort to fix the holes
-    vec3 clr = unpackRGB(edges[closestEdgeIds.a].clr);
     float windingSign = winding.a <= 0 ? -1.0 : 1.0;
-    vec4 signs = sign(minDistance);
-    if (clr.r >= 0.003921568627451) {
-        minDistance.r = abs(minDistance.r) * windingSign;
-    }
-    if (clr.g >= 0.003921568627451) {
-        minDistance.g = abs(minDistance.g) * windingSign;
+    if (closestEdgeIds.a >= 0) {
+        vec3 clr = unpackRGB(edges[closestEdgeIds.a].clr);
+        if (clr.r >= 0.003921568627451) {
+            minDistance.r = abs(minDistance.r) * windingSign;
+        }
+        if (clr.g >= 0.003921568627451) {
+            minDistance.g = abs(minDistance.g) * windingSign;
+        }
+        if (clr.b >= 0.003921568627451) {
+            minDistance.b = abs(minDistance.b) * windingSign;
+        }
     }
-    if (clr.b >= 0.003921568627451) {
-        minDistance.b = abs(minDistance.b) * windingSign;
+    for (int c = 0; c < 3; ++c) {
+	if (beyondCap[c]) minDistance[c] = realMaxDistance * windingSign;
     }
 
     if(winding.a == 0) minDistance.a = minDistance.a * -1.0;
-    imageStore(rawSdfTexture, threadId, minDistance);
-    imageStore(isInsideTex, threadId, vec4(
+    imageStore(rawSdfTexture, texel, minDistance);
+    imageStore(isInsideTex, texel, vec4(
         float(winding.r != 0),
         float(winding.g != 0),
         float(winding.b != 0),
@@ -112,7 +112,7 @@ void main() {
     bool isInside = pixel > 0.5;
     vec3 sdfValue = calculateDistance(threadId, imageDimensions, maxDistance, isInside);
 
-    // Normalize sdfValue to [-0.5, 0.5] range and then to [0, 1] later, in a separate pass on the CPU
+    // Normalize sdfValue to [-0.5, 0.5] range and then to [0, 1] later, in sdf_reduce.glsl and sdf_pack.glsl
 
     // Write the SDF value to the output texture
     imageStore(rawSdfTexture, threadId, vec4(sdfValue, 1.0));